@@ -467,6 +467,7 @@ typedef enum  CassErrorSource_ {
   XX(CASS_ERROR_SOURCE_LIB, CASS_ERROR_LIB_NOT_IMPLEMENTED, 21, "Not implemented") \
   XX(CASS_ERROR_SOURCE_LIB, CASS_ERROR_LIB_UNABLE_TO_CONNECT, 22, "Unable to connect") \
   XX(CASS_ERROR_SOURCE_LIB, CASS_ERROR_LIB_UNABLE_TO_CLOSE, 23, "Unable to close") \
+  XX(CASS_ERROR_SOURCE_LIB, CASS_ERROR_LIB_NO_ROUTING_KEY, 24, "No routing key") \
   XX(CASS_ERROR_SOURCE_SERVER, CASS_ERROR_SERVER_SERVER_ERROR, 0x0000, "Server error") \
   XX(CASS_ERROR_SOURCE_SERVER, CASS_ERROR_SERVER_PROTOCOL_ERROR, 0x000A, "Protocol error") \
   XX(CASS_ERROR_SOURCE_SERVER, CASS_ERROR_SERVER_BAD_CREDENTIALS, 0x0100, "Bad credentials") \
@@ -641,10 +642,12 @@ cass_cluster_set_ssl(CassCluster* cluster,
                      CassSsl* ssl);
 
 /**
- * Sets the protocol version. This will automatically downgrade if to
- * protocol version 1.
+ * Sets the protocol version. This will automatically downgrade to a lower
+ * protocol version if the server doesn't support the requested version.
+ * Protocol version 3 (Cassandra 2.1+) allows up to 32768 concurrent
+ * requests per connection.
  *
- * Default: 2
+ * Default: 3
  *
  * @public @memberof CassCluster
  *
@@ -660,7 +663,7 @@ cass_cluster_set_protocol_version(CassCluster* cluster,
  * Sets the number of IO threads. This is the number of threads
  * that will handle query requests.
  *
- * Default: 1
+ * Default: 1, Maximum: 256
  *
  * @public @memberof CassCluster
  *
@@ -1014,6 +1017,64 @@ cass_cluster_set_load_balance_dc_aware_n(CassCluster* cluster,
                                          unsigned used_hosts_per_remote_dc,
                                          cass_bool_t allow_remote_dcs_for_local_cl);
 
+/**
+ * Configures the cluster to use rack-aware load balancing. This is
+ * DC-aware load balancing where, for each query, live nodes in the
+ * client's own rack of the local DC are tried first, followed by the
+ * remaining live nodes in the local DC and then any node from other DCs.
+ * When combined with token-aware routing, replicas in the local rack are
+ * also tried before the other local replicas.
+ *
+ * <b>Note:</b> Keeping requests within the same rack (e.g. the same
+ * availability zone) usually reduces both latency and cross-zone traffic
+ * costs.
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] local_dc The primary data center to try first
+ * @param[in] local_rack The rack, in the local data center, to try first
+ * @param[in] used_hosts_per_remote_dc The number of host used in each remote DC if no hosts
+ * are available in the local dc
+ * @param[in] allow_remote_dcs_for_local_cl Allows remote hosts to be used if no local dc hosts
+ * are available and the consistency level is LOCAL_ONE or LOCAL_QUORUM
+ * @return CASS_OK if successful, otherwise an error occurred
+ *
+ * @see cass_cluster_set_load_balance_dc_aware()
+ */
+CASS_EXPORT CassError
+cass_cluster_set_load_balance_rack_aware(CassCluster* cluster,
+                                         const char* local_dc,
+                                         const char* local_rack,
+                                         unsigned used_hosts_per_remote_dc,
+                                         cass_bool_t allow_remote_dcs_for_local_cl);
+
+/**
+ * Same as cass_cluster_set_load_balance_rack_aware(), but with lengths for
+ * string parameters.
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] local_dc
+ * @param[in] local_dc_length
+ * @param[in] local_rack
+ * @param[in] local_rack_length
+ * @param[in] used_hosts_per_remote_dc
+ * @param[in] allow_remote_dcs_for_local_cl
+ * @return same as cass_cluster_set_load_balance_rack_aware()
+ *
+ * @see cass_cluster_set_load_balance_rack_aware()
+ */
+CASS_EXPORT CassError
+cass_cluster_set_load_balance_rack_aware_n(CassCluster* cluster,
+                                           const char* local_dc,
+                                           size_t local_dc_length,
+                                           const char* local_rack,
+                                           size_t local_rack_length,
+                                           unsigned used_hosts_per_remote_dc,
+                                           cass_bool_t allow_remote_dcs_for_local_cl);
+
 /**
  * Configures the cluster to use token-aware request routing, or not.
  *
@@ -1086,6 +1147,106 @@ cass_cluster_set_latency_aware_routing_settings(CassCluster* cluster,
                                                 cass_uint64_t update_rate_ms,
                                                 cass_uint64_t min_measured);
 
+/**
+ * Configures token-aware routing to order a statement's local replicas by
+ * their latency, or not. Replicas are ranked by their average latency
+ * weighted by their requests in flight, so each request is sent to the
+ * fastest healthy replica first. Replicas are rotated otherwise.
+ *
+ * Unlike latency-aware routing, replicas are never excluded. Latencies are
+ * tracked using the scale_ms and min_measured of the latency-aware routing
+ * settings. This has no effect if token-aware routing is disabled.
+ *
+ * Default is cass_false (disabled).
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] enabled
+ *
+ * @see cass_cluster_set_latency_aware_routing_settings()
+ */
+CASS_EXPORT void
+cass_cluster_set_latency_aware_replica_ordering(CassCluster* cluster,
+                                                cass_bool_t enabled);
+
+/**
+ * Configures the cluster to use power of two choices request routing, or
+ * not.
+ *
+ * Default is cass_false (disabled).
+ *
+ * This routing policy takes the first two hosts chosen by the base routing
+ * policy, the two replicas of a statement when token-aware routing is
+ * enabled, and starts with the one that has fewer requests in flight. It
+ * reacts immediately to slow or overloaded hosts. The base routing policy
+ * still determines locality (dc-aware) and placement (token-aware).
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] enabled
+ */
+CASS_EXPORT void
+cass_cluster_set_power_of_two_choices_routing(CassCluster* cluster,
+                                              cass_bool_t enabled);
+
+/**
+ * Enables an adaptive limit on the number of requests in flight to each
+ * host. The limit grows while a host responds with good latencies and
+ * backs off when its requests time out or its latencies rise. Requests
+ * that would exceed a host's limit are sent to the next host in the query
+ * plan instead, and fail if every host is at its limit. This keeps an
+ * overloaded node from being sent more work than it can serve.
+ *
+ * The limit applies separately to each IO thread.
+ *
+ * Default: cass_false (disabled).
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] enabled
+ */
+CASS_EXPORT void
+cass_cluster_set_adaptive_concurrency_limit(CassCluster* cluster,
+                                            cass_bool_t enabled);
+
+/**
+ * Configures the settings for the adaptive concurrency limit.
+ *
+ * Defaults:
+ *
+ * <ul>
+ *   <li>initial_limit: 64</li>
+ *   <li>min_limit: 4</li>
+ *   <li>max_limit: 1024</li>
+ *   <li>backoff_ratio: 0.9</li>
+ *   <li>latency_tolerance: 2.0</li>
+ * </ul>
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] initial_limit The number of requests in flight allowed before
+ * any latencies are measured.
+ * @param[in] min_limit The lowest the limit can back off to. Must be at
+ * least 1.
+ * @param[in] max_limit The highest the limit can grow to.
+ * @param[in] backoff_ratio The limit is multiplied by this ratio when it
+ * backs off. Must be between 0.0 and 1.0 (exclusive).
+ * @param[in] latency_tolerance The limit backs off when a latency exceeds
+ * the lowest recent latency by more than this factor. Must be at least 1.0.
+ * @return CASS_OK if successful, otherwise an error occurred.
+ */
+CASS_EXPORT CassError
+cass_cluster_set_adaptive_concurrency_limit_settings(CassCluster* cluster,
+                                                     unsigned initial_limit,
+                                                     unsigned min_limit,
+                                                     unsigned max_limit,
+                                                     cass_double_t backoff_ratio,
+                                                     cass_double_t latency_tolerance);
+
 /**
  * Enable/Disable Nagel's algorithm on connections.
  *
@@ -1117,6 +1278,115 @@ cass_cluster_set_tcp_keepalive(CassCluster* cluster,
                                cass_bool_t enabled,
                                unsigned delay_secs);
 
+/**
+ * Enable/Disable LZ4 compression of protocol frames. Compression is only
+ * used if the server also supports LZ4 (negotiated when the connection
+ * is established). This reduces the amount of data sent over the network
+ * at the cost of additional CPU time, which is useful for bandwidth
+ * constrained links and large result pages.
+ *
+ * <b>Note:</b> The driver must be built with LZ4 support (CASS_USE_LZ4).
+ *
+ * Default: cass_false (disabled).
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] enabled
+ * @return CASS_OK if successful, otherwise an error occurred.
+ * CASS_ERROR_LIB_NOT_IMPLEMENTED is returned if the driver was built
+ * without LZ4 support.
+ */
+CASS_EXPORT CassError
+cass_cluster_set_lz4_compression(CassCluster* cluster,
+                                 cass_bool_t enabled);
+
+/**
+ * Sets a file used to persist the cluster's topology between sessions. It
+ * contains the hosts, their tokens, the partitioner and the keyspaces'
+ * replication settings.
+ *
+ * When the file exists, its hosts are used as additional contact points
+ * and token-aware routing is available as soon as the session starts
+ * connecting. The snapshot is reconciled with the cluster's system tables
+ * once the control connection is established and the file is rewritten
+ * whenever the topology is refreshed. This is useful for short-lived
+ * applications that spend a large share of their runtime connecting.
+ *
+ * Default: "" (disabled).
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] path The path of the snapshot file. An empty string disables
+ * the snapshot.
+ */
+CASS_EXPORT void
+cass_cluster_set_topology_snapshot_file(CassCluster* cluster,
+                                        const char* path);
+
+/**
+ * Same as cass_cluster_set_topology_snapshot_file(), but with lengths for
+ * string parameters.
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] path
+ * @param[in] path_length
+ *
+ * @see cass_cluster_set_topology_snapshot_file()
+ */
+CASS_EXPORT void
+cass_cluster_set_topology_snapshot_file_n(CassCluster* cluster,
+                                          const char* path,
+                                          size_t path_length);
+
+/**
+ * Enables speculative execution with a constant delay. When an idempotent
+ * statement hasn't received a response after the delay, it's also sent to
+ * the next host in the query plan. The first response is used and the
+ * others are ignored. This reduces tail latencies caused by a slow or
+ * unresponsive node at the cost of additional requests.
+ *
+ * Default: Disabled
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] constant_delay_ms The delay before each speculative execution.
+ * @param[in] max_speculative_executions The maximum number of speculative
+ * executions per request. Zero disables speculative execution.
+ * @return CASS_OK if successful, otherwise an error occurred.
+ *
+ * @see cass_statement_set_is_idempotent()
+ * @see cass_batch_set_is_idempotent()
+ */
+CASS_EXPORT CassError
+cass_cluster_set_constant_speculative_execution_policy(CassCluster* cluster,
+                                                       cass_int64_t constant_delay_ms,
+                                                       int max_speculative_executions);
+
+/**
+ * Enables speculative execution using the 99th percentile of the session's
+ * request latencies as the delay. Speculative executions are not started
+ * until request latencies have been recorded.
+ *
+ * Default: Disabled
+ *
+ * @public @memberof CassCluster
+ *
+ * @param[in] cluster
+ * @param[in] max_speculative_executions The maximum number of speculative
+ * executions per request. Zero disables speculative execution.
+ * @return CASS_OK if successful, otherwise an error occurred.
+ *
+ * @see cass_cluster_set_constant_speculative_execution_policy()
+ */
+CASS_EXPORT CassError
+cass_cluster_set_percentile_speculative_execution_policy(CassCluster* cluster,
+                                                         int max_speculative_executions);
+
 /***********************************************************************************
  *
  * Session
@@ -1853,6 +2123,26 @@ cass_statement_set_keyspace_n(CassStatement* statement,
                               const char* keyspace,
                               size_t keyspace_length);
 
+/**
+ * Gets the Murmur3 partitioner token of the statement's routing key. This
+ * can be used by applications to group statements by their token.
+ *
+ * The token is computed once and cached with the statement until one
+ * of the statement's partition key values is bound again.
+ *
+ * @public @memberof CassStatement
+ *
+ * @param[in] statement
+ * @param[out] token
+ * @return CASS_OK if successful, otherwise CASS_ERROR_LIB_NO_ROUTING_KEY
+ * if the statement has no key indices or a key value is unset or null.
+ *
+ * @see cass_statement_add_key_index()
+ */
+CASS_EXPORT CassError
+cass_statement_murmur3_token(const CassStatement* statement,
+                             cass_int64_t* token);
+
 /**
  * Sets the statement's consistency level.
  *
@@ -1883,6 +2173,25 @@ CASS_EXPORT CassError
 cass_statement_set_serial_consistency(CassStatement* statement,
                                       CassConsistency serial_consistency);
 
+/**
+ * Sets whether the statement is idempotent. Idempotent statements can be
+ * applied multiple times without changing the result beyond the initial
+ * application, and only they are speculatively executed.
+ *
+ * Default: cass_false (not idempotent)
+ *
+ * @public @memberof CassStatement
+ *
+ * @param[in] statement
+ * @param[in] is_idempotent
+ * @return CASS_OK if successful, otherwise an error occurred.
+ *
+ * @see cass_cluster_set_constant_speculative_execution_policy()
+ */
+CASS_EXPORT CassError
+cass_statement_set_is_idempotent(CassStatement* statement,
+                                 cass_bool_t is_idempotent);
+
 /**
  * Sets the statement's page size.
  *
@@ -2732,6 +3041,24 @@ CASS_EXPORT CassError
 cass_batch_set_consistency(CassBatch* batch,
                            CassConsistency consistency);
 
+/**
+ * Sets whether the batch is idempotent. Only idempotent batches are
+ * speculatively executed.
+ *
+ * Default: cass_false (not idempotent)
+ *
+ * @public @memberof CassBatch
+ *
+ * @param[in] batch
+ * @param[in] is_idempotent
+ * @return CASS_OK if successful, otherwise an error occurred.
+ *
+ * @see cass_statement_set_is_idempotent()
+ */
+CASS_EXPORT CassError
+cass_batch_set_is_idempotent(CassBatch* batch,
+                             cass_bool_t is_idempotent);
+
 /**
  * Adds a statement to a batch.
  *
@@ -40,6 +40,12 @@ CassError cass_batch_set_consistency(CassBatch* batch,
   return CASS_OK;
 }
 
+CassError cass_batch_set_is_idempotent(CassBatch* batch,
+                                       cass_bool_t is_idempotent) {
+  batch->set_is_idempotent(is_idempotent == cass_true);
+  return CASS_OK;
+}
+
 CassError cass_batch_add_statement(CassBatch* batch, CassStatement* statement) {
   batch->add_statement(statement);
   return CASS_OK;
@@ -50,28 +56,26 @@ CassError cass_batch_add_statement(CassBatch* batch, CassStatement* statement) {
 namespace cass {
 
 int BatchRequest::encode(int version, BufferVec* bufs) const {
-  if (version != 2) {
+  if (version != 2 && version != 3) {
     return ENCODE_ERROR_UNSUPPORTED_PROTOCOL;
   }
-  return encode_v2(bufs);
+  return encode_v2(version, bufs);
 }
 
-int BatchRequest::encode_v2(BufferVec* bufs) const {
-  const int version = 2;
-
-  size_t length = 0;
-
-  {
-    // <type> [byte] + <n> [short]
-    size_t buf_size = sizeof(uint8_t) + sizeof(uint16_t);
-
-    Buffer buf(buf_size);
-    size_t pos = buf.encode_byte(0, type_);
-    buf.encode_uint16(pos, statements().size());
+// The batch is sized on the first pass and then written into a single buffer
+// (plus any large values) instead of a buffer per statement
+int BatchRequest::encode_v2(int version, BufferVec* bufs) const {
+  BufferBuilder builder;
+  encode_v2(version, &builder);
+  builder.start_encoding(bufs);
+  encode_v2(version, &builder);
+  return builder.size();
+}
 
-    bufs->push_back(buf);
-    length += buf_size;
-  }
+void BatchRequest::encode_v2(int version, BufferBuilder* builder) const {
+  // <type> [byte] + <n> [short]
+  builder->encode_byte(type_);
+  builder->encode_uint16(statements().size());
 
   for (BatchRequest::StatementList::const_iterator
        it = statements_.begin(),
@@ -80,48 +84,29 @@ int BatchRequest::encode_v2(BufferVec* bufs) const {
     const SharedRefPtr<Statement>& statement = *it;
 
     // <kind> [byte]
-    int buf_size = sizeof(uint8_t);
+    builder->encode_byte(statement->kind());
 
     // <string_or_id> [long string] | [short bytes]
-    buf_size += (statement->kind() == CASS_BATCH_KIND_QUERY) ? sizeof(int32_t) : sizeof(uint16_t);
-    buf_size += statement->query().size();
-
-    // <n><value_1>...<value_n>
-    buf_size += sizeof(uint16_t); // <n> [short]
-
-    bufs->push_back(Buffer(buf_size));
-    length += buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = buf.encode_byte(0, statement->kind());
-
     if (statement->kind() == CASS_BATCH_KIND_QUERY) {
-      pos = buf.encode_long_string(pos,
-                                 statement->query().data(),
-                                 statement->query().size());
+      builder->encode_long_string(statement->query().data(),
+                                  statement->query().size());
     } else {
-      pos = buf.encode_string(pos,
-                              statement->query().data(),
-                              statement->query().size());
+      builder->encode_string(statement->query().data(),
+                             statement->query().size());
     }
 
-    buf.encode_uint16(pos, statement->values_count());
-    if (statement->values_count() > 0) {
-      length += statement->encode_values(version, bufs);
-    }
+    // <n><value_1>...<value_n>
+    builder->encode_uint16(statement->values_count()); // <n> [short]
+    statement->encode_values(version, builder);
   }
 
-  {
-    // <consistency> [short]
-    size_t buf_size = sizeof(uint16_t);
+  // <consistency> [short]
+  builder->encode_uint16(consistency_);
 
-    Buffer buf(buf_size);
-    buf.encode_uint16(0, consistency_);
-    bufs->push_back(buf);
-    length += buf_size;
+  if (version >= 3) {
+    // <flags> [byte]
+    builder->encode_byte(0);
   }
-
-  return length;
 }
 
 void BatchRequest::add_statement(Statement* statement) {
@@ -152,4 +137,14 @@ bool BatchRequest::get_routing_key(std::string* routing_key) const {
   return false;
 }
 
+bool BatchRequest::get_murmur3_token(int64_t* token) const {
+  for (BatchRequest::StatementList::const_iterator i = statements_.begin();
+       i != statements_.end(); ++i) {
+    if ((*i)->get_murmur3_token(token)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace cass
@@ -17,6 +17,7 @@
 #ifndef __CASS_BATCH_REQUEST_HPP_INCLUDED__
 #define __CASS_BATCH_REQUEST_HPP_INCLUDED__
 
+#include "buffer_builder.hpp"
 #include "cassandra.h"
 #include "constants.hpp"
 #include "request.hpp"
@@ -53,10 +54,12 @@ public:
   bool prepared_statement(const std::string& id, std::string* statement) const;
 
   virtual bool get_routing_key(std::string* routing_key) const;
+  virtual bool get_murmur3_token(int64_t* token) const;
 
 private:
   int encode(int version, BufferVec* bufs) const;
-  int encode_v2(BufferVec* bufs) const;
+  int encode_v2(int version, BufferVec* bufs) const;
+  void encode_v2(int version, BufferBuilder* builder) const;
 
 private:
   typedef std::map<std::string, ExecuteRequest*> PreparedMap;
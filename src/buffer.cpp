@@ -39,6 +39,16 @@ const BufferCollection* Buffer::collection() const {
   return static_cast<const BufferCollection*>(data_.ref.collection);
 }
 
+void Buffer::truncate(size_t size) {
+  assert(is_buffer() && size <= static_cast<size_t>(size_));
+  if (size_ > FIXED_BUFFER_SIZE && size <= static_cast<size_t>(FIXED_BUFFER_SIZE)) {
+    RefBuffer* buffer = data_.ref.buffer;
+    memcpy(data_.fixed, buffer->data(), size);
+    buffer->dec_ref();
+  }
+  size_ = size;
+}
+
 void Buffer::copy(const Buffer& buffer) {
   BufferRef temp = data_.ref;
 
@@ -174,6 +174,9 @@ public:
 
   int size() const { return size_; }
 
+  // Shrinks the buffer to its first "size" bytes
+  void truncate(size_t size);
+
   bool is_buffer() const { return size_ >= 0; }
 
   bool is_empty() const { return size_ == IS_EMPTY; }
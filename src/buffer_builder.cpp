@@ -0,0 +1,83 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "buffer_builder.hpp"
+
+#include "buffer_collection.hpp"
+
+namespace cass {
+
+void BufferBuilder::start_encoding(BufferVec* bufs) {
+  assert(is_sizing_);
+  segment_sizes_.push_back(segment_size_);
+  is_sizing_ = false;
+  bufs_ = bufs;
+  segment_index_ = 0;
+  start_segment();
+}
+
+void BufferBuilder::append_value(int version, const Buffer& value) {
+  if (value.is_empty()) {
+    encode_int32(-1); // [bytes] "null"
+  } else if (value.is_collection()) {
+    const BufferCollection* collection = value.collection();
+    // Protocol v3 uses [int] for the count and element sizes, [short] otherwise
+    int count_size = version >= 3 ? sizeof(int32_t) : sizeof(uint16_t);
+    int value_size = count_size + collection->calculate_size(version);
+    if (is_sizing_) {
+      add_size(sizeof(int32_t) + value_size);
+    } else {
+      pos_ = current().encode_int32(pos_, value_size);
+      size_t count = collection->is_map() ? collection->item_count() / 2
+                                          : collection->item_count();
+      if (version >= 3) {
+        pos_ = current().encode_int32(pos_, count);
+      } else {
+        pos_ = current().encode_uint16(pos_, count);
+      }
+      collection->encode(version, current().data() + pos_);
+      pos_ += value_size - count_size;
+    }
+  } else if (value.size() > LARGE_VALUE_SIZE) {
+    if (is_sizing_) {
+      segment_sizes_.push_back(segment_size_);
+      segment_size_ = 0;
+      size_ += value.size();
+    } else {
+      bufs_->push_back(value);
+      ++segment_index_;
+      start_segment();
+    }
+  } else {
+    if (is_sizing_) {
+      add_size(value.size());
+    } else {
+      pos_ = current().copy(pos_, value.data(), value.size());
+    }
+  }
+}
+
+void BufferBuilder::start_segment() {
+  assert(segment_index_ < segment_sizes_.size());
+  size_t segment_size = segment_sizes_[segment_index_];
+  pos_ = 0;
+  if (segment_size > 0) {
+    bufs_->push_back(Buffer(segment_size));
+    current_index_ = bufs_->size() - 1;
+  }
+}
+
+} // namespace cass
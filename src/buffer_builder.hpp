@@ -0,0 +1,137 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_BUFFER_BUILDER_HPP_INCLUDED__
+#define __CASS_BUFFER_BUILDER_HPP_INCLUDED__
+
+#include "buffer.hpp"
+#include "fixed_vector.hpp"
+#include "macros.hpp"
+
+namespace cass {
+
+// Builds the body of a request as a small number of contiguous buffers.
+// Requests are encoded twice using the same code: the first pass only
+// calculates the size of each contiguous segment and the second pass
+// allocates each segment once and writes into it. Fixed fields and small
+// values are copied into the current segment, but values larger than
+// LARGE_VALUE_SIZE are added by reference as their own buffer (and iovec)
+// which also starts a new segment.
+
+class BufferBuilder {
+public:
+  static const int LARGE_VALUE_SIZE = 16 * 1024;
+
+  BufferBuilder()
+    : is_sizing_(true)
+    , size_(0)
+    , segment_size_(0)
+    , bufs_(NULL)
+    , segment_index_(0)
+    , current_index_(0)
+    , pos_(0) {}
+
+  bool is_sizing() const { return is_sizing_; }
+
+  // The total size of the encoded request body
+  int32_t size() const { return size_; }
+
+  // Ends the sizing pass; the second pass writes into "bufs"
+  void start_encoding(BufferVec* bufs);
+
+  void encode_byte(uint8_t value) {
+    if (is_sizing_) {
+      add_size(sizeof(uint8_t));
+    } else {
+      pos_ = current().encode_byte(pos_, value);
+    }
+  }
+
+  void encode_uint16(uint16_t value) {
+    if (is_sizing_) {
+      add_size(sizeof(uint16_t));
+    } else {
+      pos_ = current().encode_uint16(pos_, value);
+    }
+  }
+
+  void encode_int32(int32_t value) {
+    if (is_sizing_) {
+      add_size(sizeof(int32_t));
+    } else {
+      pos_ = current().encode_int32(pos_, value);
+    }
+  }
+
+  void encode_string(const char* value, uint16_t size) {
+    if (is_sizing_) {
+      add_size(sizeof(uint16_t) + size);
+    } else {
+      pos_ = current().encode_string(pos_, value, size);
+    }
+  }
+
+  void encode_long_string(const char* value, int32_t size) {
+    if (is_sizing_) {
+      add_size(sizeof(int32_t) + size);
+    } else {
+      pos_ = current().encode_long_string(pos_, value, size);
+    }
+  }
+
+  void encode_bytes(const char* value, int32_t size) {
+    if (is_sizing_) {
+      add_size(sizeof(int32_t) + (size > 0 ? size : 0));
+    } else {
+      pos_ = current().encode_bytes(pos_, value, size);
+    }
+  }
+
+  // Appends a bound value: an empty buffer is encoded as a "null" [bytes],
+  // collections are encoded in place and large buffers are added by
+  // reference.
+  void append_value(int version, const Buffer& value);
+
+private:
+  typedef FixedVector<size_t, 4> SegmentSizeVec;
+
+  void add_size(size_t size) {
+    segment_size_ += size;
+    size_ += size;
+  }
+
+  Buffer& current() { return (*bufs_)[current_index_]; }
+
+  void start_segment();
+
+private:
+  bool is_sizing_;
+  int32_t size_;
+  size_t segment_size_;
+  SegmentSizeVec segment_sizes_;
+
+  BufferVec* bufs_;
+  size_t segment_index_;
+  size_t current_index_;
+  size_t pos_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(BufferBuilder);
+};
+
+} // namespace cass
+
+#endif
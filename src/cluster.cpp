@@ -17,6 +17,8 @@
 #include "cluster.hpp"
 
 #include "common.hpp"
+#include "compression.hpp"
+#include "constants.hpp"
 #include "dc_aware_policy.hpp"
 #include "logger.hpp"
 #include "round_robin_policy.hpp"
@@ -47,7 +49,7 @@ void cass_cluster_set_ssl(CassCluster* cluster,
 
 CassError cass_cluster_set_protocol_version(CassCluster* cluster,
                                             int protocol_version) {
-  if (protocol_version != 1 && protocol_version != 2) {
+  if (protocol_version < 1 || protocol_version > 3) {
     return CASS_ERROR_LIB_BAD_PARAMS;
   }
   cluster->config().set_protocol_version(protocol_version);
@@ -56,7 +58,7 @@ CassError cass_cluster_set_protocol_version(CassCluster* cluster,
 
 CassError cass_cluster_set_num_threads_io(CassCluster* cluster,
                                           unsigned num_threads) {
-  if (num_threads == 0) {
+  if (num_threads == 0 || num_threads > CASS_MAX_IO_WORKERS) {
     return CASS_ERROR_LIB_BAD_PARAMS;
   }
   cluster->config().set_thread_count_io(num_threads);
@@ -260,6 +262,42 @@ CassError cass_cluster_set_load_balance_dc_aware_n(CassCluster* cluster,
   return CASS_OK;
 }
 
+CassError cass_cluster_set_load_balance_rack_aware(CassCluster* cluster,
+                                                   const char* local_dc,
+                                                   const char* local_rack,
+                                                   unsigned used_hosts_per_remote_dc,
+                                                   cass_bool_t allow_remote_dcs_for_local_cl) {
+  if (local_dc == NULL || local_rack == NULL) {
+    return CASS_ERROR_LIB_BAD_PARAMS;
+  }
+  return cass_cluster_set_load_balance_rack_aware_n(cluster,
+                                                    local_dc,
+                                                    strlen(local_dc),
+                                                    local_rack,
+                                                    strlen(local_rack),
+                                                    used_hosts_per_remote_dc,
+                                                    allow_remote_dcs_for_local_cl);
+}
+
+CassError cass_cluster_set_load_balance_rack_aware_n(CassCluster* cluster,
+                                                     const char* local_dc,
+                                                     size_t local_dc_length,
+                                                     const char* local_rack,
+                                                     size_t local_rack_length,
+                                                     unsigned used_hosts_per_remote_dc,
+                                                     cass_bool_t allow_remote_dcs_for_local_cl) {
+  if (local_dc == NULL || local_dc_length == 0 ||
+      local_rack == NULL || local_rack_length == 0) {
+    return CASS_ERROR_LIB_BAD_PARAMS;
+  }
+  cluster->config().set_load_balancing_policy(
+        new cass::DCAwarePolicy(std::string(local_dc, local_dc_length),
+                                std::string(local_rack, local_rack_length),
+                                used_hosts_per_remote_dc,
+                                !allow_remote_dcs_for_local_cl));
+  return CASS_OK;
+}
+
 void cass_cluster_set_token_aware_routing(CassCluster* cluster,
                                           cass_bool_t enabled) {
   cluster->config().set_token_aware_routing(enabled == cass_true);
@@ -285,6 +323,42 @@ void cass_cluster_set_latency_aware_routing_settings(CassCluster* cluster,
   cluster->config().set_latency_aware_routing_settings(settings);
 }
 
+void cass_cluster_set_latency_aware_replica_ordering(CassCluster* cluster,
+                                                     cass_bool_t enabled) {
+  cluster->config().set_latency_ordered_replicas(enabled == cass_true);
+}
+
+void cass_cluster_set_power_of_two_choices_routing(CassCluster* cluster,
+                                                   cass_bool_t enabled) {
+  cluster->config().set_power_of_two_choices_routing(enabled == cass_true);
+}
+
+void cass_cluster_set_adaptive_concurrency_limit(CassCluster* cluster,
+                                                 cass_bool_t enabled) {
+  cluster->config().set_adaptive_concurrency_limit(enabled == cass_true);
+}
+
+CassError cass_cluster_set_adaptive_concurrency_limit_settings(CassCluster* cluster,
+                                                               unsigned initial_limit,
+                                                               unsigned min_limit,
+                                                               unsigned max_limit,
+                                                               cass_double_t backoff_ratio,
+                                                               cass_double_t latency_tolerance) {
+  if (min_limit == 0 || min_limit > max_limit ||
+      backoff_ratio <= 0.0 || backoff_ratio >= 1.0 ||
+      latency_tolerance < 1.0) {
+    return CASS_ERROR_LIB_BAD_PARAMS;
+  }
+  cass::ConcurrencyLimiter::Settings settings;
+  settings.initial_limit = initial_limit;
+  settings.min_limit = min_limit;
+  settings.max_limit = max_limit;
+  settings.backoff_ratio = backoff_ratio;
+  settings.latency_tolerance = latency_tolerance;
+  cluster->config().set_adaptive_concurrency_limit_settings(settings);
+  return CASS_OK;
+}
+
 void cass_cluster_set_tcp_nodelay(CassCluster* cluster,
                                   cass_bool_t enabled) {
   cluster->config().set_tcp_nodelay(enabled == cass_true);
@@ -296,6 +370,48 @@ void cass_cluster_set_tcp_keepalive(CassCluster* cluster,
   cluster->config().set_tcp_keepalive(enabled == cass_true, delay_secs);
 }
 
+CassError cass_cluster_set_lz4_compression(CassCluster* cluster,
+                                           cass_bool_t enabled) {
+  if (enabled == cass_true && !cass::Lz4Compressor::is_available()) {
+    return CASS_ERROR_LIB_NOT_IMPLEMENTED;
+  }
+  cluster->config().set_lz4_compression(enabled == cass_true);
+  return CASS_OK;
+}
+
+void cass_cluster_set_topology_snapshot_file(CassCluster* cluster,
+                                             const char* path) {
+  cass_cluster_set_topology_snapshot_file_n(cluster,
+                                            path,
+                                            path == NULL ? 0 : strlen(path));
+}
+
+void cass_cluster_set_topology_snapshot_file_n(CassCluster* cluster,
+                                               const char* path,
+                                               size_t path_length) {
+  cluster->config().set_topology_snapshot_file(std::string(path, path_length));
+}
+
+CassError cass_cluster_set_constant_speculative_execution_policy(CassCluster* cluster,
+                                                                cass_int64_t constant_delay_ms,
+                                                                int max_speculative_executions) {
+  if (constant_delay_ms < 0 || max_speculative_executions < 0) {
+    return CASS_ERROR_LIB_BAD_PARAMS;
+  }
+  cluster->config().set_constant_speculative_execution(constant_delay_ms,
+                                                       max_speculative_executions);
+  return CASS_OK;
+}
+
+CassError cass_cluster_set_percentile_speculative_execution_policy(CassCluster* cluster,
+                                                                  int max_speculative_executions) {
+  if (max_speculative_executions < 0) {
+    return CASS_ERROR_LIB_BAD_PARAMS;
+  }
+  cluster->config().set_percentile_speculative_execution(max_speculative_executions);
+  return CASS_OK;
+}
+
 void cass_cluster_free(CassCluster* cluster) {
   delete cluster->from();
 }
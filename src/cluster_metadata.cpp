@@ -16,19 +16,50 @@
 
 #include "cluster_metadata.hpp"
 
+#include "logger.hpp"
+
 namespace cass {
 
-ClusterMetadata::ClusterMetadata() {
+ClusterMetadata::ClusterMetadata()
+  : schema_version_(0)
+  , loop_(NULL)
+  , is_updating_token_map_(false)
+  , token_map_(new TokenMap())
+  , is_writing_topology_snapshot_(false) {
   uv_mutex_init(&schema_mutex_);
+  uv_mutex_init(&token_map_mutex_);
+  token_map_work_.data = this;
+  topology_snapshot_work_.data = this;
+  publish_schema_snapshot();
 }
 
 ClusterMetadata::~ClusterMetadata() {
   uv_mutex_destroy(&schema_mutex_);
+  uv_mutex_destroy(&token_map_mutex_);
 }
 
-void ClusterMetadata::clear() {
-  schema_.clear();
-  token_map_.clear();
+void ClusterMetadata::clear(bool keep_token_map) {
+  {
+    ScopedMutex l(&schema_mutex_);
+    schema_.clear();
+    publish_schema_snapshot();
+  }
+  partitioner_class_.clear();
+  host_tokens_.clear();
+  keyspace_strategies_.clear();
+  pending_token_map_updates_.clear();
+  if (is_updating_token_map_) {
+    // The builder is in use, clear it after the running updates
+    TokenMapUpdate update(TokenMapUpdate::CLEAR);
+    update.keep_token_map = keep_token_map;
+    enqueue_token_map_update(update);
+  } else {
+    token_map_builder_.clear();
+    if (!keep_token_map) {
+      publish_token_map(SharedRefPtr<const TokenMap>(new TokenMap()));
+      release_retired_token_maps();
+    }
+  }
 }
 
 void ClusterMetadata::update_keyspaces(ResultResponse* result) {
@@ -36,20 +67,245 @@ void ClusterMetadata::update_keyspaces(ResultResponse* result) {
   {
     ScopedMutex l(&schema_mutex_);
     keyspaces = schema_.update_keyspaces(result);
+    publish_schema_snapshot();
   }
   for (Schema::KeyspacePointerMap::const_iterator i = keyspaces.begin(); i != keyspaces.end(); ++i) {
-    token_map_.update_keyspace(i->first, *i->second);
+    update_keyspace(i->first, ReplicationStrategy::from_keyspace_meta(*i->second));
   }
 }
 
+void ClusterMetadata::update_keyspace(const std::string& keyspace_name,
+                                      const SharedRefPtr<ReplicationStrategy>& strategy) {
+  keyspace_strategies_[keyspace_name] = strategy;
+  TokenMapUpdate update(TokenMapUpdate::UPDATE_KEYSPACE);
+  update.name = keyspace_name;
+  update.strategy = strategy;
+  enqueue_token_map_update(update);
+}
+
 void ClusterMetadata::update_tables(ResultResponse* table_result, ResultResponse* col_result) {
   ScopedMutex l(&schema_mutex_);
   schema_.update_tables(table_result, col_result);
+  publish_schema_snapshot();
+}
+
+void ClusterMetadata::set_partitioner(const std::string& partitioner_class) {
+  if (partitioner_class_.empty()) {
+    partitioner_class_ = partitioner_class;
+  }
+  TokenMapUpdate update(TokenMapUpdate::SET_PARTITIONER);
+  update.name = partitioner_class;
+  enqueue_token_map_update(update);
+}
+
+void ClusterMetadata::update_host(SharedRefPtr<Host>& host, const TokenStringList& tokens) {
+  // The token strings reference the response so they're copied for the worker
+  TokenMapUpdate update(TokenMapUpdate::UPDATE_HOST);
+  update.host = host;
+  update.rack = host->rack();
+  update.dc = host->dc();
+  update.tokens.reserve(tokens.size());
+  for (TokenStringList::const_iterator i = tokens.begin(); i != tokens.end(); ++i) {
+    update.tokens.push_back(i->to_string());
+  }
+  host_tokens_[host->address()] = update.tokens;
+  enqueue_token_map_update(update);
+}
+
+void ClusterMetadata::build() {
+  enqueue_token_map_update(TokenMapUpdate(TokenMapUpdate::BUILD));
 }
 
 void ClusterMetadata::drop_keyspace(const std::string& keyspace_name) {
-  schema_.drop_keyspace(keyspace_name);
-  token_map_.drop_keyspace(keyspace_name);
+  {
+    ScopedMutex l(&schema_mutex_);
+    schema_.drop_keyspace(keyspace_name);
+    publish_schema_snapshot();
+  }
+  keyspace_strategies_.erase(keyspace_name);
+  TokenMapUpdate update(TokenMapUpdate::DROP_KEYSPACE);
+  update.name = keyspace_name;
+  enqueue_token_map_update(update);
+}
+
+void ClusterMetadata::drop_table(const std::string& keyspace_name, const std::string& table_name) {
+  ScopedMutex l(&schema_mutex_);
+  schema_.drop_table(keyspace_name, table_name);
+  publish_schema_snapshot();
+}
+
+void ClusterMetadata::remove_host(SharedRefPtr<Host>& host) {
+  host_tokens_.erase(host->address());
+  TokenMapUpdate update(TokenMapUpdate::REMOVE_HOST);
+  update.host = host;
+  enqueue_token_map_update(update);
+}
+
+void ClusterMetadata::save_topology_snapshot(const std::string& path, const HostMap& hosts) {
+  TopologySnapshot snapshot;
+  snapshot.partitioner = partitioner_class_;
+  snapshot.keyspaces = keyspace_strategies_;
+  for (HostMap::const_iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    TopologySnapshot::HostEntry entry;
+    entry.address = i->first;
+    entry.rack = i->second->rack();
+    entry.dc = i->second->dc();
+    HostTokenMap::const_iterator tokens = host_tokens_.find(i->first);
+    if (tokens != host_tokens_.end()) {
+      entry.tokens = tokens->second;
+    }
+    snapshot.hosts.push_back(entry);
+  }
+
+  std::string data;
+  snapshot.encode(&data);
+  if (loop_ == NULL) {
+    TopologySnapshot::save(path, data);
+    return;
+  }
+
+  // Only the latest snapshot is kept while a write is running
+  pending_topology_snapshot_path_ = path;
+  pending_topology_snapshot_data_.swap(data);
+  if (!is_writing_topology_snapshot_) {
+    run_topology_snapshot_write();
+  }
+}
+
+SharedRefPtr<const TokenMap> ClusterMetadata::token_map() const {
+  ScopedMutex l(&token_map_mutex_);
+  return token_map_;
+}
+
+QueryPlan* ClusterMetadata::new_query_plan(LoadBalancingPolicy* policy,
+                                           const std::string& connected_keyspace,
+                                           const Request* request,
+                                           QueryPlanAllocator* allocator) const {
+  // The snapshot keeps the map alive without holding the lock
+  SharedRefPtr<const TokenMap> token_map(this->token_map());
+  return policy->new_query_plan(connected_keyspace, request, *token_map, allocator);
+}
+
+// Called on the thread pool while updating or on the loop thread otherwise
+void ClusterMetadata::publish_token_map(const SharedRefPtr<const TokenMap>& token_map) {
+  SharedRefPtr<const TokenMap> retired;
+  {
+    ScopedMutex l(&token_map_mutex_);
+    retired = token_map_;
+    token_map_ = token_map;
+  }
+  retired_token_maps_.push_back(retired);
+}
+
+// Called on the loop thread. A retired map can't be acquired again so once
+// only this reference is left no query plan is using it.
+void ClusterMetadata::release_retired_token_maps() {
+  TokenMapVec::iterator i = retired_token_maps_.begin();
+  while (i != retired_token_maps_.end()) {
+    if ((*i)->ref_count() == 1) {
+      i = retired_token_maps_.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+void ClusterMetadata::enqueue_token_map_update(const TokenMapUpdate& update) {
+  pending_token_map_updates_.push_back(update);
+  if (loop_ == NULL) {
+    running_token_map_updates_.swap(pending_token_map_updates_);
+    apply_token_map_updates();
+    running_token_map_updates_.clear();
+    release_retired_token_maps();
+  } else if (!is_updating_token_map_) {
+    run_token_map_updates();
+  }
+}
+
+void ClusterMetadata::run_token_map_updates() {
+  running_token_map_updates_.swap(pending_token_map_updates_);
+  is_updating_token_map_ = true;
+  uv_queue_work(loop_, &token_map_work_,
+                on_token_map_work, on_after_token_map_work);
+}
+
+// Runs on the thread pool; the builder is only touched here while updating
+void ClusterMetadata::apply_token_map_updates() {
+  bool is_cleared = false;
+  for (TokenMapUpdateVec::iterator i = running_token_map_updates_.begin();
+       i != running_token_map_updates_.end(); ++i) {
+    switch (i->type) {
+      case TokenMapUpdate::CLEAR:
+        token_map_builder_.clear();
+        if (!i->keep_token_map) is_cleared = true;
+        break;
+      case TokenMapUpdate::SET_PARTITIONER:
+        token_map_builder_.set_partitioner(i->name);
+        break;
+      case TokenMapUpdate::UPDATE_HOST: {
+        TokenStringList tokens(i->tokens.begin(), i->tokens.end());
+        token_map_builder_.update_host(i->host, i->rack, i->dc, tokens);
+        break;
+      }
+      case TokenMapUpdate::REMOVE_HOST:
+        token_map_builder_.remove_host(i->host);
+        break;
+      case TokenMapUpdate::UPDATE_KEYSPACE:
+        token_map_builder_.update_keyspace(i->name, i->strategy);
+        break;
+      case TokenMapUpdate::DROP_KEYSPACE:
+        token_map_builder_.drop_keyspace(i->name);
+        break;
+      case TokenMapUpdate::BUILD:
+        token_map_builder_.build();
+        break;
+    }
+  }
+
+  // Updates ahead of the first build don't change the published (empty) map
+  if (token_map_builder_.is_built()) {
+    publish_token_map(SharedRefPtr<const TokenMap>(token_map_builder_.copy_replicas()));
+  } else if (is_cleared) {
+    publish_token_map(SharedRefPtr<const TokenMap>(new TokenMap()));
+  }
+}
+
+void ClusterMetadata::run_topology_snapshot_write() {
+  is_writing_topology_snapshot_ = true;
+  topology_snapshot_path_.swap(pending_topology_snapshot_path_);
+  topology_snapshot_data_.swap(pending_topology_snapshot_data_);
+  pending_topology_snapshot_path_.clear();
+  pending_topology_snapshot_data_.clear();
+  uv_queue_work(loop_, &topology_snapshot_work_,
+                on_topology_snapshot_work, on_after_topology_snapshot_work);
+}
+
+void ClusterMetadata::on_token_map_work(uv_work_t* work) {
+  ClusterMetadata* cluster_meta = static_cast<ClusterMetadata*>(work->data);
+  cluster_meta->apply_token_map_updates();
+}
+
+void ClusterMetadata::on_after_token_map_work(uv_work_t* work, int status) {
+  ClusterMetadata* cluster_meta = static_cast<ClusterMetadata*>(work->data);
+  if (status != 0) {
+    LOG_ERROR("Token map update failed with status %d", status);
+  }
+  cluster_meta->running_token_map_updates_.clear();
+  cluster_meta->release_retired_token_maps();
+  cluster_meta->is_updating_token_map_ = false;
+  if (!cluster_meta->pending_token_map_updates_.empty()) {
+    cluster_meta->run_token_map_updates();
+  }
+}
+
+SharedRefPtr<const SchemaSnapshot> ClusterMetadata::schema_snapshot() const {
+  ScopedMutex l(&schema_mutex_);
+  return schema_snapshot_;
+}
+
+void ClusterMetadata::publish_schema_snapshot() {
+  schema_snapshot_ = SharedRefPtr<const SchemaSnapshot>(
+                       new SchemaSnapshot(++schema_version_, schema_));
 }
 
 Schema* ClusterMetadata::copy_schema() const {
@@ -57,4 +313,22 @@ Schema* ClusterMetadata::copy_schema() const {
   return new Schema(schema_);
 }
 
+void ClusterMetadata::on_topology_snapshot_work(uv_work_t* work) {
+  ClusterMetadata* cluster_meta = static_cast<ClusterMetadata*>(work->data);
+  TopologySnapshot::save(cluster_meta->topology_snapshot_path_,
+                         cluster_meta->topology_snapshot_data_);
+}
+
+void ClusterMetadata::on_after_topology_snapshot_work(uv_work_t* work, int status) {
+  ClusterMetadata* cluster_meta = static_cast<ClusterMetadata*>(work->data);
+  if (status != 0) {
+    LOG_ERROR("Topology snapshot write failed with status %d", status);
+  }
+  cluster_meta->topology_snapshot_data_.clear();
+  cluster_meta->is_writing_topology_snapshot_ = false;
+  if (!cluster_meta->pending_topology_snapshot_path_.empty()) {
+    cluster_meta->run_topology_snapshot_write();
+  }
+}
+
 } // namespace cass
@@ -17,8 +17,18 @@
 #ifndef __CASS_CLUSTER_METADATA_HPP_INCLUDED__
 #define __CASS_CLUSTER_METADATA_HPP_INCLUDED__
 
-#include "token_map.hpp"
+#include "load_balancing.hpp"
+#include "ref_counted.hpp"
+#include "replication_strategy.hpp"
 #include "schema_metadata.hpp"
+#include "token_map.hpp"
+#include "topology_snapshot.hpp"
+
+#include <uv.h>
+
+#include <map>
+#include <string>
+#include <vector>
 
 namespace cass {
 
@@ -27,29 +37,132 @@ public:
   ClusterMetadata();
   ~ClusterMetadata();
 
-  void clear();
+  // The token map is built on the loop's thread pool. Without a loop the
+  // token map updates are applied immediately (testing only).
+  void init(uv_loop_t* loop) { loop_ = loop; }
+
+  // The published token map can be kept until the next build replaces it so
+  // routing continues while the metadata is refreshed
+  void clear(bool keep_token_map = false);
   void update_keyspaces(ResultResponse* result);
+  void update_keyspace(const std::string& keyspace_name,
+                       const SharedRefPtr<ReplicationStrategy>& strategy);
   void update_tables(ResultResponse* table_result, ResultResponse* col_result);
-  void set_partitioner(const std::string& partitioner_class) { token_map_.set_partitioner(partitioner_class); }
-  void update_host(SharedRefPtr<Host>& host, const TokenStringList& tokens) { token_map_.update_host(host, tokens); }
-  void build() { token_map_.build(); }
+  void set_partitioner(const std::string& partitioner_class);
+  void update_host(SharedRefPtr<Host>& host, const TokenStringList& tokens);
+  void build();
   void drop_keyspace(const std::string& keyspace_name);
-  void drop_table(const std::string& keyspace_name, const std::string& table_name) { schema_.drop_table(keyspace_name, table_name); }
-  void remove_host(SharedRefPtr<Host>& host) { token_map_.remove_host(host); }
+  void drop_table(const std::string& keyspace_name, const std::string& table_name);
+  void remove_host(SharedRefPtr<Host>& host);
+
+  // Writes the partitioner, tokens and keyspace replication along with the
+  // hosts' placement. The file is written on the loop's thread pool, one
+  // write at a time.
+  void save_topology_snapshot(const std::string& path, const HostMap& hosts);
 
-  const Schema& schema() const { return schema_; }
+  // Synchronized, can be called from any thread
+  SharedRefPtr<const SchemaSnapshot> schema_snapshot() const;
   Schema* copy_schema() const;// synchronized copy for API
 
   void set_protocol_version(int version) { schema_.set_protocol_version(version); }
 
-  const TokenMap& token_map() const { return token_map_; }
+  // Synchronized, can be called from any thread. The returned map is immutable
+  // and is replaced, not updated, when the token map is rebuilt.
+  SharedRefPtr<const TokenMap> token_map() const;
+
+  // Uses the current token map snapshot (can run on application threads)
+  QueryPlan* new_query_plan(LoadBalancingPolicy* policy,
+                            const std::string& connected_keyspace,
+                            const Request* request,
+                            QueryPlanAllocator* allocator = NULL) const;
+
+private:
+  struct TokenMapUpdate {
+    enum Type {
+      CLEAR,
+      SET_PARTITIONER,
+      UPDATE_HOST,
+      REMOVE_HOST,
+      UPDATE_KEYSPACE,
+      DROP_KEYSPACE,
+      BUILD
+    };
+
+    TokenMapUpdate(Type type)
+      : type(type)
+      , keep_token_map(false) {}
+
+    Type type;
+    bool keep_token_map; // Used by CLEAR
+    std::string name; // Partitioner class or keyspace name
+    SharedRefPtr<Host> host;
+    std::string rack; // The host's placement when the update was queued
+    std::string dc;
+    std::vector<std::string> tokens;
+    SharedRefPtr<ReplicationStrategy> strategy;
+  };
+
+  typedef std::vector<TokenMapUpdate> TokenMapUpdateVec;
+
+  // Must be called with the schema mutex held
+  void publish_schema_snapshot();
+
+  void publish_token_map(const SharedRefPtr<const TokenMap>& token_map);
+  void release_retired_token_maps();
+  void enqueue_token_map_update(const TokenMapUpdate& update);
+  void run_token_map_updates();
+  void apply_token_map_updates();
+
+  static void on_token_map_work(uv_work_t* work);
+  static void on_after_token_map_work(uv_work_t* work, int status);
+
+  void run_topology_snapshot_write();
+
+  static void on_topology_snapshot_work(uv_work_t* work);
+  static void on_after_topology_snapshot_work(uv_work_t* work, int status);
 
 private:
   Schema schema_;
-  TokenMap token_map_;
+  uint64_t schema_version_;
+  SharedRefPtr<const SchemaSnapshot> schema_snapshot_;
+
+  uv_loop_t* loop_;
+
+  // The updates are queued on the loop thread and applied in batches to the
+  // builder map on a thread pool thread. Only one batch runs at a time.
+  TokenMapUpdateVec pending_token_map_updates_;
+  TokenMapUpdateVec running_token_map_updates_;
+  bool is_updating_token_map_;
+  uv_work_t token_map_work_;
+  TokenMap token_map_builder_;
+  SharedRefPtr<const TokenMap> token_map_;
+
+  // Replaced token maps are kept until the loop thread holds their last
+  // reference. Freeing a map's replicas then never happens while holding
+  // the token map mutex or on an application thread.
+  typedef std::vector<SharedRefPtr<const TokenMap> > TokenMapVec;
+  TokenMapVec retired_token_maps_;
+
+  // The token map's inputs, kept on the loop thread for the topology snapshot
+  typedef std::map<Address, std::vector<std::string> > HostTokenMap;
+  std::string partitioner_class_;
+  HostTokenMap host_tokens_;
+  TopologySnapshot::KeyspaceStrategyMap keyspace_strategies_;
+
+  // Writes to the same temporary file can't overlap so a snapshot saved
+  // while another is being written waits for it. Only the latest one is kept.
+  bool is_writing_topology_snapshot_;
+  uv_work_t topology_snapshot_work_;
+  std::string topology_snapshot_path_;
+  std::string topology_snapshot_data_;
+  std::string pending_topology_snapshot_path_;
+  std::string pending_topology_snapshot_data_;
 
   // Used to synch schema updates and copies
   mutable uv_mutex_t schema_mutex_;
+
+  // Only held to swap or copy the token map pointer
+  mutable uv_mutex_t token_map_mutex_;
 };
 
 } // namespace cass
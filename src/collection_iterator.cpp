@@ -19,8 +19,15 @@
 namespace cass {
 
 char* CollectionIterator::decode_value(char* position) {
-  uint16_t size;
-  char* buffer = decode_uint16(position, size);
+  char* buffer;
+  int32_t size;
+  if (collection_->protocol_version() >= 3) {
+    buffer = decode_int32(position, size);
+  } else {
+    uint16_t short_size;
+    buffer = decode_uint16(position, short_size);
+    size = short_size;
+  }
 
   CassValueType type;
   if (collection_->type() == CASS_VALUE_TYPE_MAP) {
@@ -0,0 +1,136 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "compression.hpp"
+
+#include "serialization.hpp"
+
+#ifdef CASS_USE_LZ4
+#include <lz4.h>
+#endif
+
+#include <limits>
+
+namespace cass {
+
+#ifdef CASS_USE_LZ4
+
+bool Lz4Compressor::is_available() {
+  return true;
+}
+
+bool Lz4Compressor::compress(BufferVec::const_iterator begin,
+                             BufferVec::const_iterator end,
+                             std::vector<char>* scratch,
+                             Buffer* output) {
+  size_t input_size = 0;
+  for (BufferVec::const_iterator it = begin; it != end; ++it) {
+    assert(it->is_buffer());
+    input_size += it->size();
+  }
+
+  if (input_size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+    return false;
+  }
+
+  // The output holds the uncompressed length followed by the compressed
+  // block. It's sized for the worst case and truncated afterwards.
+  size_t bound = LZ4_compressBound(input_size);
+  Buffer buf(sizeof(int32_t) + bound);
+  size_t offset = buf.encode_int32(0, input_size);
+
+  // The input needs to be contiguous. Most bodies are a single buffer from
+  // the BufferBuilder and are compressed directly; bodies with large values
+  // added by reference are gathered into the scratch space first.
+  const char* input;
+  if (end - begin == 1) {
+    input = begin->data();
+  } else {
+    scratch->resize(input_size);
+    char* pos = &(*scratch)[0];
+    for (BufferVec::const_iterator it = begin; it != end; ++it) {
+      memcpy(pos, it->data(), it->size());
+      pos += it->size();
+    }
+    input = &(*scratch)[0];
+  }
+
+  int compressed_size = LZ4_compress_default(input, buf.data() + offset,
+                                             input_size, bound);
+  if (compressed_size <= 0) {
+    return false;
+  }
+
+  buf.truncate(offset + compressed_size);
+  *output = buf;
+
+  return true;
+}
+
+bool Lz4Compressor::decompress(const char* input, size_t input_size,
+                               SharedRefPtr<RefBuffer>* output,
+                               int32_t* output_size) {
+  if (input_size < sizeof(int32_t)) {
+    return false;
+  }
+
+  int32_t size = 0;
+  decode_int32(const_cast<char*>(input), size);
+
+  // The uncompressed length comes from the peer; reject lengths that LZ4
+  // couldn't possibly produce from this block before allocating anything.
+  uint64_t max_size = static_cast<uint64_t>(input_size - sizeof(int32_t)) *
+                      MAX_COMPRESSION_RATIO;
+  if (size < 0 || size > MAX_UNCOMPRESSED_SIZE ||
+      static_cast<uint64_t>(size) > max_size) {
+    return false;
+  }
+
+  SharedRefPtr<RefBuffer> buffer(RefBuffer::create(size));
+  int result = LZ4_decompress_safe(input + sizeof(int32_t), buffer->data(),
+                                   input_size - sizeof(int32_t), size);
+  if (result != size) {
+    return false;
+  }
+
+  *output = buffer;
+  *output_size = size;
+
+  return true;
+}
+
+#else
+
+bool Lz4Compressor::is_available() {
+  return false;
+}
+
+bool Lz4Compressor::compress(BufferVec::const_iterator begin,
+                             BufferVec::const_iterator end,
+                             std::vector<char>* scratch,
+                             Buffer* output) {
+  return false;
+}
+
+bool Lz4Compressor::decompress(const char* input, size_t input_size,
+                               SharedRefPtr<RefBuffer>* output,
+                               int32_t* output_size) {
+  return false;
+}
+
+#endif
+
+} // namespace cass
@@ -0,0 +1,59 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_COMPRESSION_HPP_INCLUDED__
+#define __CASS_COMPRESSION_HPP_INCLUDED__
+
+#include "buffer.hpp"
+#include "ref_counted.hpp"
+
+#include <string>
+#include <vector>
+
+#define CASS_COMPRESSION_LZ4 "lz4"
+
+namespace cass {
+
+class Lz4Compressor {
+public:
+  // Cassandra's default maximum frame size (native_transport_max_frame_size)
+  static const int32_t MAX_UNCOMPRESSED_SIZE = 256 * 1024 * 1024;
+
+  // An LZ4 block can't expand to more than 255 times its compressed size
+  static const int32_t MAX_COMPRESSION_RATIO = 255;
+
+  // Returns true if the driver was built with LZ4 support
+  static bool is_available();
+
+  // Compresses the frame body made up of the buffers [begin, end) using the
+  // format expected by Cassandra: the uncompressed length as an [int]
+  // followed by an LZ4 block. The scratch space is only used (and reused
+  // between calls) when the body isn't already a single buffer.
+  static bool compress(BufferVec::const_iterator begin,
+                       BufferVec::const_iterator end,
+                       std::vector<char>* scratch,
+                       Buffer* output);
+
+  // Fails if the uncompressed length is larger than the maximum frame size
+  // or larger than the block could decompress to.
+  static bool decompress(const char* input, size_t input_size,
+                         SharedRefPtr<RefBuffer>* output,
+                         int32_t* output_size);
+};
+
+} // namespace cass
+
+#endif
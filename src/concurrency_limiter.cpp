@@ -0,0 +1,89 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "concurrency_limiter.hpp"
+
+#include <algorithm>
+
+namespace cass {
+
+ConcurrencyLimiter::ConcurrencyLimiter(const Settings& settings)
+  : settings_(settings)
+  , limit_(std::min(std::max(settings.initial_limit, settings.min_limit),
+                    settings.max_limit))
+  , min_latency_ns_(0)
+  , window_min_latency_ns_(0)
+  , window_count_(0)
+  , latency_window_count_(0)
+  , latency_window_slow_count_(0)
+  , samples_until_backoff_(0) {}
+
+void ConcurrencyLimiter::on_success(uint64_t latency_ns, size_t in_flight) {
+  if (min_latency_ns_ == 0 || latency_ns < min_latency_ns_) {
+    min_latency_ns_ = latency_ns;
+  }
+  if (window_count_ == 0 || latency_ns < window_min_latency_ns_) {
+    window_min_latency_ns_ = latency_ns;
+  }
+  if (++window_count_ >= MIN_LATENCY_WINDOW) {
+    min_latency_ns_ = window_min_latency_ns_;
+    window_count_ = 0;
+  }
+
+  if (samples_until_backoff_ > 0) {
+    --samples_until_backoff_;
+  }
+
+  bool is_slow = latency_ns > settings_.latency_tolerance * min_latency_ns_;
+  if (is_slow) {
+    ++latency_window_slow_count_;
+  }
+
+  if (++latency_window_count_ >= limit()) {
+    bool is_median_slow = 2 * latency_window_slow_count_ > latency_window_count_;
+    latency_window_count_ = 0;
+    latency_window_slow_count_ = 0;
+    if (is_median_slow) {
+      backoff();
+      return;
+    }
+  }
+
+  if (!is_slow && 2 * in_flight >= limit()) {
+    // Only grow while the limit is being used, roughly one per limit's worth
+    // of requests
+    limit_ = std::min(limit_ + 1.0 / limit_,
+                      static_cast<double>(settings_.max_limit));
+  }
+}
+
+void ConcurrencyLimiter::on_dropped() {
+  if (samples_until_backoff_ > 0) {
+    --samples_until_backoff_;
+  }
+  backoff();
+}
+
+void ConcurrencyLimiter::backoff() {
+  if (samples_until_backoff_ > 0) return;
+  limit_ = std::max(limit_ * settings_.backoff_ratio,
+                    static_cast<double>(settings_.min_limit));
+  samples_until_backoff_ = limit();
+  latency_window_count_ = 0;
+  latency_window_slow_count_ = 0;
+}
+
+} // namespace cass
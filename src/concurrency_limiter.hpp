@@ -0,0 +1,82 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_CONCURRENCY_LIMITER_HPP_INCLUDED__
+#define __CASS_CONCURRENCY_LIMITER_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace cass {
+
+// An additive increase/multiplicative decrease (AIMD) limit on the number of
+// requests in flight to a host. The limit grows while the host is kept busy
+// with good latencies and backs off when requests time out or when the
+// median latency of a limit's worth of requests exceeds a multiple of the
+// lowest recently observed latency. Single slow requests from the host's
+// normal latency tail don't cause a backoff. It's used by a single IO worker
+// so it doesn't need to be thread-safe.
+class ConcurrencyLimiter {
+public:
+  struct Settings {
+    Settings()
+      : initial_limit(64)
+      , min_limit(4)
+      , max_limit(1024)
+      , backoff_ratio(0.9)
+      , latency_tolerance(2.0) {}
+
+    unsigned initial_limit;
+    unsigned min_limit;
+    unsigned max_limit;
+    double backoff_ratio;
+    double latency_tolerance;
+  };
+
+  // The lowest latency is re-measured after this many samples so that the
+  // baseline follows the host when its no-load latency changes
+  static const uint64_t MIN_LATENCY_WINDOW = 1000;
+
+  ConcurrencyLimiter(const Settings& settings = Settings());
+
+  size_t limit() const { return static_cast<size_t>(limit_); }
+
+  bool is_limited(size_t in_flight) const { return in_flight >= limit(); }
+
+  void on_success(uint64_t latency_ns, size_t in_flight);
+  void on_dropped();
+
+private:
+  void backoff();
+
+private:
+  Settings settings_;
+  double limit_;
+  uint64_t min_latency_ns_;
+  uint64_t window_min_latency_ns_;
+  uint64_t window_count_;
+  // The latencies are judged in windows of a limit's worth of samples. The
+  // median is over the tolerance when most of the window's samples are.
+  size_t latency_window_count_;
+  size_t latency_window_slow_count_;
+  // Latencies of requests started before a backoff don't reflect the new
+  // limit so further backoffs wait for about a limit's worth of samples
+  size_t samples_until_backoff_;
+};
+
+} // namespace cass
+
+#endif
@@ -19,8 +19,10 @@
 
 #include "auth.hpp"
 #include "cassandra.h"
+#include "concurrency_limiter.hpp"
 #include "dc_aware_policy.hpp"
 #include "latency_aware_policy.hpp"
+#include "power_of_two_choices_policy.hpp"
 #include "ssl.hpp"
 #include "token_aware_policy.hpp"
 
@@ -37,7 +39,7 @@ public:
 
   Config()
       : port_(9042)
-      , protocol_version_(2)
+      , protocol_version_(3)
       , thread_count_io_(1)
       , queue_size_io_(8192)
       , queue_size_event_(8192)
@@ -61,9 +63,16 @@ public:
       , load_balancing_policy_(new DCAwarePolicy())
       , token_aware_routing_(true)
       , latency_aware_routing_(false)
+      , latency_ordered_replicas_(false)
+      , power_of_two_choices_routing_(false)
       , tcp_nodelay_enable_(false)
       , tcp_keepalive_enable_(false)
-      , tcp_keepalive_delay_secs_(0) {}
+      , tcp_keepalive_delay_secs_(0)
+      , lz4_compression_(false)
+      , max_speculative_executions_(0)
+      , speculative_execution_delay_ms_(0)
+      , is_speculative_execution_delay_percentile_(false)
+      , adaptive_concurrency_limit_(false) {}
 
   unsigned thread_count_io() const { return thread_count_io_; }
 
@@ -225,7 +234,14 @@ public:
     // base LBP can be augmented by special wrappers (whitelist, token aware, latency aware)
     LoadBalancingPolicy* chain = load_balancing_policy_->new_instance();
     if (token_aware_routing()) {
-      chain = new TokenAwarePolicy(chain);
+      if (latency_ordered_replicas()) {
+        chain = new TokenAwarePolicy(chain, latency_aware_routing_settings_);
+      } else {
+        chain = new TokenAwarePolicy(chain);
+      }
+    }
+    if (power_of_two_choices()) {
+      chain = new PowerOfTwoChoicesPolicy(chain);
     }
     if (latency_aware()) {
       chain = new LatencyAwarePolicy(chain, latency_aware_routing_settings_);
@@ -256,6 +272,18 @@ public:
     latency_aware_routing_settings_ = settings;
   }
 
+  bool latency_ordered_replicas() const { return latency_ordered_replicas_; }
+
+  void set_latency_ordered_replicas(bool enable) {
+    latency_ordered_replicas_ = enable;
+  }
+
+  bool power_of_two_choices() const { return power_of_two_choices_routing_; }
+
+  void set_power_of_two_choices_routing(bool enable) {
+    power_of_two_choices_routing_ = enable;
+  }
+
   bool tcp_nodelay_enable() const { return tcp_nodelay_enable_; }
 
   void set_tcp_nodelay(bool enable) {
@@ -270,6 +298,54 @@ public:
     tcp_keepalive_delay_secs_ = delay_secs;
   }
 
+  bool lz4_compression() const { return lz4_compression_; }
+
+  void set_lz4_compression(bool enable) {
+    lz4_compression_ = enable;
+  }
+
+  const std::string& topology_snapshot_file() const { return topology_snapshot_file_; }
+
+  void set_topology_snapshot_file(const std::string& path) {
+    topology_snapshot_file_ = path;
+  }
+
+  unsigned max_speculative_executions() const { return max_speculative_executions_; }
+  uint64_t speculative_execution_delay_ms() const { return speculative_execution_delay_ms_; }
+
+  // The delay is the 99th percentile of the request latencies instead of a
+  // constant
+  bool is_speculative_execution_delay_percentile() const {
+    return is_speculative_execution_delay_percentile_;
+  }
+
+  void set_constant_speculative_execution(uint64_t delay_ms,
+                                          unsigned max_speculative_executions) {
+    max_speculative_executions_ = max_speculative_executions;
+    speculative_execution_delay_ms_ = delay_ms;
+    is_speculative_execution_delay_percentile_ = false;
+  }
+
+  void set_percentile_speculative_execution(unsigned max_speculative_executions) {
+    max_speculative_executions_ = max_speculative_executions;
+    speculative_execution_delay_ms_ = 0;
+    is_speculative_execution_delay_percentile_ = true;
+  }
+
+  bool adaptive_concurrency_limit() const { return adaptive_concurrency_limit_; }
+
+  void set_adaptive_concurrency_limit(bool enable) {
+    adaptive_concurrency_limit_ = enable;
+  }
+
+  const ConcurrencyLimiter::Settings& adaptive_concurrency_limit_settings() const {
+    return adaptive_concurrency_limit_settings_;
+  }
+
+  void set_adaptive_concurrency_limit_settings(const ConcurrencyLimiter::Settings& settings) {
+    adaptive_concurrency_limit_settings_ = settings;
+  }
+
 private:
   int port_;
   int protocol_version_;
@@ -299,9 +375,18 @@ private:
   bool token_aware_routing_;
   bool latency_aware_routing_;
   LatencyAwarePolicy::Settings latency_aware_routing_settings_;
+  bool latency_ordered_replicas_;
+  bool power_of_two_choices_routing_;
   bool tcp_nodelay_enable_;
   bool tcp_keepalive_enable_;
   unsigned tcp_keepalive_delay_secs_;
+  bool lz4_compression_;
+  std::string topology_snapshot_file_;
+  unsigned max_speculative_executions_;
+  uint64_t speculative_execution_delay_ms_;
+  bool is_speculative_execution_delay_percentile_;
+  bool adaptive_concurrency_limit_;
+  ConcurrencyLimiter::Settings adaptive_concurrency_limit_settings_;
 };
 
 } // namespace cass
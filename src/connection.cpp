@@ -20,6 +20,7 @@
 #include "auth_requests.hpp"
 #include "auth_responses.hpp"
 #include "common.hpp"
+#include "compression.hpp"
 #include "constants.hpp"
 #include "connector.hpp"
 #include "timer.hpp"
@@ -29,6 +30,7 @@
 #include "startup_request.hpp"
 #include "query_request.hpp"
 #include "options_request.hpp"
+#include "read_buffer_pool.hpp"
 #include "register_request.hpp"
 #include "error_response.hpp"
 #include "event_response.hpp"
@@ -141,9 +143,12 @@ void Connection::StartupHandler::on_result_response(ResponseMessage* response) {
 }
 
 Connection::Connection(uv_loop_t* loop,
+                       TimerWheel* timer_wheel,
                        const Config& config,
                        Metrics* metrics,
+                       ReadBufferPool* read_buffer_pool,
                        const Address& address,
+                       const SharedRefPtr<Host>& host,
                        const std::string& keyspace,
                        int protocol_version,
                        Listener* listener)
@@ -155,14 +160,20 @@ Connection::Connection(uv_loop_t* loop,
     , ssl_error_code_(CASS_OK)
     , pending_writes_size_(0)
     , loop_(loop)
+    , timer_wheel_(timer_wheel)
     , config_(config)
     , metrics_(metrics)
+    , read_buffer_pool_(read_buffer_pool)
+    , read_buffer_(NULL)
+    , read_buffer_size_(0)
     , address_(address)
     , addr_string_(address.to_string())
     , keyspace_(keyspace)
     , protocol_version_(protocol_version)
     , listener_(listener)
+    , host_(host)
     , response_(new ResponseMessage())
+    , stream_manager_(protocol_version)
     , version_("3.0.0")
     , connect_timer_(NULL)
     , ssl_session_(NULL) {
@@ -196,10 +207,11 @@ void Connection::connect() {
 }
 
 bool Connection::write(Handler* handler, bool flush_immediately) {
-  int8_t stream = stream_manager_.acquire_stream(handler);
+  int16_t stream = stream_manager_.acquire_stream(handler);
   if (stream < 0) {
     return false;
   }
+  if (host_) host_->inc_inflight_request_count();
 
   handler->inc_ref(); // Connection reference
   handler->set_connection(this);
@@ -218,11 +230,13 @@ bool Connection::write(Handler* handler, bool flush_immediately) {
   int32_t request_size = pending_write->write(handler);
   if (request_size < 0) {
     stream_manager_.release_stream(stream);
+    if (host_) host_->dec_inflight_request_count();
     handler->on_error(CASS_ERROR_LIB_MESSAGE_ENCODE,
                       "Operation unsupported by this protocol version");
     handler->dec_ref();
     return true; // Don't retry
   }
+  listener_->on_pending_request_count_change(this, 1);
 
   pending_writes_size_ += request_size;
   if (pending_writes_size_ > config_.write_bytes_high_water_mark()) {
@@ -238,7 +252,7 @@ bool Connection::write(Handler* handler, bool flush_immediately) {
             opcode_to_string(handler->request()->opcode()).c_str(), stream);
 
   handler->set_state(Handler::REQUEST_STATE_WRITING);
-  handler->start_timer(loop_,
+  handler->start_timer(timer_wheel_,
                        config_.request_timeout_ms(),
                        handler,
                        Connection::on_timeout);
@@ -295,12 +309,14 @@ void Connection::set_is_available(bool is_available) {
   }
 }
 
-void Connection::consume(char* input, size_t size) {
+void Connection::consume(RefBuffer* read_buffer, char* input, size_t size) {
   char* buffer = input;
   size_t remaining = size;
 
   while (remaining != 0) {
-    int consumed = response_->decode(protocol_version_, buffer, remaining);
+    int consumed = response_->decode(protocol_version_, read_buffer,
+                                     read_buffer != NULL ? read_buffer_size_ : 0,
+                                     buffer, remaining);
     if (consumed <= 0) {
       notify_error("Error consuming message");
       remaining = 0;
@@ -328,6 +344,8 @@ void Connection::consume(char* input, size_t size) {
       } else {
         Handler* handler = NULL;
         if (stream_manager_.get_item(response->stream(), handler)) {
+          if (host_) host_->dec_inflight_request_count();
+          listener_->on_pending_request_count_change(this, -1);
           switch (handler->state()) {
             case Handler::REQUEST_STATE_READING:
               maybe_set_keyspace(response.get());
@@ -429,6 +447,11 @@ void Connection::on_close(uv_handle_t* handle) {
   LOG_DEBUG("Connection to host %s closed",
             connection->addr_string_.c_str());
 
+  if (connection->host_) {
+    connection->host_->dec_inflight_request_count(
+          static_cast<int>(connection->stream_manager_.pending_streams()));
+  }
+
   cleanup_pending_handlers(&connection->pending_reads_);
 
   while (!connection->pending_writes_.is_empty()) {
@@ -452,14 +475,42 @@ void Connection::on_close(uv_handle_t* handle) {
   delete connection;
 }
 
+RefBuffer* Connection::borrow_buffer(size_t* size) {
+  assert(read_buffer_ == NULL && "Read buffer already allocated");
+  if (read_buffer_pool_ != NULL) {
+    read_buffer_ = read_buffer_pool_->borrow();
+    *size = read_buffer_pool_->buffer_size();
+  } else {
+    read_buffer_ = RefBuffer::create(*size);
+    read_buffer_->inc_ref();
+  }
+  read_buffer_size_ = *size;
+  return read_buffer_;
+}
+
+void Connection::release_buffer(RefBuffer* buffer) {
+  if (buffer == NULL) return;
+  if (read_buffer_pool_ != NULL) {
+    read_buffer_pool_->give_back(buffer);
+  } else {
+    buffer->dec_ref();
+  }
+}
+
 #if UV_VERSION_MAJOR == 0
 uv_buf_t Connection::alloc_buffer(uv_handle_t* handle, size_t suggested_size) {
-  return uv_buf_init(new char[suggested_size], suggested_size);
+  Connection* connection = static_cast<Connection*>(handle->data);
+  size_t size = suggested_size;
+  RefBuffer* buffer = connection->borrow_buffer(&size);
+  return uv_buf_init(buffer->data(), size);
 }
 #else
 void Connection::alloc_buffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
-  buf->base = new char[suggested_size];
-  buf->len = suggested_size;
+  Connection* connection = static_cast<Connection*>(handle->data);
+  size_t size = suggested_size;
+  RefBuffer* buffer = connection->borrow_buffer(&size);
+  buf->base = buffer->data();
+  buf->len = size;
 }
 #endif
 
@@ -470,6 +521,10 @@ void Connection::on_read(uv_stream_t* client, ssize_t nread, const uv_buf_t* buf
 #endif
   Connection* connection = static_cast<Connection*>(client->data);
 
+  // libuv always pairs a read callback with the preceding allocation
+  RefBuffer* read_buffer = connection->read_buffer_;
+  connection->read_buffer_ = NULL;
+
   if (nread < 0) {
 #if UV_VERSION_MAJOR == 0
     if (uv_last_error(connection->loop_).code != UV_EOF) {
@@ -481,21 +536,16 @@ void Connection::on_read(uv_stream_t* client, ssize_t nread, const uv_buf_t* buf
                 connection->addr_string_.c_str());
     }
     connection->defunct();
-#if UV_VERSION_MAJOR == 0
-    delete[] buf.base;
-#else
-    delete[] buf->base;
-#endif
+    connection->release_buffer(read_buffer);
     return;
   }
 
 #if UV_VERSION_MAJOR == 0
-  connection->consume(buf.base, nread);
-  delete[] buf.base;
+  connection->consume(read_buffer, buf.base, nread);
 #else
-  connection->consume(buf->base, nread);
-  delete[] buf->base;
+  connection->consume(read_buffer, buf->base, nread);
 #endif
+  connection->release_buffer(read_buffer);
 }
 
 #if UV_VERSION_MAJOR == 0
@@ -542,7 +592,7 @@ void Connection::on_read_ssl(uv_stream_t* client, ssize_t nread, const uv_buf_t*
     char buf[SSL_READ_SIZE];
     int rc =  0;
     while ((rc = ssl_session->decrypt(buf, sizeof(buf))) > 0) {
-      connection->consume(buf, rc);
+      connection->consume(NULL, buf, rc);
     }
     if (rc <= 0 && ssl_session->has_error()) {
       connection->notify_error_ssl("Unable to decrypt data: " + ssl_session->error_message());
@@ -613,10 +663,20 @@ void Connection::on_supported(ResponseMessage* response) {
   SupportedResponse* supported =
       static_cast<SupportedResponse*>(response->response_body().get());
 
-  // TODO(mstump) do something with the supported info
-  (void)supported;
+  std::string compression;
+  if (config_.lz4_compression()) {
+    if (supported->supports_compression(CASS_COMPRESSION_LZ4)) {
+      compression = CASS_COMPRESSION_LZ4;
+    } else {
+      LOG_WARN("LZ4 compression is not supported by host %s",
+               addr_string_.c_str());
+    }
+  }
+
+  write(new StartupHandler(this, new StartupRequest(compression)));
 
-  write(new StartupHandler(this, new StartupRequest()));
+  // The STARTUP message is never compressed, but all following messages are
+  compression_ = compression;
 }
 
 void Connection::on_pending_schema_agreement(Timer* timer) {
@@ -729,12 +789,58 @@ int32_t Connection::PendingWriteBase::write(Handler* handler) {
     return request_size;
   }
 
+  if (!connection_->compression_.empty()) {
+    compressed_frames_.push_back(std::make_pair(last_buffer_size, buffers_.size()));
+  }
+
   size_ += request_size;
   handlers_.add_to_back(handler);
 
   return request_size;
 }
 
+void Connection::PendingWriteBase::compress() {
+  if (compressed_frames_.empty()) return;
+
+  BufferVec buffers;
+  buffers.reserve(buffers_.size());
+
+  size_t index = 0;
+  for (std::vector<std::pair<size_t, size_t> >::const_iterator it = compressed_frames_.begin(),
+       end = compressed_frames_.end(); it != end; ++it) {
+    size_t frame_begin = it->first;
+    size_t frame_end = it->second;
+
+    buffers.insert(buffers.end(),
+                   buffers_.begin() + index, buffers_.begin() + frame_begin);
+    index = frame_end;
+
+    // The first buffer of a frame is its header, the rest are the body
+    Buffer body;
+    if (frame_end - frame_begin > 1 &&
+        Lz4Compressor::compress(buffers_.begin() + frame_begin + 1,
+                                buffers_.begin() + frame_end,
+                                &connection_->compression_buffer_,
+                                &body)) {
+      Buffer header(buffers_[frame_begin]);
+      uint8_t flags = static_cast<uint8_t>(header.data()[1]);
+      header.encode_byte(1, flags | CASS_FLAG_COMPRESSION);
+      header.encode_int32(header.size() - sizeof(int32_t), body.size());
+      buffers.push_back(header);
+      buffers.push_back(body);
+    } else {
+      // Frames without a body (or that failed to compress) are sent as-is
+      buffers.insert(buffers.end(),
+                     buffers_.begin() + frame_begin, buffers_.begin() + frame_end);
+    }
+  }
+
+  buffers.insert(buffers.end(), buffers_.begin() + index, buffers_.end());
+
+  buffers_.swap(buffers);
+  compressed_frames_.clear();
+}
+
 void Connection::PendingWriteBase::on_write(uv_write_t* req, int status) {
   PendingWrite* pending_write = static_cast<PendingWrite*>(req->data);
 
@@ -759,6 +865,8 @@ void Connection::PendingWriteBase::on_write(uv_write_t* req, int status) {
           }
 
           connection->stream_manager_.release_stream(handler->stream());
+          if (connection->host_) connection->host_->dec_inflight_request_count();
+          connection->listener_->on_pending_request_count_change(connection, -1);
           handler->stop_timer();
           handler->set_state(Handler::REQUEST_STATE_DONE);
           handler->on_error(CASS_ERROR_LIB_WRITE_ERROR,
@@ -801,6 +909,8 @@ void Connection::PendingWriteBase::on_write(uv_write_t* req, int status) {
 
 void Connection::PendingWrite::flush() {
   if (!is_flushed_ && !buffers_.empty()) {
+    compress();
+
     UvBufVec bufs;
 
     bufs.reserve(buffers_.size());
@@ -872,6 +982,8 @@ void Connection::PendingWriteSsl::flush() {
   if (!is_flushed_ && !buffers_.empty()) {
     SslSession* ssl_session = connection_->ssl_session_.get();
 
+    compress();
+
     uv_bufs_.reserve(buffers_.size());
 
     for (BufferVec::const_iterator it = buffers_.begin(),
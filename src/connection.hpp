@@ -21,6 +21,8 @@
 #include "buffer.hpp"
 #include "cassandra.h"
 #include "handler.hpp"
+#include "host.hpp"
+#include "indexed_heap.hpp"
 #include "list.hpp"
 #include "macros.hpp"
 #include "metrics.hpp"
@@ -41,10 +43,12 @@ class AuthResponseRequest;
 class Config;
 class Connector;
 class EventResponse;
+class ReadBufferPool;
 class Request;
 class Timer;
 
-class Connection {
+// Pools keep their ready connections in a heap ordered by requests in flight
+class Connection : public IndexedHeap<Connection>::Node {
 public:
   enum ConnectionState {
     CONNECTION_STATE_NEW,
@@ -67,6 +71,9 @@ public:
     virtual void on_ready(Connection* connection) = 0;
     virtual void on_close(Connection* connection) = 0;
     virtual void on_availability_change(Connection* connection) = 0;
+    // The count changed by "delta" (streams still in use when the
+    // connection closes aren't reported)
+    virtual void on_pending_request_count_change(Connection* connection, int delta) = 0;
 
     virtual void on_event(EventResponse* response) = 0;
 
@@ -75,9 +82,12 @@ public:
   };
 
   Connection(uv_loop_t* loop,
+             TimerWheel* timer_wheel,
              const Config& config,
              Metrics* metrics,
+             ReadBufferPool* read_buffer_pool,
              const Address& address,
+             const SharedRefPtr<Host>& host,
              const std::string& keyspace,
              int protocol_version,
              Listener* listener);
@@ -182,6 +192,8 @@ private:
     virtual void flush() = 0;
 
   protected:
+    void compress();
+
     static void on_write(uv_write_t* req, int status);
 
     Connection* connection_;
@@ -191,6 +203,8 @@ private:
     BufferVec buffers_;
     UvBufVec uv_bufs_;
     List<Handler> handlers_;
+    // The [begin, end) buffer ranges of frames that need to be compressed
+    std::vector<std::pair<size_t, size_t> > compressed_frames_;
   };
 
   class PendingWrite : public PendingWriteBase {
@@ -229,7 +243,9 @@ private:
 
   void set_is_available(bool is_available);
   void actually_close();
-  void consume(char* input, size_t size);
+  void consume(RefBuffer* buffer, char* input, size_t size);
+  RefBuffer* borrow_buffer(size_t* size);
+  void release_buffer(RefBuffer* buffer);
   void maybe_set_keyspace(ResponseMessage* response);
 
   static void on_connect(Connector* connecter);
@@ -284,13 +300,20 @@ private:
   List<PendingSchemaAgreement> pending_schema_agreements_;
 
   uv_loop_t* loop_;
+  TimerWheel* timer_wheel_;
   const Config& config_;
   Metrics* metrics_;
+  ReadBufferPool* read_buffer_pool_;
+  RefBuffer* read_buffer_; // The buffer lent to libuv for the current read
+  size_t read_buffer_size_; // The size of the last buffer lent to libuv
   Address address_;
   std::string addr_string_;
   std::string keyspace_;
   const int protocol_version_;
   Listener* listener_;
+  // Tracks the requests in flight to the host, this is empty for the
+  // control connection
+  SharedRefPtr<Host> host_;
 
   ScopedPtr<ResponseMessage> response_;
   StreamManager<Handler*> stream_manager_;
@@ -299,6 +322,7 @@ private:
   uv_tcp_t socket_;
   // supported stuff sent in start up message
   std::string compression_;
+  std::vector<char> compression_buffer_;
   std::string version_;
 
   Timer* connect_timer_;
@@ -52,6 +52,9 @@
 #define CQL_ERROR_ALREADY_EXISTS 0x2400
 #define CQL_ERROR_UNPREPARED 0x2500
 
+// The IO workers' availability for a host is tracked using a fixed size bitmap
+#define CASS_MAX_IO_WORKERS 256
+
 #define CASS_QUERY_FLAG_VALUES 0x01
 #define CASS_QUERY_FLAG_SKIP_METADATA 0x02
 #define CASS_QUERY_FLAG_PAGE_SIZE 0x04
@@ -75,7 +78,14 @@
 #define CASS_EVENT_STATUS_CHANGE 2
 #define CASS_EVENT_SCHEMA_CHANGE 4
 
+#define CASS_VALUE_TYPE_UDT_V3 0x0030
+#define CASS_VALUE_TYPE_TUPLE_V3 0x0031
+
+#define CASS_FLAG_COMPRESSION 0x01
+#define CASS_FLAG_TRACING 0x02
+
 #define CASS_HEADER_SIZE_V1_AND_V2 8
+#define CASS_HEADER_SIZE_V3 9
 
 enum RetryType { RETRY_WITH_CURRENT_HOST, RETRY_WITH_NEXT_HOST };
 
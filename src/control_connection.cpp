@@ -26,6 +26,7 @@
 #include "error_response.hpp"
 #include "result_response.hpp"
 #include "schema_metadata.hpp"
+#include "scoped_lock.hpp"
 #include "session.hpp"
 #include "timer.hpp"
 
@@ -33,7 +34,7 @@
 #include <sstream>
 #include <vector>
 
-#define HIGHEST_SUPPORTED_PROTOCOL_VERSION 2
+#define HIGHEST_SUPPORTED_PROTOCOL_VERSION 3
 
 #define SELECT_LOCAL "SELECT data_center, rack FROM system.local WHERE key='local'"
 #define SELECT_LOCAL_TOKENS "SELECT data_center, rack, partitioner, tokens FROM system.local WHERE key='local'"
@@ -175,9 +176,12 @@ void ControlConnection::reconnect(bool retry_current_host) {
   }
 
   connection_ = new Connection(session_->loop(),
+                               session_->timer_wheel(),
                                session_->config(),
                                session_->metrics(),
+                               NULL, // Infrequent reads, no read buffer pool
                                current_host_address_,
+                               SharedRefPtr<Host>(), // Not counted as host load
                                "", // No keyspace
                                protocol_version_,
                                this);
@@ -295,6 +299,10 @@ void ControlConnection::on_event(EventResponse* response) {
                 response->schema_change(),
                 (int)response->keyspace().size(), response->keyspace().data(),
                 (int)response->table().size(), response->table().data());
+      if (response->schema_change_target() == EventResponse::TYPE) {
+        // User types are not part of the schema metadata
+        break;
+      }
       switch (response->schema_change()) {
         case EventResponse::CREATED:
         case EventResponse::UPDATED:
@@ -344,7 +352,8 @@ void ControlConnection::on_query_meta_all(ControlConnection* control_connection,
 
   Session* session = control_connection->session_;
 
-  session->cluster_meta().clear();
+  // The current token map is used until the refreshed map is built
+  session->cluster_meta().clear(true);
 
   bool is_initial_connection = (control_connection->state_ == CONTROL_STATE_NEW);
 
@@ -407,6 +416,11 @@ void ControlConnection::on_query_meta_all(ControlConnection* control_connection,
                                          static_cast<ResultResponse*>(responses[4]));
   session->cluster_meta().build();
 
+  const std::string& snapshot_file = session->config().topology_snapshot_file();
+  if (!snapshot_file.empty()) {
+    session->cluster_meta().save_topology_snapshot(snapshot_file, session->hosts_);
+  }
+
   if (is_initial_connection) {
     control_connection->state_ = CONTROL_STATE_READY;
     session->on_control_connection_ready();
@@ -547,6 +561,10 @@ void ControlConnection::update_node_info(SharedRefPtr<Host> host, const Row* row
 
   if ((!rack.empty() && rack != host->rack()) ||
       (!dc.empty() && dc != host->dc())) {
+    // Query plans are built from the policy's state while holding the read
+    // lock. The host's placement is swapped atomically because plans read
+    // it after the lock is released.
+    ScopedWriteLock l(&session_->policy_rwlock_);
     if (!host->was_just_added()) {
       session_->load_balancing_policy_->on_remove(host);
     }
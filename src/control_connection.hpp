@@ -165,6 +165,7 @@ private:
   virtual void on_ready(Connection* connection);
   virtual void on_close(Connection* connection);
   virtual void on_availability_change(Connection* connection) {}
+  virtual void on_pending_request_count_change(Connection* connection, int delta) {}
   virtual void on_event(EventResponse* response);
 
   //TODO: possibly reorder callback functions to pair with initiator
@@ -40,11 +40,12 @@ void DCAwarePolicy::init(const SharedRefPtr<Host>& connected_host, const HostMap
 }
 
 CassHostDistance DCAwarePolicy::distance(const SharedRefPtr<Host>& host) const {
-  if (local_dc_.empty() || host->dc() == local_dc_) {
+  const std::string& dc = host->dc();
+  if (local_dc_.empty() || dc == local_dc_) {
     return CASS_HOST_DISTANCE_LOCAL;
   }
 
-  const CopyOnWriteHostVec& hosts = per_remote_dc_live_hosts_.get_hosts(host->dc());
+  const CopyOnWriteHostVec& hosts = per_remote_dc_live_hosts_.get_hosts(dc);
   size_t num_hosts = std::min(hosts->size(), used_hosts_per_remote_dc_);
   for (size_t i = 0; i < num_hosts; ++i) {
     if ((*hosts)[i]->address() == host->address()) {
@@ -55,11 +56,18 @@ CassHostDistance DCAwarePolicy::distance(const SharedRefPtr<Host>& host) const {
   return CASS_HOST_DISTANCE_IGNORE;
 }
 
+bool DCAwarePolicy::is_local_rack(const SharedRefPtr<Host>& host) const {
+  if (local_rack_.empty()) return false;
+  const HostPlacement& placement = host->placement();
+  return placement.rack == local_rack_ && placement.dc == local_dc_;
+}
+
 QueryPlan* DCAwarePolicy::new_query_plan(const std::string& connected_keyspace,
                                         const Request* request,
-                                        const TokenMap& token_map) {
+                                        const TokenMap& token_map,
+                                        QueryPlanAllocator* allocator) {
   CassConsistency cl = request != NULL ? request->consistency() : CASS_CONSISTENCY_ONE;
-  return new DCAwareQueryPlan(this, cl, index_++);
+  return new (allocator) DCAwareQueryPlan(this, cl, index_.fetch_add(1, MEMORY_ORDER_RELAXED));
 }
 
 void DCAwarePolicy::on_add(const SharedRefPtr<Host>& host) {
@@ -71,7 +79,9 @@ void DCAwarePolicy::on_add(const SharedRefPtr<Host>& host) {
     local_dc_ = dc;
   }
 
-  if (dc == local_dc_) {
+  if (is_local_rack(host)) {
+    local_rack_live_hosts_->push_back(host);
+  } else if (dc == local_dc_) {
     local_dc_live_hosts_->push_back(host);
   } else {
     per_remote_dc_live_hosts_.add_host_to_dc(dc, host);
@@ -80,7 +90,9 @@ void DCAwarePolicy::on_add(const SharedRefPtr<Host>& host) {
 
 void DCAwarePolicy::on_remove(const SharedRefPtr<Host>& host) {
   const std::string& dc = host->dc();
-  if (dc == local_dc_) {
+  if (is_local_rack(host)) {
+    remove_host(local_rack_live_hosts_, host);
+  } else if (dc == local_dc_) {
     remove_host(local_dc_live_hosts_, host);
   } else {
     per_remote_dc_live_hosts_.remove_host_from_dc(host->dc(), host);
@@ -145,12 +157,22 @@ DCAwarePolicy::DCAwareQueryPlan::DCAwareQueryPlan(const DCAwarePolicy* policy,
                                                   size_t start_index)
   : policy_(policy)
   , cl_(cl)
+  , local_rack_hosts_(policy_->local_rack_live_hosts_)
   , hosts_(policy_->local_dc_live_hosts_)
+  , local_rack_remaining_(get_hosts_size(local_rack_hosts_))
   , local_remaining_(get_hosts_size(hosts_))
   , remote_remaining_(0)
   , index_(start_index) {}
 
 SharedRefPtr<Host> DCAwarePolicy::DCAwareQueryPlan::compute_next() {
+  while (local_rack_remaining_ > 0) {
+    --local_rack_remaining_;
+    const SharedRefPtr<Host>& host(get_next_host(local_rack_hosts_, index_++));
+    if (host->is_up()) {
+      return host;
+    }
+  }
+
   while (local_remaining_ > 0) {
     --local_remaining_;
     const SharedRefPtr<Host>& host(get_next_host(hosts_, index_++));
@@ -17,6 +17,7 @@
 #ifndef __CASS_DC_AWARE_POLICY_HPP_INCLUDED__
 #define __CASS_DC_AWARE_POLICY_HPP_INCLUDED__
 
+#include "atomic.hpp"
 #include "load_balancing.hpp"
 #include "host.hpp"
 #include "round_robin_policy.hpp"
@@ -34,6 +35,7 @@ public:
   DCAwarePolicy()
       : used_hosts_per_remote_dc_(0)
       , skip_remote_dcs_for_local_cl_(true)
+      , local_rack_live_hosts_(new HostVec)
       , local_dc_live_hosts_(new HostVec)
       , index_(0) {}
 
@@ -43,6 +45,21 @@ public:
       : local_dc_(local_dc)
       , used_hosts_per_remote_dc_(used_hosts_per_remote_dc)
       , skip_remote_dcs_for_local_cl_(skip_remote_dcs_for_local_cl)
+      , local_rack_live_hosts_(new HostVec)
+      , local_dc_live_hosts_(new HostVec)
+      , index_(0) {}
+
+  // Hosts in the local rack of the local DC are tried before the rest of
+  // the local DC. An empty local rack disables the rack preference.
+  DCAwarePolicy(const std::string& local_dc,
+                const std::string& local_rack,
+                size_t used_hosts_per_remote_dc,
+                bool skip_remote_dcs_for_local_cl)
+      : local_dc_(local_dc)
+      , local_rack_(local_rack)
+      , used_hosts_per_remote_dc_(used_hosts_per_remote_dc)
+      , skip_remote_dcs_for_local_cl_(skip_remote_dcs_for_local_cl)
+      , local_rack_live_hosts_(new HostVec)
       , local_dc_live_hosts_(new HostVec)
       , index_(0) {}
 
@@ -50,9 +67,12 @@ public:
 
   virtual CassHostDistance distance(const SharedRefPtr<Host>& host) const;
 
+  virtual bool is_local_rack(const SharedRefPtr<Host>& host) const;
+
   virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
                                     const Request* request,
-                                    const TokenMap& token_map);
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL);
 
   virtual void on_add(const SharedRefPtr<Host>& host);
 
@@ -64,6 +84,7 @@ public:
 
   virtual LoadBalancingPolicy* new_instance() {
     return new DCAwarePolicy(local_dc_,
+                             local_rack_,
                              used_hosts_per_remote_dc_,
                              skip_remote_dcs_for_local_cl_);
   }
@@ -104,20 +125,24 @@ private:
   private:
     const DCAwarePolicy* policy_;
     CassConsistency cl_;
+    CopyOnWriteHostVec local_rack_hosts_;
     CopyOnWriteHostVec hosts_;
     ScopedPtr<PerDCHostMap::KeySet> remote_dcs_;
+    size_t local_rack_remaining_;
     size_t local_remaining_;
     size_t remote_remaining_;
     size_t index_;
   };
 
   std::string local_dc_;
+  std::string local_rack_;
   size_t used_hosts_per_remote_dc_;
   bool skip_remote_dcs_for_local_cl_;
 
+  CopyOnWriteHostVec local_rack_live_hosts_;
   CopyOnWriteHostVec local_dc_live_hosts_;
   PerDCHostMap per_remote_dc_live_hosts_;
-  size_t index_;
+  Atomic<size_t> index_;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(DCAwarePolicy);
@@ -66,8 +66,30 @@ bool EventResponse::decode(int version, char* buffer, size_t size) {
     } else {
       return false;
     }
-    pos = decode_string(pos, &keyspace_, keyspace_size_);
-    decode_string(pos, &table_, table_size_);
+
+    if (version >= 3) {
+      // <change><target><options> where the options are the keyspace for
+      // keyspace changes or the keyspace and name for table and type changes
+      StringRef target;
+      pos = decode_string_ref(pos, &target);
+      if (target == "KEYSPACE") {
+        schema_change_target_ = KEYSPACE;
+        decode_string(pos, &keyspace_, keyspace_size_);
+      } else if (target == "TABLE") {
+        schema_change_target_ = TABLE;
+        pos = decode_string(pos, &keyspace_, keyspace_size_);
+        decode_string(pos, &table_, table_size_);
+      } else if (target == "TYPE") {
+        schema_change_target_ = TYPE;
+        decode_string(pos, &keyspace_, keyspace_size_);
+      } else {
+        return false;
+      }
+    } else {
+      pos = decode_string(pos, &keyspace_, keyspace_size_);
+      decode_string(pos, &table_, table_size_);
+      schema_change_target_ = table_size_ > 0 ? TABLE : KEYSPACE;
+    }
   } else {
     return false;
   }
@@ -44,9 +44,16 @@ public:
     DROPPED
   };
 
+  enum SchemaChangeTarget {
+    KEYSPACE,
+    TABLE,
+    TYPE
+  };
+
   EventResponse()
       : Response(CQL_OPCODE_EVENT)
       , event_type_(0)
+      , schema_change_target_(KEYSPACE)
       , keyspace_(NULL)
       , keyspace_size_(0)
       , table_(NULL)
@@ -72,6 +79,10 @@ public:
     return schema_change_;
   }
 
+  SchemaChangeTarget schema_change_target() const {
+    return schema_change_target_;
+  }
+
   StringRef keyspace() const {
     return StringRef(keyspace_, keyspace_size_);
   }
@@ -88,6 +99,7 @@ private:
   Address affected_node_;
 
   SchemaChange schema_change_;
+  SchemaChangeTarget schema_change_target_;
   char* keyspace_;
   size_t keyspace_size_;
   char* table_;
@@ -21,65 +21,54 @@ namespace cass {
 int ExecuteRequest::encode(int version, BufferVec* bufs) const {
   if (version == 1) {
     return encode_v1(bufs);
-  } else if (version == 2) {
-    return encode_v2(bufs);
+  } else if (version == 2 || version == 3) {
+    return encode_v2(version, bufs);
   } else {
     return ENCODE_ERROR_UNSUPPORTED_PROTOCOL;
   }
 }
 
 int ExecuteRequest::encode_v1(BufferVec* bufs) const {
-  const int version = 1;
+  BufferBuilder builder;
+  encode_v1(&builder);
+  builder.start_encoding(bufs);
+  encode_v1(&builder);
+  return builder.size();
+}
 
-  size_t length = 0;
+void ExecuteRequest::encode_v1(BufferBuilder* builder) const {
+  const int version = 1;
 
   const std::string& prepared_id = prepared_->id();
 
-    // <id> [short bytes] + <n> [short]
-  size_t prepared_buf_size = sizeof(uint16_t) + prepared_id.size() +
-                             sizeof(uint16_t);
-
-  {
-    bufs->push_back(Buffer(prepared_buf_size));
-    length += prepared_buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = buf.encode_string(0,
-                                 prepared_id.data(),
-                                 prepared_id.size());
-    buf.encode_uint16(pos, values_count());
-    // <value_1>...<value_n>
-    length += encode_values(version, bufs);
-  }
-
-  {
-    // <consistency> [short]
-    size_t buf_size = sizeof(uint16_t);
+  // <id> [short bytes] + <n> [short]
+  builder->encode_string(prepared_id.data(), prepared_id.size());
+  builder->encode_uint16(values_count());
 
-    Buffer buf(buf_size);
-    buf.encode_uint16(0, consistency());
-    bufs->push_back(buf);
-    length += buf_size;
-  }
+  // <value_1>...<value_n>
+  encode_values(version, builder);
 
-  return length;
+  // <consistency> [short]
+  builder->encode_uint16(consistency());
 }
 
-int ExecuteRequest::encode_v2(BufferVec* bufs) const {
-  const int version = 2;
+// Versions 2 and 3 use the same request format (the encoding of collection
+// values is handled by the values themselves). The request is sized on the
+// first pass and then written into a single buffer (plus any large values).
+int ExecuteRequest::encode_v2(int version, BufferVec* bufs) const {
+  BufferBuilder builder;
+  encode_v2(version, &builder);
+  builder.start_encoding(bufs);
+  encode_v2(version, &builder);
+  return builder.size();
+}
 
+void ExecuteRequest::encode_v2(int version, BufferBuilder* builder) const {
   uint8_t flags = 0;
-  size_t length = 0;
 
   const std::string& prepared_id = prepared_->id();
 
-    // <id> [short bytes] + <consistency> [short] + <flags> [byte]
-  size_t prepared_buf_size = sizeof(uint16_t) + prepared_id.size() +
-                          sizeof(uint16_t) + sizeof(uint8_t);
-  size_t paging_buf_size = 0;
-
-  if (values_count() > 0) { // <values> = <n><value_1>...<value_n>
-    prepared_buf_size += sizeof(uint16_t); // <n> [short]
+  if (values_count() > 0) {
     flags |= CASS_QUERY_FLAG_VALUES;
   }
 
@@ -88,58 +77,38 @@ int ExecuteRequest::encode_v2(BufferVec* bufs) const {
   }
 
   if (page_size() >= 0) {
-    paging_buf_size += sizeof(int32_t); // [int]
     flags |= CASS_QUERY_FLAG_PAGE_SIZE;
   }
 
   if (!paging_state().empty()) {
-    paging_buf_size += sizeof(int32_t) + paging_state().size(); // [bytes]
     flags |= CASS_QUERY_FLAG_PAGING_STATE;
   }
 
   if (serial_consistency() != 0) {
-    paging_buf_size += sizeof(uint16_t); // [short]
     flags |= CASS_QUERY_FLAG_SERIAL_CONSISTENCY;
   }
 
-  {
-    bufs->push_back(Buffer(prepared_buf_size));
-    length += prepared_buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = buf.encode_string(0,
-                                 prepared_id.data(),
-                                 prepared_id.size());
-    pos = buf.encode_uint16(pos, consistency());
-    pos = buf.encode_byte(pos, flags);
-
-    if (values_count() > 0) {
-      buf.encode_uint16(pos, values_count());
-      length += encode_values(version, bufs);
-    }
-  }
+  // <id> [short bytes] + <consistency> [short] + <flags> [byte]
+  builder->encode_string(prepared_id.data(), prepared_id.size());
+  builder->encode_uint16(consistency());
+  builder->encode_byte(flags);
 
-  if (paging_buf_size > 0) {
-    bufs->push_back(Buffer(paging_buf_size));
-    length += paging_buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = 0;
-
-    if (page_size() >= 0) {
-      pos = buf.encode_int32(pos, page_size());
-    }
+  if (values_count() > 0) { // <values> = <n><value_1>...<value_n>
+    builder->encode_uint16(values_count()); // <n> [short]
+    encode_values(version, builder);
+  }
 
-    if (!paging_state().empty()) {
-      pos = buf.encode_bytes(pos, paging_state().data(), paging_state().size());
-    }
+  if (page_size() >= 0) {
+    builder->encode_int32(page_size()); // [int]
+  }
 
-    if (serial_consistency() != 0) {
-      pos = buf.encode_uint16(pos, serial_consistency());
-    }
+  if (!paging_state().empty()) {
+    builder->encode_bytes(paging_state().data(), paging_state().size()); // [bytes]
   }
 
-  return length;
+  if (serial_consistency() != 0) {
+    builder->encode_uint16(serial_consistency()); // [short]
+  }
 }
 
 } // namespace cass
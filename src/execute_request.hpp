@@ -48,7 +48,9 @@ public:
 private:
   int encode(int version, BufferVec* bufs) const;
   int encode_v1(BufferVec* bufs) const;
-  int encode_v2(BufferVec* bufs) const;
+  void encode_v1(BufferBuilder* builder) const;
+  int encode_v2(int version, BufferVec* bufs) const;
+  void encode_v2(int version, BufferBuilder* builder) const;
 
 private:
   SharedRefPtr<const Prepared> prepared_;
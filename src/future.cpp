@@ -82,7 +82,11 @@ const CassPrepared* cass_future_get_prepared(CassFuture* future) {
       static_cast<cass::ResultResponse*>(response_future->release_result()));
   if (result && result->kind() == CASS_RESULT_KIND_PREPARED) {
     std::vector<std::string> key_aliases;
-    response_future->schema.get_table_key_columns(result->keyspace(), result->table(), &key_aliases);
+    if (response_future->schema_snapshot) {
+      response_future->schema_snapshot->schema().get_table_key_columns(result->keyspace(),
+                                                                       result->table(),
+                                                                       &key_aliases);
+    }
     cass::Prepared* prepared =
         new cass::Prepared(result.release(), response_future->statement, key_aliases);
     prepared->inc_ref();
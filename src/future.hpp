@@ -106,7 +106,24 @@ public:
 
   bool set_callback(Callback callback, void* data);
 
+  // Hides RefCounted<Future>::destroy() so that recyclable futures are
+  // returned to their pool instead of being deleted
+  static void destroy(const Future* future) {
+    const_cast<Future*>(future)->dispose();
+  }
+
 protected:
+  virtual void dispose() { delete this; }
+
+  // Restores the state of a newly created future so that it can be reused
+  void reset() {
+    is_set_ = false;
+    error_.reset();
+    loop_.store(NULL);
+    callback_ = NULL;
+    data_ = NULL;
+  }
+
   void internal_wait(ScopedMutex& lock) {
     while (!is_set_) {
       uv_cond_wait(&cond_, lock.get());
@@ -185,6 +202,13 @@ public:
     return address_;
   }
 
+protected:
+  void reset() {
+    Future::reset();
+    address_ = Address();
+    result_.reset();
+  }
+
 private:
   Address address_;
   ScopedPtr<T> result_;
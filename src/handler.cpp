@@ -27,7 +27,7 @@
 namespace cass {
 
 int32_t Handler::encode(int version, int flags, BufferVec* bufs) const {
-  if (version != 1 && version != 2) {
+  if (version < 1 || version > 3) {
     return Request::ENCODE_ERROR_UNSUPPORTED_PROTOCOL;
   }
 
@@ -40,11 +40,24 @@ int32_t Handler::encode(int version, int flags, BufferVec* bufs) const {
     return length;
   }
 
+  if (version >= 3) {
+    Buffer buf(CASS_HEADER_SIZE_V3);
+    size_t pos = 0;
+    pos = buf.encode_byte(pos, version);
+    pos = buf.encode_byte(pos, flags);
+    pos = buf.encode_uint16(pos, static_cast<uint16_t>(stream_));
+    pos = buf.encode_byte(pos, req->opcode());
+    buf.encode_int32(pos, length);
+    (*bufs)[index] = buf;
+
+    return length + CASS_HEADER_SIZE_V3;
+  }
+
   Buffer buf(CASS_HEADER_SIZE_V1_AND_V2);
   size_t pos = 0;
   pos = buf.encode_byte(pos, version);
   pos = buf.encode_byte(pos, flags);
-  pos = buf.encode_byte(pos, stream_);
+  pos = buf.encode_byte(pos, static_cast<int8_t>(stream_));
   pos = buf.encode_byte(pos, req->opcode());
   buf.encode_int32(pos, length);
   (*bufs)[index] = buf;
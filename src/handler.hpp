@@ -22,6 +22,7 @@
 #include "common.hpp"
 #include "list.hpp"
 #include "scoped_ptr.hpp"
+#include "timer_wheel.hpp"
 
 #include <string>
 #include <uv.h>
@@ -35,57 +36,7 @@ class ResponseMessage;
 
 typedef std::vector<uv_buf_t> UvBufVec;
 
-struct RequestTimer {
-  typedef void (*Callback)(RequestTimer*);
-
-  RequestTimer()
-    : handle_(NULL)
-    , data_(NULL) { }
-
-  ~RequestTimer() {
-    if (handle_ != NULL) {
-      uv_close(copy_cast<uv_timer_t*, uv_handle_t*>(handle_), on_close);
-    }
-  }
-
-  void* data() const { return data_; }
-
-  void start(uv_loop_t* loop, uint64_t timeout, void* data,
-                   Callback cb) {
-    if (handle_ == NULL) {
-      handle_ = new  uv_timer_t;
-      handle_->data = this;
-      uv_timer_init(loop, handle_);
-    }
-    data_ = data;
-    cb_ = cb;
-    uv_timer_start(handle_, on_timeout, timeout, 0);
-  }
-
-  void stop() {
-    if (handle_ != NULL) {
-      uv_timer_stop(handle_);
-    }
-  }
-
-#if UV_VERSION_MAJOR == 0
-  static void on_timeout(uv_timer_t* handle, int status) {
-#else
-  static void on_timeout(uv_timer_t* handle) {
-#endif
-    RequestTimer* timer = static_cast<RequestTimer*>(handle->data);
-    timer->cb_(timer);
-  }
-
-  static void on_close(uv_handle_t* handle) {
-    delete copy_cast<uv_handle_t*, uv_timer_t*>(handle);
-  }
-
-private:
-  uv_timer_t* handle_;
-  void* data_;
-  Callback cb_;
-};
+typedef TimerWheel::Timer RequestTimer;
 
 class Handler : public RefCounted<Handler>, public List<Handler>::Node {
 public:
@@ -122,9 +73,9 @@ public:
     connection_ = connection;
   }
 
-  int8_t stream() const { return stream_; }
+  int16_t stream() const { return stream_; }
 
-  void set_stream(int8_t stream) {
+  void set_stream(int16_t stream) {
     stream_ = stream;
   }
 
@@ -132,21 +83,38 @@ public:
 
   void set_state(State next_state);
 
-  void start_timer(uv_loop_t* loop, uint64_t timeout, void* data,
+  void start_timer(TimerWheel* timer_wheel, uint64_t timeout, void* data,
                    RequestTimer::Callback cb) {
-    timer_.start(loop, timeout, data, cb);
+    timer_.start(timer_wheel, timeout, data, cb);
   }
 
   void stop_timer() {
     timer_.stop();
   }
 
+  // Hides RefCounted<Handler>::destroy() so that recyclable handlers are
+  // returned to their pool instead of being deleted
+  static void destroy(const Handler* handler) {
+    const_cast<Handler*>(handler)->dispose();
+  }
+
 protected:
+  virtual void dispose() { delete this; }
+
+  // Restores the state of a newly created handler so that it can be reused.
+  // This must run on the thread of the loop that started the timer.
+  void reset() {
+    connection_ = NULL;
+    timer_.stop();
+    stream_ = -1;
+    state_ = REQUEST_STATE_NEW;
+  }
+
   Connection* connection_;
 
 private:
   RequestTimer timer_;
-  int8_t stream_;
+  int16_t stream_;
   State state_;
 
 private:
@@ -16,6 +16,8 @@
 
 #include "host.hpp"
 
+#include <algorithm>
+
 namespace cass {
 
 void copy_hosts(const HostMap& from_hosts, CopyOnWriteHostVec& to_hosts) {
@@ -49,30 +51,73 @@ void remove_host(CopyOnWriteHostVec& hosts, const SharedRefPtr<Host>& host) {
   }
 }
 
-void Host::LatencyTracker::update(uint64_t latency_ns) {
+double Host::LatencyTracker::retention(int64_t delay) const {
+  if (delay <= 0) {
+    return 1.0;
+  }
+  double scaled_delay = static_cast<double>(delay) / scale_ns_;
+  return log(scaled_delay + 1) / scaled_delay;
+}
+
+void Host::LatencyTracker::update(uint64_t latency_ns, size_t io_worker_index) {
+  assert(io_worker_index < num_io_workers_);
   uint64_t now = uv_hrtime();
 
-  ScopedSpinlock l(SpinlockPool<LatencyTracker>::get_spinlock(this));
+  AtomicAverage& io_worker_average = io_worker_averages_[io_worker_index];
 
-  TimestampedAverage previous = current_;
+  TimestampedAverage previous = io_worker_average.load();
+  TimestampedAverage current = previous;
 
-  if (previous.num_measured < threshold_to_account_) {
-    current_.average = -1;
+  // Each IO worker only discards its share of the warm-up measurements so
+  // that the host's warm-up isn't multiplied by the number of IO workers.
+  uint64_t threshold_to_account = (threshold_to_account_ + num_io_workers_ - 1) / num_io_workers_;
+
+  if (previous.num_measured < threshold_to_account) {
+    current.average = -1;
   } else if (previous.average < 0) {
-    current_.average = latency_ns;
+    current.average = latency_ns;
   } else {
     int64_t delay = now - previous.timestamp;
     if (delay <= 0) {
       return;
     }
 
-    double scaled_delay = static_cast<double>(delay) / scale_ns_;
-    double weight = log(scaled_delay + 1) / scaled_delay;
-    current_.average = static_cast<int64_t>((1.0 - weight) * latency_ns + weight * previous.average);
+    double weight = retention(delay);
+    current.average = static_cast<int64_t>((1.0 - weight) * latency_ns + weight * previous.average);
+  }
+
+  current.num_measured = previous.num_measured + 1;
+  current.timestamp = now;
+
+  io_worker_average.store(current);
+}
+
+void Host::LatencyTracker::merge() {
+  // The IO workers' averages are weighted by how recently they were updated
+  // using the same decay as the moving average. Weighting by the number of
+  // measurements would let an IO worker that stopped receiving requests hide
+  // the recent latencies seen by the others.
+  uint64_t now = uv_hrtime();
+  TimestampedAverage merged;
+  double weighted_sum = 0.0;
+  double total_weight = 0.0;
+
+  for (size_t i = 0; i < num_io_workers_; ++i) {
+    TimestampedAverage average = io_worker_averages_[i].load();
+    merged.num_measured += average.num_measured;
+    merged.timestamp = std::max(merged.timestamp, average.timestamp);
+    if (average.average >= 0) {
+      double weight = retention(static_cast<int64_t>(now - average.timestamp));
+      weighted_sum += static_cast<double>(average.average) * weight;
+      total_weight += weight;
+    }
+  }
+
+  if (total_weight > 0) {
+    merged.average = static_cast<int64_t>(weighted_sum / total_weight + 0.5);
   }
 
-  current_.num_measured = previous.num_measured + 1;
-  current_.timestamp = now;
+  current_.store(merged);
 }
 
 } // namespace cass
@@ -19,14 +19,16 @@
 
 #include "address.hpp"
 #include "atomic.hpp"
+#include "constants.hpp"
 #include "copy_on_write_ptr.hpp"
 #include "get_time.hpp"
 #include "logger.hpp"
 #include "macros.hpp"
 #include "ref_counted.hpp"
 #include "scoped_ptr.hpp"
-#include "spin_lock.hpp"
 
+#include <assert.h>
+#include <list>
 #include <map>
 #include <math.h>
 #include <set>
@@ -46,6 +48,16 @@ struct TimestampedAverage {
   uint64_t num_measured;
 };
 
+struct HostPlacement {
+  HostPlacement() {}
+  HostPlacement(const std::string& rack, const std::string& dc)
+    : rack(rack)
+    , dc(dc) {}
+
+  std::string rack;
+  std::string dc;
+};
+
 class Host : public RefCounted<Host> {
 public:
   class StateListener {
@@ -63,21 +75,37 @@ public:
     DOWN
   };
 
-  Host(const Address& address, bool mark)
+  Host(const Address& address, bool mark, size_t num_io_workers = 1)
       : address_(address)
       , mark_(mark)
-      , state_(ADDED) {}
+      , state_(ADDED)
+      , inflight_request_count_(0)
+      , num_io_workers_(num_io_workers)
+      , placements_(1) {
+    placement_.store(&placements_.back(), MEMORY_ORDER_RELAXED);
+    for (size_t i = 0; i < AVAILABLE_IO_WORKER_WORDS; ++i) {
+      available_io_workers_[i].store(0, MEMORY_ORDER_RELAXED);
+    }
+  }
 
   const Address& address() const { return address_; }
 
   bool mark() const { return mark_; }
   void set_mark(bool mark) { mark_ = mark; }
 
-  const std::string& rack() const { return rack_; }
-  const std::string& dc() const { return dc_; } 
+  // The placement is read without locks by query plans. A placement is
+  // never modified or freed once it's published so the references stay
+  // valid for the lifetime of the host. Use placement() to read the rack
+  // and DC of the same placement.
+  const HostPlacement& placement() const { return *placement_.load(MEMORY_ORDER_ACQUIRE); }
+  const std::string& rack() const { return placement().rack; }
+  const std::string& dc() const { return placement().dc; }
+
+  // Only called from the session thread. The previous placements are kept
+  // because readers could still reference them, hosts rarely move.
   void set_rack_and_dc(const std::string& rack, const std::string& dc) {
-    rack_ = rack;
-    dc_ = dc;
+    placements_.push_back(HostPlacement(rack, dc));
+    placement_.store(&placements_.back(), MEMORY_ORDER_RELEASE);
   }
 
   const std::string& listen_address() const { return listen_address_; }
@@ -92,25 +120,68 @@ public:
   bool is_down() const { return state() == DOWN; }
   void set_down() { set_state(DOWN); }
 
+  // Whether the IO worker has a pool that can take requests for this host.
+  // Updated by the IO workers and read without locks on the request path.
+  bool is_available(size_t io_worker_index) const {
+    assert(io_worker_index < CASS_MAX_IO_WORKERS);
+    return (available_io_workers_[io_worker_index / 32].load(MEMORY_ORDER_RELAXED) &
+            (1U << (io_worker_index % 32))) != 0;
+  }
+
+  void set_available(size_t io_worker_index, bool is_available) {
+    assert(io_worker_index < CASS_MAX_IO_WORKERS);
+    Atomic<uint32_t>& word = available_io_workers_[io_worker_index / 32];
+    uint32_t bit = 1U << (io_worker_index % 32);
+    uint32_t expected = word.load(MEMORY_ORDER_RELAXED);
+    uint32_t desired;
+    do {
+      desired = is_available ? (expected | bit) : (expected & ~bit);
+    } while (!word.compare_exchange_weak(expected, desired));
+  }
+
+  // Requests in flight to the host across all IO workers. It's only used as
+  // an indication of load, so relaxed ordering is enough.
+  int inflight_request_count() const {
+    return inflight_request_count_.load(MEMORY_ORDER_RELAXED);
+  }
+  void inc_inflight_request_count() {
+    inflight_request_count_.fetch_add(1, MEMORY_ORDER_RELAXED);
+  }
+  void dec_inflight_request_count(int count = 1) {
+    inflight_request_count_.fetch_sub(count, MEMORY_ORDER_RELAXED);
+  }
+
   std::string to_string() const {
     std::ostringstream ss;
     ss << address_.to_string();
-    if (!rack_.empty() || !dc_.empty()) {
-      ss << " [" << rack_ << ':' << dc_ << "]";
+    const HostPlacement& placement = this->placement();
+    if (!placement.rack.empty() || !placement.dc.empty()) {
+      ss << " [" << placement.rack << ':' << placement.dc << "]";
     }
     return ss.str();
   }
 
   void enable_latency_tracking(uint64_t scale, uint64_t min_measured) {
     if (!latency_tracker_) {
-      latency_tracker_.reset(new LatencyTracker(scale, (30LL * min_measured) / 100LL));
+      latency_tracker_.reset(new LatencyTracker(scale, (30LL * min_measured) / 100LL,
+                                                num_io_workers_));
     }
   }
 
-  void update_latency(uint64_t latency_ns) {
+  // Only the IO worker with the given index records latencies into its own
+  // average. They're not visible until they're merged.
+  void update_latency(uint64_t latency_ns, size_t io_worker_index = 0) {
     if (latency_tracker_) {
       LOG_TRACE("Latency %f ms for %s", static_cast<double>(latency_ns) / 1e6, to_string().c_str());
-      latency_tracker_->update(latency_ns);
+      latency_tracker_->update(latency_ns, io_worker_index);
+    }
+  }
+
+  // Merges the IO workers' averages into the current average. This is done
+  // periodically and it's safe to be done by more than one thread.
+  void merge_latencies() {
+    if (latency_tracker_) {
+      latency_tracker_->merge();
     }
   }
 
@@ -124,21 +195,64 @@ public:
 private:
   class LatencyTracker {
   public:
-    LatencyTracker(uint64_t scale_ns, uint64_t threshold_to_account)
+    LatencyTracker(uint64_t scale_ns, uint64_t threshold_to_account,
+                   size_t num_io_workers)
       : scale_ns_(scale_ns)
-      , threshold_to_account_(threshold_to_account) {}
+      , threshold_to_account_(threshold_to_account)
+      , num_io_workers_(num_io_workers)
+      , io_worker_averages_(new AtomicAverage[num_io_workers]) {}
+
+    void update(uint64_t latency_ns, size_t io_worker_index);
 
-    void update(uint64_t latency_ns);
+    void merge();
 
     TimestampedAverage get() const {
-      ScopedSpinlock l(SpinlockPool<LatencyTracker>::get_spinlock(this));
-      return current_;
+      return current_.load();
     }
 
   private:
+    // The weight an average keeps after the given delay (in ns)
+    double retention(int64_t delay) const;
+
+    // The fields are only ever written by a single thread and a reader
+    // could see them from different updates. That's fine for an average
+    // that's only used to rank hosts.
+    class AtomicAverage {
+    public:
+      AtomicAverage()
+        : average_(-1)
+        , timestamp_(0)
+        , num_measured_(0) {}
+
+      TimestampedAverage load() const {
+        TimestampedAverage result;
+        result.average = average_.load(MEMORY_ORDER_RELAXED);
+        result.timestamp = timestamp_.load(MEMORY_ORDER_RELAXED);
+        result.num_measured = num_measured_.load(MEMORY_ORDER_RELAXED);
+        return result;
+      }
+
+      void store(const TimestampedAverage& average) {
+        average_.store(average.average, MEMORY_ORDER_RELAXED);
+        timestamp_.store(average.timestamp, MEMORY_ORDER_RELAXED);
+        num_measured_.store(average.num_measured, MEMORY_ORDER_RELAXED);
+      }
+
+    private:
+      Atomic<int64_t> average_;
+      Atomic<uint64_t> timestamp_;
+      Atomic<uint64_t> num_measured_;
+
+      static const size_t cacheline_size = 64;
+      char pad__[cacheline_size];
+      void no_unused_private_warning__() { pad__[0] = 0; }
+    };
+
     uint64_t scale_ns_;
     uint64_t threshold_to_account_;
-    TimestampedAverage current_;
+    size_t num_io_workers_;
+    ScopedPtr<AtomicAverage[]> io_worker_averages_;
+    AtomicAverage current_;
 
   private:
     DISALLOW_COPY_AND_ASSIGN(LatencyTracker);
@@ -153,12 +267,17 @@ private:
     state_.store(state, MEMORY_ORDER_RELEASE);
   }
 
+  static const size_t AVAILABLE_IO_WORKER_WORDS = (CASS_MAX_IO_WORKERS + 31) / 32;
+
   Address address_;
   bool mark_;
   Atomic<HostState> state_;
+  Atomic<uint32_t> available_io_workers_[AVAILABLE_IO_WORKER_WORDS];
+  Atomic<int> inflight_request_count_;
+  size_t num_io_workers_;
   std::string listen_address_;
-  std::string rack_;
-  std::string dc_;
+  Atomic<const HostPlacement*> placement_;
+  std::list<HostPlacement> placements_;
 
   ScopedPtr<LatencyTracker> latency_tracker_;
 
@@ -0,0 +1,150 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_INDEXED_HEAP_HPP_INCLUDED__
+#define __CASS_INDEXED_HEAP_HPP_INCLUDED__
+
+#include "macros.hpp"
+
+#include <assert.h>
+#include <stddef.h>
+#include <vector>
+
+namespace cass {
+
+// An intrusive binary min-heap. Every item knows its position in the heap so
+// it can be removed, or moved after its key changes, in O(log n) without
+// searching for it. An item can only be in one heap at a time.
+template <class T>
+class IndexedHeap {
+public:
+  typedef bool (*Compare)(const T* a, const T* b);
+
+  class Node {
+  public:
+    Node()
+      : heap_index_(NOT_IN_HEAP) {}
+
+    bool is_in_heap() const { return heap_index_ != NOT_IN_HEAP; }
+
+  private:
+    friend class IndexedHeap;
+    static const size_t NOT_IN_HEAP = static_cast<size_t>(-1);
+    size_t heap_index_;
+  };
+
+  IndexedHeap(Compare compare)
+    : compare_(compare) {}
+
+  bool is_empty() const { return items_.empty(); }
+  size_t size() const { return items_.size(); }
+
+  // The least item
+  T* top() const {
+    assert(!items_.empty());
+    return items_.front();
+  }
+
+  void push(T* item) {
+    assert(!item->is_in_heap());
+    items_.push_back(item);
+    set_index(items_.size() - 1);
+    sift_up(items_.size() - 1);
+  }
+
+  void remove(T* item) {
+    assert(is_item(item));
+    size_t index = node(item)->heap_index_;
+    node(item)->heap_index_ = Node::NOT_IN_HEAP;
+    T* last = items_.back();
+    items_.pop_back();
+    if (index < items_.size()) {
+      items_[index] = last;
+      set_index(index);
+      update_at(index);
+    }
+  }
+
+  // Restores the heap order after the item's key has changed
+  void update(T* item) {
+    assert(is_item(item));
+    update_at(node(item)->heap_index_);
+  }
+
+private:
+  static Node* node(T* item) { return static_cast<Node*>(item); }
+
+  bool is_item(T* item) const {
+    size_t index = node(item)->heap_index_;
+    return index < items_.size() && items_[index] == item;
+  }
+
+  void set_index(size_t index) {
+    node(items_[index])->heap_index_ = index;
+  }
+
+  void swap(size_t a, size_t b) {
+    T* temp = items_[a];
+    items_[a] = items_[b];
+    items_[b] = temp;
+    set_index(a);
+    set_index(b);
+  }
+
+  void update_at(size_t index) {
+    if (index > 0 && compare_(items_[index], items_[(index - 1) / 2])) {
+      sift_up(index);
+    } else {
+      sift_down(index);
+    }
+  }
+
+  void sift_up(size_t index) {
+    while (index > 0) {
+      size_t parent = (index - 1) / 2;
+      if (!compare_(items_[index], items_[parent])) break;
+      swap(index, parent);
+      index = parent;
+    }
+  }
+
+  void sift_down(size_t index) {
+    while (true) {
+      size_t least = index;
+      size_t left = 2 * index + 1;
+      size_t right = left + 1;
+      if (left < items_.size() && compare_(items_[left], items_[least])) {
+        least = left;
+      }
+      if (right < items_.size() && compare_(items_[right], items_[least])) {
+        least = right;
+      }
+      if (least == index) break;
+      swap(index, least);
+      index = least;
+    }
+  }
+
+  Compare compare_;
+  std::vector<T*> items_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(IndexedHeap);
+};
+
+} // namespace cass
+
+#endif
@@ -22,26 +22,31 @@
 #include "request_handler.hpp"
 #include "session.hpp"
 #include "scoped_lock.hpp"
+#include "speculative_execution.hpp"
 #include "timer.hpp"
 
 namespace cass {
 
-IOWorker::IOWorker(Session* session)
+static const uint64_t PERCENTILE_DELAY_UPDATE_RATE_MS = 1000;
+
+IOWorker::IOWorker(Session* session, size_t index)
     : session_(session)
     , config_(session->config())
     , metrics_(session->metrics())
+    , index_(index)
     , protocol_version_(-1)
     , is_closing_(false)
     , pending_request_count_(0)
+    , percentile_delay_ms_(0)
+    , percentile_delay_updated_ms_(0)
     , request_queue_(config_.queue_size_io()) {
   prepare_.data = this;
+  keyspace_.store(&*keyspaces_.insert(std::string()).first, MEMORY_ORDER_RELAXED);
   uv_mutex_init(&keyspace_mutex_);
-  uv_mutex_init(&unavailable_addresses_mutex_);
 }
 
 IOWorker::~IOWorker() {
   uv_mutex_destroy(&keyspace_mutex_);
-  uv_mutex_destroy(&unavailable_addresses_mutex_);
 }
 
 int IOWorker::init() {
@@ -49,6 +54,8 @@ int IOWorker::init() {
   if (rc != 0) return rc;
   rc = request_queue_.init(loop(), this, &IOWorker::on_execute);
   if (rc != 0) return rc;
+  rc = timer_wheel_.init(loop());
+  if (rc != 0) return rc;
   rc = uv_prepare_init(loop(), &prepare_);
   if (rc != 0) return rc;
   rc = uv_prepare_start(&prepare_, on_prepare);
@@ -56,26 +63,10 @@ int IOWorker::init() {
   return rc;
 }
 
-std::string IOWorker::keyspace() {
-  // Not returned by reference on purpose. This memory can't be shared
-  // because it could be updated as a result of a "USE <keyspace" query.
-  ScopedMutex lock(&keyspace_mutex_);
-  return keyspace_;
-}
-
 void IOWorker::set_keyspace(const std::string& keyspace) {
+  // Only serializes writers, "USE <keyspace>" can run on any IO worker
   ScopedMutex lock(&keyspace_mutex_);
-  keyspace_ = keyspace;
-}
-
-bool IOWorker::is_current_keyspace(const std::string& keyspace) {
-  // This mutex is locked on the query request path, but it should
-  // almost never have any contention. That could only happen when
-  // there is a "USE <keyspace>" query.  These *should* happen
-  // infrequently. This is preferred over IOWorker::keyspace()
-  // because it doesn't allocate memory.
-  ScopedMutex lock(&keyspace_mutex_);
-  return keyspace_ == keyspace;
+  keyspace_.store(&*keyspaces_.insert(keyspace).first, MEMORY_ORDER_RELEASE);
 }
 
 void IOWorker::broadcast_keyspace_change(const std::string& keyspace) {
@@ -89,19 +80,14 @@ bool IOWorker::is_host_up(const Address& address) const {
 }
 
 void IOWorker::set_host_is_available(const Address& address, bool is_available) {
-  ScopedMutex lock(&unavailable_addresses_mutex_);
-  if (is_available) {
-    unavailable_addresses_.erase(address);
-  } else {
-    unavailable_addresses_.insert(address);
+  // This only runs when a pool's availability changes so the hosts lock is
+  // only taken here and not on the request path
+  SharedRefPtr<Host> host(session_->get_host(address));
+  if (host) {
+    host->set_available(index_, is_available);
   }
 }
 
-bool IOWorker::is_host_available(const Address& address) {
-  ScopedMutex lock(&unavailable_addresses_mutex_);
-  return unavailable_addresses_.count(address) == 0;
-}
-
 bool IOWorker::add_pool_async(const Address& address, bool is_initial_connection) {
   IOWorkerEvent event;
   event.type = IOWorkerEvent::ADD_POOL;
@@ -131,7 +117,9 @@ void IOWorker::add_pool(const Address& address, bool is_initial_connection) {
 
     set_host_is_available(address, false);
 
-    SharedRefPtr<Pool> pool(new Pool(this, address, is_initial_connection));
+    SharedRefPtr<Pool> pool(new Pool(this, address,
+                                     session_->get_host(address),
+                                     is_initial_connection));
     pools_[address] = pool;
     pool->connect();
   }
@@ -141,6 +129,39 @@ bool IOWorker::execute(RequestHandler* request_handler) {
   return request_queue_.enqueue(request_handler);
 }
 
+bool IOWorker::execute_speculative(SpeculativeExecution* speculative_execution) {
+  PoolMap::iterator it = pools_.find(speculative_execution->host()->address());
+  if (it == pools_.end() || !it->second->is_ready()) {
+    return false;
+  }
+  return it->second->write(speculative_execution);
+}
+
+bool IOWorker::speculative_execution_delay(uint64_t* delay_ms) {
+  if (!config_.is_speculative_execution_delay_percentile()) {
+    *delay_ms = config_.speculative_execution_delay_ms();
+    return true;
+  }
+
+  // Computing the percentile merges the histograms of every thread so it's
+  // only refreshed periodically
+  uint64_t now = uv_now(loop());
+  if (percentile_delay_updated_ms_ == 0 ||
+      now - percentile_delay_updated_ms_ >= PERCENTILE_DELAY_UPDATE_RATE_MS) {
+    Metrics::Histogram::Snapshot snapshot;
+    metrics_->request_latencies.get_snapshot(&snapshot);
+    // Latencies are recorded in microseconds
+    percentile_delay_ms_ = (snapshot.percentile_99th + 999) / 1000;
+    percentile_delay_updated_ms_ = now;
+  }
+
+  if (percentile_delay_ms_ == 0) {
+    return false;
+  }
+  *delay_ms = percentile_delay_ms_;
+  return true;
+}
+
 void IOWorker::retry(RequestHandler* request_handler, RetryType retry_type) {
   if (retry_type == RETRY_WITH_NEXT_HOST) {
     request_handler->next_host();
@@ -157,6 +178,12 @@ void IOWorker::retry(RequestHandler* request_handler, RetryType retry_type) {
   PoolMap::iterator it = pools_.find(address);
   if (it != pools_.end() && it->second->is_ready()) {
     const SharedRefPtr<Pool>& pool = it->second;
+    if (pool->is_limited()) {
+      LOG_TRACE("Concurrency limit reached for host %s, trying the next host",
+                address.to_string().c_str());
+      retry(request_handler, RETRY_WITH_NEXT_HOST);
+      return;
+    }
     Connection* connection = pool->borrow_connection();
     if (connection != NULL) {
       if (!pool->write(connection, request_handler)) {
@@ -240,6 +267,7 @@ void IOWorker::maybe_notify_closed() {
 void IOWorker::close_handles() {
   EventThread<IOWorkerEvent>::close_handles();
   request_queue_.close_handles();
+  timer_wheel_.close_handles();
   uv_prepare_stop(&prepare_);
   uv_close(copy_cast<uv_prepare_t*, uv_handle_t*>(&prepare_), NULL);
 
@@ -251,6 +279,12 @@ void IOWorker::close_handles() {
               static_cast<void*>(this));
     it->second.stop_timer();
   }
+  LOG_DEBUG("Read buffer pool stats for io_worker(%p): hit rate %.2f%% (%llu of %llu), peak in use %u",
+            static_cast<void*>(this),
+            read_buffer_pool_.hit_rate() * 100.0,
+            static_cast<unsigned long long>(read_buffer_pool_.hit_count()),
+            static_cast<unsigned long long>(read_buffer_pool_.borrow_count()),
+            static_cast<unsigned int>(read_buffer_pool_.peak_in_use_count()));
   LOG_DEBUG("Active handles following close: %d", loop()->active_handles);
 }
 
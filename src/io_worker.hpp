@@ -22,12 +22,16 @@
 #include "async_queue.hpp"
 #include "constants.hpp"
 #include "event_thread.hpp"
+#include "host.hpp"
 #include "logger.hpp"
 #include "metrics.hpp"
-#include "spsc_queue.hpp"
+#include "mpmc_queue.hpp"
+#include "read_buffer_pool.hpp"
 #include "timer.hpp"
+#include "timer_wheel.hpp"
 
 #include <map>
+#include <set>
 #include <string>
 #include <uv.h>
 
@@ -37,6 +41,7 @@ class Config;
 class Pool;
 class RequestHandler;
 class Session;
+class SpeculativeExecution;
 class SSLContext;
 class Timer;
 
@@ -60,13 +65,15 @@ class IOWorker
     : public EventThread<IOWorkerEvent>
     , public RefCounted<IOWorker> {
 public:
-  IOWorker(Session* session);
+  IOWorker(Session* session, size_t index);
   ~IOWorker();
 
   int init();
 
   const Config& config() const { return config_; }
   Metrics* metrics() const { return metrics_; }
+  ReadBufferPool* read_buffer_pool() { return &read_buffer_pool_; }
+  TimerWheel* timer_wheel() { return &timer_wheel_; }
 
   int protocol_version() const {
     return protocol_version_.load();
@@ -75,14 +82,23 @@ public:
     protocol_version_.store(protocol_version);
   }
 
-  std::string keyspace();
+  size_t index() const { return index_; }
+
+  // The returned string is never modified or freed while the IO worker exists
+  const std::string& keyspace() const {
+    return *keyspace_.load(MEMORY_ORDER_ACQUIRE);
+  }
   void set_keyspace(const std::string& keyspace);
 
-  bool is_current_keyspace(const std::string& keyspace);
+  bool is_current_keyspace(const std::string& keyspace) const {
+    return keyspace == this->keyspace();
+  }
   void broadcast_keyspace_change(const std::string& keyspace);
 
   void set_host_is_available(const Address& address, bool is_available);
-  bool is_host_available(const Address& address);
+  bool is_host_available(const Host& host) const {
+    return host.is_available(index_);
+  }
 
   bool is_host_up(const Address& address) const;
 
@@ -91,6 +107,11 @@ public:
   void close_async();
 
   bool execute(RequestHandler* request_handler);
+  bool execute_speculative(SpeculativeExecution* speculative_execution);
+
+  // Returns false if there's no delay yet, the percentile delay needs
+  // recorded latencies
+  bool speculative_execution_delay(uint64_t* delay_ms);
 
   void retry(RequestHandler* request_handler, RetryType retry_type);
   void request_finished(RequestHandler* request_handler);
@@ -140,22 +161,32 @@ private:
   Session* session_;
   const Config& config_;
   Metrics* metrics_;
+  size_t index_;
   Atomic<int> protocol_version_;
   uv_prepare_t prepare_;
 
-  std::string keyspace_;
+  // Every keyspace that's been used is kept so the current keyspace can be
+  // published as a pointer that readers never have to lock or copy.
+  // Keyspace changes are rare so this only grows by the distinct keyspaces.
+  std::set<std::string> keyspaces_;
+  Atomic<const std::string*> keyspace_;
   uv_mutex_t keyspace_mutex_;
 
-  AddressSet unavailable_addresses_;
-  uv_mutex_t unavailable_addresses_mutex_;
-
   PoolMap pools_;
   PoolVec pools_pending_flush_;
   bool is_closing_;
   int pending_request_count_;
   PendingReconnectMap pending_reconnects_;
+  ReadBufferPool read_buffer_pool_;
+
+  // Request and pending connection timeouts share a single uv timer
+  TimerWheel timer_wheel_;
+
+  uint64_t percentile_delay_ms_;
+  uint64_t percentile_delay_updated_ms_;
 
-  AsyncQueue<SPSCQueue<RequestHandler*> > request_queue_;
+  // Requests are enqueued directly by application threads
+  AsyncQueue<MPMCQueue<RequestHandler*> > request_queue_;
 };
 
 } // namespace cass
@@ -36,19 +36,25 @@ void LatencyAwarePolicy::register_handles(uv_loop_t* loop) {
                                                     this,
                                                     LatencyAwarePolicy::on_work,
                                                     LatencyAwarePolicy::on_after_work);
+  ChainedLoadBalancingPolicy::register_handles(loop);
 }
 
 void LatencyAwarePolicy::close_handles() {
   if (calculate_min_average_task_ != NULL) {
     PeriodicTask::stop(calculate_min_average_task_);
   }
+  ChainedLoadBalancingPolicy::close_handles();
 }
 
 QueryPlan* LatencyAwarePolicy::new_query_plan(const std::string& connected_keyspace,
                                               const Request* request,
-                                              const TokenMap& token_map) {
-  return new LatencyAwareQueryPlan(this,
-                                   child_policy_->new_query_plan(connected_keyspace, request, token_map));
+                                              const TokenMap& token_map,
+                                              QueryPlanAllocator* allocator) {
+  return new (allocator) LatencyAwareQueryPlan(this,
+                                               child_policy_->new_query_plan(connected_keyspace,
+                                                                             request,
+                                                                             token_map,
+                                                                             allocator));
 }
 
 void LatencyAwarePolicy::on_add(const SharedRefPtr<Host>& host) {
@@ -113,6 +119,7 @@ void LatencyAwarePolicy::on_work(PeriodicTask* task) {
 
   for (HostVec::const_iterator i = hosts->begin(),
        end = hosts->end(); i != end; ++i) {
+    (*i)->merge_latencies();
     TimestampedAverage latency = (*i)->get_current_average();
     if (latency.average >= 0
         && latency.num_measured >= settings.min_measured
@@ -18,6 +18,7 @@
 #define __CASS_LATENCY_AWARE_POLICY_HPP_INCLUDED__
 
 #include "atomic.hpp"
+#include "fixed_vector.hpp"
 #include "load_balancing.hpp"
 #include "macros.hpp"
 #include "periodic_task.hpp"
@@ -58,7 +59,8 @@ public:
 
   virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
                                     const Request* request,
-                                    const TokenMap& token_map);
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL);
 
   virtual LoadBalancingPolicy* new_instance() {
     return new LatencyAwarePolicy(child_policy_->new_instance(), settings_);
@@ -76,6 +78,9 @@ public:
   }
 
 private:
+  // The number of skipped hosts a query plan can hold without using the heap
+  static const size_t FIXED_SKIPPED_SIZE = 4;
+
   class LatencyAwareQueryPlan : public QueryPlan {
   public:
     LatencyAwareQueryPlan(LatencyAwarePolicy* policy, QueryPlan* child_plan)
@@ -89,7 +94,7 @@ private:
     LatencyAwarePolicy* policy_;
     ScopedPtr<QueryPlan> child_plan_;
 
-    HostVec skipped_;
+    FixedVector<SharedRefPtr<Host>, FIXED_SKIPPED_SIZE> skipped_;
     size_t skipped_index_;
   };
 
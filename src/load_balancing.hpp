@@ -17,12 +17,15 @@
 #ifndef __CASS_LOAD_BALANCING_HPP_INCLUDED__
 #define __CASS_LOAD_BALANCING_HPP_INCLUDED__
 
+#include "aligned_storage.hpp"
 #include "cassandra.h"
 #include "constants.hpp"
 #include "host.hpp"
+#include "macros.hpp"
 #include "request.hpp"
 
 #include <list>
+#include <new>
 #include <set>
 #include <string>
 
@@ -58,11 +61,63 @@ inline bool is_dc_local(CassConsistency cl) {
   return cl == CASS_CONSISTENCY_LOCAL_ONE || cl == CASS_CONSISTENCY_LOCAL_QUORUM;
 }
 
+// Fixed size storage for a request's chain of query plans so that creating
+// a plan doesn't use the heap. Plans that don't fit are allocated on the heap
+// instead. The storage is reused by calling reset() once all of the plans
+// allocated from it have been deleted.
+class QueryPlanAllocator {
+public:
+  static const size_t FIXED_SIZE = 1024;
+  static const size_t ALIGNMENT = 16;
+
+  QueryPlanAllocator()
+    : used_(0) {}
+
+  // Returns NULL if there's not enough space left
+  void* allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size > FIXED_SIZE - used_) return NULL;
+    void* ptr = static_cast<char*>(fixed_.address()) + used_;
+    used_ += size;
+    return ptr;
+  }
+
+  void reset() { used_ = 0; }
+
+  size_t used() const { return used_; }
+
+private:
+  AlignedStorage<FIXED_SIZE, ALIGNMENT> fixed_;
+  size_t used_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(QueryPlanAllocator);
+};
+
 class QueryPlan {
 public:
   virtual ~QueryPlan() {}
   virtual SharedRefPtr<Host> compute_next() = 0;
 
+  // Plans are created with "new (allocator) Plan(...)". A NULL allocator
+  // uses the heap. Either way they're deleted normally, which only releases
+  // plans that were allocated on the heap.
+  static void* operator new(size_t size) {
+    return allocate(size, NULL);
+  }
+
+  static void* operator new(size_t size, QueryPlanAllocator* allocator) {
+    return allocate(size, allocator);
+  }
+
+  static void operator delete(void* ptr) {
+    deallocate(ptr);
+  }
+
+  static void operator delete(void* ptr, QueryPlanAllocator* allocator) {
+    deallocate(ptr);
+  }
+
   bool compute_next(Address* address) {
     SharedRefPtr<Host> host = compute_next();
     if (host) {
@@ -71,6 +126,31 @@ public:
     }
     return false;
   }
+
+private:
+  // Every plan is prefixed with whether it was allocated on the heap
+  static const size_t HEADER_SIZE = QueryPlanAllocator::ALIGNMENT;
+
+  static void* allocate(size_t size, QueryPlanAllocator* allocator) {
+    char* ptr = NULL;
+    if (allocator != NULL) {
+      ptr = static_cast<char*>(allocator->allocate(HEADER_SIZE + size));
+    }
+    bool is_heap = ptr == NULL;
+    if (is_heap) {
+      ptr = static_cast<char*>(::operator new(HEADER_SIZE + size));
+    }
+    *reinterpret_cast<bool*>(ptr) = is_heap;
+    return ptr + HEADER_SIZE;
+  }
+
+  static void deallocate(void* ptr) {
+    if (ptr == NULL) return;
+    char* header = static_cast<char*>(ptr) - HEADER_SIZE;
+    if (*reinterpret_cast<bool*>(header)) {
+      ::operator delete(header);
+    }
+  }
 };
 
 class LoadBalancingPolicy : public Host::StateListener, public RefCounted<LoadBalancingPolicy> {
@@ -87,9 +167,15 @@ public:
 
   virtual CassHostDistance distance(const SharedRefPtr<Host>& host) const = 0;
 
+  // Local hosts in the client's own rack are preferred over the rest of the
+  // local hosts
+  virtual bool is_local_rack(const SharedRefPtr<Host>& host) const { return false; }
+
+  // Child plans should be created using the same allocator
   virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
                                     const Request* request,
-                                    const TokenMap& token_map) = 0;
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL) = 0;
 
   virtual LoadBalancingPolicy* new_instance() = 0;
 };
@@ -106,8 +192,13 @@ public:
     return child_policy_->init(connected_host, hosts);
   }
 
+  virtual void register_handles(uv_loop_t* loop) { child_policy_->register_handles(loop); }
+  virtual void close_handles() { child_policy_->close_handles(); }
+
   virtual CassHostDistance distance(const SharedRefPtr<Host>& host) const { return child_policy_->distance(host); }
 
+  virtual bool is_local_rack(const SharedRefPtr<Host>& host) const { return child_policy_->is_local_rack(host); }
+
   virtual void on_add(const SharedRefPtr<Host>& host) { child_policy_->on_add(host); }
 
   virtual void on_remove(const SharedRefPtr<Host>& host) { child_policy_->on_remove(host); }
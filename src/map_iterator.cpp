@@ -19,17 +19,27 @@
 namespace cass {
 
 char* MapIterator::decode_pair(char* position) {
-  uint16_t size;
+  int32_t size;
 
-  position = decode_uint16(position, size);
+  position = decode_size(position, size);
   key_ = Value(map_->primary_type(), position, size);
 
-  position = decode_uint16(position + size, size);
+  position = decode_size(position + size, size);
   value_ = Value(map_->secondary_type(), position, size);
 
   return position + size;
 }
 
+char* MapIterator::decode_size(char* position, int32_t& size) {
+  if (map_->protocol_version() >= 3) {
+    return decode_int32(position, size);
+  }
+  uint16_t short_size;
+  position = decode_uint16(position, short_size);
+  size = short_size;
+  return position;
+}
+
 bool MapIterator::next() {
   if (index_ + 1 >= count_) {
     return false;
@@ -47,6 +47,7 @@ public:
 
 private:
   char* decode_pair(char* position);
+  char* decode_size(char* position, int32_t& size);
 
 private:
   const Value* map_;
@@ -0,0 +1,100 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_OBJECT_POOL_HPP_INCLUDED__
+#define __CASS_OBJECT_POOL_HPP_INCLUDED__
+
+#include "atomic.hpp"
+#include "macros.hpp"
+#include "mpmc_queue.hpp"
+#include "ref_counted.hpp"
+
+#include <stddef.h>
+
+namespace cass {
+
+// A bounded, thread-safe free list of objects that are expensive to create,
+// e.g. because they own a mutex and a condition variable or strings whose
+// capacity is worth keeping. Objects are acquired on application threads and
+// are often released on an IO worker thread so the free list is a MPMC queue.
+// Released objects are reset() and recycled unless the free list is full in
+// which case they're deleted.
+//
+// Every object that's handed out keeps a reference to the pool so the pool
+// (and its free objects) outlive any object that's still in use.
+//
+// "T" must be default constructible and provide:
+//   void set_object_pool(ObjectPool<T>* pool);
+//   void reset();
+// and pass itself to release() instead of deleting itself when its last
+// reference is released.
+template <class T>
+class ObjectPool : public RefCounted<ObjectPool<T> > {
+public:
+  ObjectPool(size_t max_free_objects)
+    : free_objects_(max_free_objects)
+    , acquire_count_(0)
+    , allocation_count_(0) {}
+
+  ~ObjectPool() {
+    T* object = NULL;
+    while (free_objects_.dequeue(object)) {
+      delete object;
+    }
+  }
+
+  T* acquire() {
+    T* object = NULL;
+    acquire_count_.fetch_add(1, MEMORY_ORDER_RELAXED);
+    if (!free_objects_.dequeue(object)) {
+      allocation_count_.fetch_add(1, MEMORY_ORDER_RELAXED);
+      object = new T();
+      object->set_object_pool(this);
+    }
+    this->inc_ref(); // Released in release()
+    return object;
+  }
+
+  void release(T* object) {
+    object->reset();
+    if (!free_objects_.enqueue(object)) {
+      delete object;
+    }
+    this->dec_ref();
+  }
+
+  // The number of objects that had to be allocated because the free list was
+  // empty. This stops growing once the pool has reached a steady state.
+  size_t allocation_count() const {
+    return allocation_count_.load(MEMORY_ORDER_RELAXED);
+  }
+
+  size_t acquire_count() const {
+    return acquire_count_.load(MEMORY_ORDER_RELAXED);
+  }
+
+private:
+  MPMCQueue<T*> free_objects_;
+  Atomic<size_t> acquire_count_;
+  Atomic<size_t> allocation_count_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+} // namespace cass
+
+#endif
@@ -23,31 +23,40 @@
 #include "prepare_handler.hpp"
 #include "session.hpp"
 #include "set_keyspace_handler.hpp"
+#include "speculative_execution.hpp"
 #include "request_handler.hpp"
 #include "result_response.hpp"
 #include "timer.hpp"
 
 namespace cass {
 
-static bool least_busy_comp(Connection* a, Connection* b) {
+static bool least_busy_comp(const Connection* a, const Connection* b) {
   return a->pending_request_count() < b->pending_request_count();
 }
 
 Pool::Pool(IOWorker* io_worker,
            const Address& address,
+           const SharedRefPtr<Host>& host,
            bool is_initial_connection)
     : io_worker_(io_worker)
     , address_(address)
+    , host_(host)
     , loop_(io_worker->loop())
     , config_(io_worker->config())
     , metrics_(io_worker->metrics())
     , state_(POOL_STATE_NEW)
+    , least_busy_connections_(least_busy_comp)
+    , in_flight_request_count_(0)
     , available_connection_count_(0)
     , is_available_(false)
     , is_initial_connection_(is_initial_connection)
     , is_critical_failure_(false)
     , is_pending_flush_(false)
-    , cancel_reconnect_(false) {}
+    , cancel_reconnect_(false) {
+  if (config_.adaptive_concurrency_limit()) {
+    limiter_.reset(new ConcurrencyLimiter(config_.adaptive_concurrency_limit_settings()));
+  }
+}
 
 Pool::~Pool() {
   LOG_DEBUG("Pool dtor with %u pending requests pool(%p)",
@@ -199,6 +208,28 @@ bool Pool::write(Connection* connection, RequestHandler* request_handler) {
   return true;
 }
 
+bool Pool::write(SpeculativeExecution* speculative_execution) {
+  // Speculative executions are best effort, they don't wait for a connection
+  // or change the keyspace of a connection
+  if (is_limited()) {
+    return false;
+  }
+  Connection* connection = borrow_connection();
+  if (connection == NULL ||
+      !io_worker_->is_current_keyspace(connection->keyspace())) {
+    return false;
+  }
+  speculative_execution->set_pool(this);
+  if (!connection->write(speculative_execution, false)) {
+    return false;
+  }
+  if (!is_pending_flush_) {
+    io_worker_->add_pending_flush(this);
+  }
+  is_pending_flush_ = true;
+  return true;
+}
+
 void Pool::flush() {
   is_pending_flush_ = false;
   for (ConnectionVec::iterator it = connections_.begin(),
@@ -227,8 +258,10 @@ void Pool::maybe_close() {
 void Pool::spawn_connection() {
   if (state_ != POOL_STATE_CLOSING && state_ != POOL_STATE_CLOSED) {
     Connection* connection =
-        new Connection(loop_, config_, metrics_,
+        new Connection(loop_, io_worker_->timer_wheel(), config_, metrics_,
+                       io_worker_->read_buffer_pool(),
                        address_,
+                       host_,
                        io_worker_->keyspace(),
                        io_worker_->protocol_version(),
                        this);
@@ -258,10 +291,13 @@ void Pool::maybe_spawn_connection() {
 }
 
 Connection* Pool::find_least_busy() {
-  ConnectionVec::iterator it = std::min_element(
-      connections_.begin(), connections_.end(), least_busy_comp);
-  if ((*it)->is_ready() && (*it)->available_streams() > 0) {
-    return *it;
+  while (!least_busy_connections_.is_empty()) {
+    Connection* connection = least_busy_connections_.top();
+    if (connection->is_ready()) {
+      return connection->available_streams() > 0 ? connection : NULL;
+    }
+    // A connection is never ready again once it starts closing
+    least_busy_connections_.remove(connection);
   }
   return NULL;
 }
@@ -269,6 +305,7 @@ Connection* Pool::find_least_busy() {
 void Pool::on_ready(Connection* connection) {
   connections_pending_.erase(connection);
   connections_.push_back(connection);
+  least_busy_connections_.push(connection);
   return_connection(connection);
 
   maybe_notify_ready();
@@ -279,6 +316,14 @@ void Pool::on_ready(Connection* connection) {
 void Pool::on_close(Connection* connection) {
   connections_pending_.erase(connection);
 
+  // The requests still in flight on a closed connection aren't reported
+  assert(in_flight_request_count_ >= connection->pending_request_count());
+  in_flight_request_count_ -= connection->pending_request_count();
+
+  if (connection->is_in_heap()) {
+    least_busy_connections_.remove(connection);
+  }
+
   ConnectionVec::iterator it =
       std::find(connections_.begin(), connections_.end(), connection);
   if (it != connections_.end()) {
@@ -316,6 +361,13 @@ void Pool::on_availability_change(Connection* connection) {
   }
 }
 
+void Pool::on_pending_request_count_change(Connection* connection, int delta) {
+  in_flight_request_count_ += delta;
+  if (connection->is_in_heap()) {
+    least_busy_connections_.update(connection);
+  }
+}
+
 void Pool::on_pending_request_timeout(RequestTimer* timer) {
   RequestHandler* request_handler = static_cast<RequestHandler*>(timer->data());
   Pool* pool = request_handler->pool();
@@ -330,7 +382,7 @@ void Pool::on_pending_request_timeout(RequestTimer* timer) {
 
 void Pool::wait_for_connection(RequestHandler* request_handler) {
   request_handler->set_pool(this);
-  request_handler->start_timer(loop_,
+  request_handler->start_timer(io_worker_->timer_wheel(),
                                config_.connect_timeout_ms(),
                                request_handler,
                                Pool::on_pending_request_timeout);
@@ -18,7 +18,9 @@
 #define __CASS_POOL_HPP_INCLUDED__
 
 #include "cassandra.h"
+#include "concurrency_limiter.hpp"
 #include "connection.hpp"
+#include "indexed_heap.hpp"
 #include "metrics.hpp"
 #include "ref_counted.hpp"
 #include "request.hpp"
@@ -34,6 +36,7 @@ namespace cass {
 
 class IOWorker;
 class RequestHandler;
+class SpeculativeExecution;
 class Config;
 
 class Pool : public RefCounted<Pool>
@@ -49,6 +52,7 @@ public:
 
   Pool(IOWorker* io_worker,
        const Address& address,
+       const SharedRefPtr<Host>& host,
        bool is_initial_connection);
   virtual ~Pool();
 
@@ -56,6 +60,7 @@ public:
   void close(bool cancel_reconnect = false);
 
   bool write(Connection* connection, RequestHandler* request_handler);
+  bool write(SpeculativeExecution* speculative_execution);
   void flush();
 
   void wait_for_connection(RequestHandler* request_handler);
@@ -70,6 +75,24 @@ public:
 
   void return_connection(Connection* connection);
 
+  // Requests in flight to the host, including requests waiting for a
+  // connection
+  size_t pending_request_count() const {
+    return in_flight_request_count_ + pending_requests_.size();
+  }
+
+  bool is_limited() const {
+    return limiter_ && limiter_->is_limited(pending_request_count());
+  }
+
+  void on_request_success(uint64_t latency_ns) {
+    if (limiter_) limiter_->on_success(latency_ns, pending_request_count());
+  }
+
+  void on_request_timeout() {
+    if (limiter_) limiter_->on_dropped();
+  }
+
 private:
   void add_pending_request(RequestHandler* request_handler);
   void remove_pending_request(RequestHandler* request_handler);
@@ -85,6 +108,7 @@ private:
   virtual void on_ready(Connection* connection);
   virtual void on_close(Connection* connection);
   virtual void on_availability_change(Connection* connection);
+  virtual void on_pending_request_count_change(Connection* connection, int delta);
   virtual void on_event(EventResponse* response) {}
 
   static void on_pending_request_timeout(RequestTimer* timer);
@@ -97,20 +121,29 @@ private:
 
   IOWorker* io_worker_;
   Address address_;
+  SharedRefPtr<Host> host_;
   uv_loop_t* loop_;
   const Config& config_;
   Metrics* metrics_;
 
   PoolState state_;
   ConnectionVec connections_;
+  // The connections that are ready, the least busy first. Connections that
+  // are closing are removed when they're found at the top.
+  IndexedHeap<Connection> least_busy_connections_;
   ConnectionSet connections_pending_;
   List<Handler> pending_requests_;
+  // The sum of the connections' pending requests, kept up to date as they
+  // change so it doesn't have to be counted for every request
+  size_t in_flight_request_count_;
   int available_connection_count_;
   bool is_available_;
   bool is_initial_connection_;
   bool is_critical_failure_;
   bool is_pending_flush_;
   bool cancel_reconnect_;
+  // Only used with the adaptive concurrency limit
+  ScopedPtr<ConcurrencyLimiter> limiter_;
 };
 
 } // namespace cass
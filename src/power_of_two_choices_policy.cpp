@@ -0,0 +1,58 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "power_of_two_choices_policy.hpp"
+
+namespace cass {
+
+QueryPlan* PowerOfTwoChoicesPolicy::new_query_plan(const std::string& connected_keyspace,
+                                                   const Request* request,
+                                                   const TokenMap& token_map,
+                                                   QueryPlanAllocator* allocator) {
+  return new (allocator) PowerOfTwoChoicesQueryPlan(child_policy_.get(),
+                                                    child_policy_->new_query_plan(connected_keyspace,
+                                                                                  request,
+                                                                                  token_map,
+                                                                                  allocator));
+}
+
+SharedRefPtr<Host> PowerOfTwoChoicesPolicy::PowerOfTwoChoicesQueryPlan::compute_next() {
+  if (!is_sampled_) {
+    is_sampled_ = true;
+    SharedRefPtr<Host> first = child_plan_->compute_next();
+    if (!first) return first;
+    second_ = child_plan_->compute_next();
+    // Never trade a host for one that's further away, e.g. a remote DC
+    if (second_ &&
+        child_policy_->distance(second_) == child_policy_->distance(first) &&
+        second_->inflight_request_count() < first->inflight_request_count()) {
+      SharedRefPtr<Host> temp(first);
+      first = second_;
+      second_ = temp;
+    }
+    return first;
+  }
+
+  if (second_) {
+    SharedRefPtr<Host> temp(second_);
+    second_ = SharedRefPtr<Host>();
+    return temp;
+  }
+
+  return child_plan_->compute_next();
+}
+
+} // namespace cass
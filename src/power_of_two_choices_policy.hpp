@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_POWER_OF_TWO_CHOICES_POLICY_HPP_INCLUDED__
+#define __CASS_POWER_OF_TWO_CHOICES_POLICY_HPP_INCLUDED__
+
+#include "load_balancing.hpp"
+#include "macros.hpp"
+#include "scoped_ptr.hpp"
+
+namespace cass {
+
+// Takes the first two hosts of the child policy's query plan and starts with
+// the one that has fewer requests in flight. Using the child plan's hosts
+// keeps its locality and replica preferences.
+class PowerOfTwoChoicesPolicy : public ChainedLoadBalancingPolicy {
+public:
+  PowerOfTwoChoicesPolicy(LoadBalancingPolicy* child_policy)
+    : ChainedLoadBalancingPolicy(child_policy) {}
+
+  virtual ~PowerOfTwoChoicesPolicy() {}
+
+  virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
+                                    const Request* request,
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL);
+
+  virtual LoadBalancingPolicy* new_instance() {
+    return new PowerOfTwoChoicesPolicy(child_policy_->new_instance());
+  }
+
+private:
+  class PowerOfTwoChoicesQueryPlan : public QueryPlan {
+  public:
+    PowerOfTwoChoicesQueryPlan(const LoadBalancingPolicy* child_policy,
+                               QueryPlan* child_plan)
+      : child_policy_(child_policy)
+      , child_plan_(child_plan)
+      , is_sampled_(false) {}
+
+    SharedRefPtr<Host> compute_next();
+
+  private:
+    const LoadBalancingPolicy* child_policy_;
+    ScopedPtr<QueryPlan> child_plan_;
+    bool is_sampled_;
+    SharedRefPtr<Host> second_;
+  };
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(PowerOfTwoChoicesPolicy);
+};
+
+} // namespace cass
+
+#endif
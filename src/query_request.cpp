@@ -23,8 +23,8 @@ namespace cass {
 int QueryRequest::encode(int version, BufferVec* bufs) const {
   if (version == 1) {
     return encode_v1(bufs);
-  } else if (version == 2) {
-    return encode_v2(bufs);
+  } else if (version == 2 || version == 3) {
+    return encode_v2(version, bufs);
   } else {
     return ENCODE_ERROR_UNSUPPORTED_PROTOCOL;
   }
@@ -42,19 +42,21 @@ int QueryRequest::encode_v1(BufferVec* bufs) const {
   return length;
 }
 
-int QueryRequest::encode_v2(BufferVec* bufs) const {
-  const int version = 2;
+// Versions 2 and 3 use the same request format (the encoding of collection
+// values is handled by the values themselves). The request is sized on the
+// first pass and then written into a single buffer (plus any large values).
+int QueryRequest::encode_v2(int version, BufferVec* bufs) const {
+  BufferBuilder builder;
+  encode_v2(version, &builder);
+  builder.start_encoding(bufs);
+  encode_v2(version, &builder);
+  return builder.size();
+}
 
+void QueryRequest::encode_v2(int version, BufferBuilder* builder) const {
   uint8_t flags = 0;
-  size_t length = 0;
-
-    // <query> [long string] + <consistency> [short] + <flags> [byte]
-  size_t query_buf_size = sizeof(int32_t) + query().size() +
-                          sizeof(uint16_t) + sizeof(uint8_t);
-  size_t paging_buf_size = 0;
 
-  if (values_count() > 0) { // <values> = <n><value_1>...<value_n>
-    query_buf_size += sizeof(uint16_t); // <n> [short]
+  if (values_count() > 0) {
     flags |= CASS_QUERY_FLAG_VALUES;
   }
 
@@ -63,58 +65,38 @@ int QueryRequest::encode_v2(BufferVec* bufs) const {
   }
 
   if (page_size() > 0) {
-    paging_buf_size += sizeof(int32_t); // [int]
     flags |= CASS_QUERY_FLAG_PAGE_SIZE;
-  } else {
-
   }
 
   if (!paging_state().empty()) {
-    paging_buf_size += sizeof(int32_t) + paging_state().size(); // [bytes]
     flags |= CASS_QUERY_FLAG_PAGING_STATE;
   }
 
   if (serial_consistency() != 0) {
-    paging_buf_size += sizeof(uint16_t); // [short]
     flags |= CASS_QUERY_FLAG_SERIAL_CONSISTENCY;
   }
 
-  {
-    bufs->push_back(Buffer(query_buf_size));
-    length += query_buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = buf.encode_long_string(0, query().data(), query().size());
-    pos = buf.encode_uint16(pos, consistency());
-    pos = buf.encode_byte(pos, flags);
+  // <query> [long string] + <consistency> [short] + <flags> [byte]
+  builder->encode_long_string(query().data(), query().size());
+  builder->encode_uint16(consistency());
+  builder->encode_byte(flags);
 
-    if (values_count() > 0) {
-      buf.encode_uint16(pos, values_count());
-      length += encode_values(version, bufs);
-    }
+  if (values_count() > 0) { // <values> = <n><value_1>...<value_n>
+    builder->encode_uint16(values_count()); // <n> [short]
+    encode_values(version, builder);
   }
 
-  if (paging_buf_size > 0) {
-    bufs->push_back(Buffer(paging_buf_size));
-    length += paging_buf_size;
-
-    Buffer& buf = bufs->back();
-    size_t pos = 0;
-
-    if (page_size() >= 0) {
-      pos = buf.encode_int32(pos, page_size());
-    }
-
-    if (!paging_state().empty()) {
-      pos = buf.encode_bytes(pos, paging_state().data(), paging_state().size());
-    }
+  if (page_size() > 0) {
+    builder->encode_int32(page_size()); // [int]
+  }
 
-    if (serial_consistency() != 0) {
-      pos = buf.encode_uint16(pos, serial_consistency());
-    }
+  if (!paging_state().empty()) {
+    builder->encode_bytes(paging_state().data(), paging_state().size()); // [bytes]
   }
 
-  return length;
+  if (serial_consistency() != 0) {
+    builder->encode_uint16(serial_consistency()); // [short]
+  }
 }
 
 } // namespace cass
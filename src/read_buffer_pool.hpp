@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifndef __CASS_READ_BUFFER_POOL_HPP_INCLUDED__
+#define __CASS_READ_BUFFER_POOL_HPP_INCLUDED__
+
+#include "macros.hpp"
+#include "ref_counted.hpp"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace cass {
+
+// A freelist of fixed size read buffers. Connections borrow a buffer from
+// the pool of their event loop when libuv asks for one and return it as soon
+// as the data has been consumed. Responses decoded in place keep a reference
+// to the buffer; those buffers are released instead of being recycled and
+// are freed when the last response referencing them goes away. This is not
+// thread-safe and must only be used from a single event loop thread (one per
+// IO worker).
+class ReadBufferPool {
+public:
+  static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+  static const size_t DEFAULT_MAX_FREE_BUFFERS = 16;
+
+  ReadBufferPool(size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                 size_t max_free_buffers = DEFAULT_MAX_FREE_BUFFERS)
+    : buffer_size_(buffer_size)
+    , max_free_buffers_(max_free_buffers)
+    , borrow_count_(0)
+    , hit_count_(0)
+    , retained_count_(0)
+    , in_use_count_(0)
+    , peak_in_use_count_(0) {
+    free_buffers_.reserve(max_free_buffers_);
+  }
+
+  ~ReadBufferPool() {
+    assert(in_use_count_ == 0 && "Read buffers are still in use");
+    for (std::vector<RefBuffer*>::iterator it = free_buffers_.begin(),
+         end = free_buffers_.end(); it != end; ++it) {
+      (*it)->dec_ref();
+    }
+  }
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  // The returned buffer has a reference that's owned by the caller
+  RefBuffer* borrow() {
+    ++borrow_count_;
+    if (++in_use_count_ > peak_in_use_count_) {
+      peak_in_use_count_ = in_use_count_;
+    }
+    if (!free_buffers_.empty()) {
+      ++hit_count_;
+      RefBuffer* buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    RefBuffer* buffer = RefBuffer::create(buffer_size_);
+    buffer->inc_ref();
+    return buffer;
+  }
+
+  void give_back(RefBuffer* buffer) {
+    if (buffer == NULL) return;
+    assert(in_use_count_ > 0);
+    --in_use_count_;
+    if (buffer->ref_count() > 1) {
+      // Still referenced by responses decoded in place
+      ++retained_count_;
+      buffer->dec_ref();
+    } else if (free_buffers_.size() < max_free_buffers_) {
+      free_buffers_.push_back(buffer);
+    } else {
+      buffer->dec_ref();
+    }
+  }
+
+  // Stats
+  uint64_t borrow_count() const { return borrow_count_; }
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t retained_count() const { return retained_count_; }
+  size_t in_use_count() const { return in_use_count_; }
+  size_t peak_in_use_count() const { return peak_in_use_count_; }
+  size_t free_count() const { return free_buffers_.size(); }
+
+  double hit_rate() const {
+    return borrow_count_ > 0
+        ? static_cast<double>(hit_count_) / borrow_count_
+        : 0.0;
+  }
+
+private:
+  const size_t buffer_size_;
+  const size_t max_free_buffers_;
+  std::vector<RefBuffer*> free_buffers_;
+
+  uint64_t borrow_count_;
+  uint64_t hit_count_;
+  uint64_t retained_count_;
+  size_t in_use_count_;
+  size_t peak_in_use_count_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(ReadBufferPool);
+};
+
+} // namespace cass
+
+#endif
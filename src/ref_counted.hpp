@@ -47,10 +47,17 @@ public:
     assert(new_ref_count >= 1);
     if (new_ref_count == 1) {
       atomic_thread_fence(MEMORY_ORDER_ACQUIRE);
-      delete static_cast<const T*>(this);
+      T::destroy(static_cast<const T*>(this));
     }
   }
 
+protected:
+  // Called when the last reference is released. Types can hide this to
+  // recycle their instances instead of deleting them (see ObjectPool).
+  static void destroy(const T* ptr) {
+    delete ptr;
+  }
+
 private:
   mutable Atomic<int> ref_count_;
   DISALLOW_COPY_AND_ASSIGN(RefCounted);
@@ -21,6 +21,8 @@
 #include "map_iterator.hpp"
 #include "token_map.hpp"
 
+#include <algorithm>
+#include <list>
 #include <map>
 #include <set>
 
@@ -41,12 +43,93 @@ SharedRefPtr<ReplicationStrategy> ReplicationStrategy::from_keyspace_meta(const
   }
 }
 
+void ReplicationStrategy::tokens_to_replicas(const TokenHostMap& primary,
+                                             TokenReplicaMap* output) const {
+  DCRackMap racks;
+  racks_in_dcs(primary, &racks);
+  tokens_to_replicas(primary, racks, output);
+}
+
+size_t ReplicationStrategy::tokens_to_replicas(const TokenHostMap& primary,
+                                               const DCRackMap& racks,
+                                               TokenReplicaMap* output) const {
+  size_t max_walk = 0;
+  output->clear();
+  for (TokenHostMap::const_iterator i = primary.begin(); i != primary.end(); ++i) {
+    HostVec* replicas = new HostVec();
+    max_walk = std::max(max_walk, token_replicas(primary, racks, i, replicas));
+    output->insert(output->end(), std::make_pair(i->first, CopyOnWriteHostVec(replicas)));
+  }
+  return max_walk;
+}
+
+size_t ReplicationStrategy::update_replicas(const TokenHostMap& primary,
+                                            const DCRackMap& racks,
+                                            const TokenVec& dirty,
+                                            size_t max_walk,
+                                            TokenReplicaMap* output) const {
+  if (primary.empty() || dirty.empty()) return max_walk;
+
+  // A token's replicas only change if its walk reaches a dirty position. Walks
+  // starting earlier on the ring never end later so the positions before each
+  // dirty token are recomputed until one no longer reaches it, bounded by
+  // "max_walk". The dirty tokens are in ring order so a window can also stop
+  // at the previous dirty token; the positions before it were covered by the
+  // previous window.
+  size_t new_max_walk = max_walk;
+  TokenHostMap::const_iterator stop = primary.find(dirty.back());
+
+  for (TokenVec::const_iterator d = dirty.begin(); d != dirty.end(); ++d) {
+    TokenHostMap::const_iterator i = primary.find(*d);
+    if (i == primary.end()) continue;
+
+    TokenHostMap::const_iterator window_stop = stop;
+    stop = i;
+
+    for (size_t distance = 0; distance < max_walk; ++distance) {
+      HostVec* replicas = new HostVec();
+      size_t walk = token_replicas(primary, racks, i, replicas);
+      if (walk <= distance) {
+        delete replicas;
+        break;
+      }
+      new_max_walk = std::max(new_max_walk, walk);
+
+      CopyOnWriteHostVec token_replicas(replicas);
+      std::pair<TokenReplicaMap::iterator, bool> result
+          = output->insert(std::make_pair(i->first, token_replicas));
+      if (!result.second) {
+        result.first->second = token_replicas;
+      }
+
+      if (i == primary.begin()) {
+        i = primary.end();
+      }
+      --i;
+      if (i == window_stop) break;
+    }
+  }
+
+  return new_max_walk;
+}
+
+void ReplicationStrategy::racks_in_dcs(const TokenHostMap& primary, DCRackMap* output) {
+  for (TokenHostMap::const_iterator i = primary.begin();
+       i != primary.end(); ++i) {
+    const std::string& dc = i->second->dc();
+    const std::string& rack = i->second->rack();
+    if (!dc.empty() &&  !rack.empty()) {
+      (*output)[dc].insert(rack);
+    }
+  }
+}
+
 
 const std::string NetworkTopologyStrategy::STRATEGY_CLASS("NetworkTopologyStrategy");
 
 NetworkTopologyStrategy::NetworkTopologyStrategy(const std::string& strategy_class,
                                                  const SchemaMetadataField* strategy_options)
-  : ReplicationStrategy(strategy_class) {
+  : ReplicationStrategy(NETWORK_TOPOLOGY, strategy_class) {
   build_dc_replicas(strategy_options, &replication_factors_);
 }
 
@@ -57,81 +140,71 @@ bool NetworkTopologyStrategy::equal(const KeyspaceMetadata& ks_meta) {
   return replication_factors_ == temp_rfs;
 }
 
-typedef std::map<std::string, std::set<std::string> > DCRackMap;
-static DCRackMap racks_in_dcs(const TokenHostMap& token_hosts) {
-  DCRackMap racks;
-  for (TokenHostMap::const_iterator i = token_hosts.begin();
-       i != token_hosts.end(); ++i) {
-    const std::string& dc = i->second->dc();
-    const std::string& rack = i->second->rack();
-    if (!dc.empty() &&  !rack.empty()) {
-      racks[dc].insert(rack);
-    }
-  }
-  return racks;
+bool NetworkTopologyStrategy::equal(const ReplicationStrategy& other) const {
+  if (type_ != other.type() || strategy_class_ != other.strategy_class()) return false;
+  const NetworkTopologyStrategy& nts = static_cast<const NetworkTopologyStrategy&>(other);
+  return replication_factors_ == nts.replication_factors_;
 }
 
-void NetworkTopologyStrategy::tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const {
-  DCRackMap racks = racks_in_dcs(primary);
-
-  output->clear();
-
-  for (TokenHostMap::const_iterator i = primary.begin(); i != primary.end(); ++i) {
-    DCReplicaCountMap replica_counts;
-    std::map<std::string, std::set<std::string> > racks_observed;
-    std::map<std::string, std::list<SharedRefPtr<Host> > > skipped_endpoints;
-
-    CopyOnWriteHostVec replicas(new HostVec());
-    TokenHostMap::const_iterator j = i;
-    for (size_t count = 0; count < primary.size() && replica_counts != replication_factors_; ++count) {
-      const SharedRefPtr<Host>& host = j->second;
-      const std::string& dc = host->dc();
-
-      ++j;
-      if (j == primary.end()) {
-        j = primary.begin();
-      }
-
-      DCReplicaCountMap::const_iterator rf_it =  replication_factors_.find(dc);
-      if (dc.empty() || rf_it == replication_factors_.end()) {
-        continue;
-      }
+size_t NetworkTopologyStrategy::token_replicas(const TokenHostMap& primary,
+                                               const DCRackMap& racks,
+                                               TokenHostMap::const_iterator token,
+                                               HostVec* replicas) const {
+  DCReplicaCountMap replica_counts;
+  std::map<std::string, std::set<std::string> > racks_observed;
+  std::map<std::string, std::list<SharedRefPtr<Host> > > skipped_endpoints;
+
+  TokenHostMap::const_iterator j = token;
+  size_t count = 0;
+  for (; count < primary.size() && replica_counts != replication_factors_; ++count) {
+    const SharedRefPtr<TokenHost>& host = j->second;
+    const std::string& dc = host->dc();
+
+    ++j;
+    if (j == primary.end()) {
+      j = primary.begin();
+    }
 
-      const size_t rf = rf_it->second;
-      size_t& replica_count_this_dc = replica_counts[dc] ;
-      if (replica_count_this_dc >= rf) {
-        continue;
-      }
+    DCReplicaCountMap::const_iterator rf_it =  replication_factors_.find(dc);
+    if (dc.empty() || rf_it == replication_factors_.end()) {
+      continue;
+    }
 
-      const size_t rack_count_this_dc = racks[dc].size();
-      std::set<std::string>& racks_observed_this_dc = racks_observed[dc];
-      const std::string& rack = host->rack();
+    const size_t rf = rf_it->second;
+    size_t& replica_count_this_dc = replica_counts[dc] ;
+    if (replica_count_this_dc >= rf) {
+      continue;
+    }
 
-      if (rack.empty() || racks_observed_this_dc.size() == rack_count_this_dc) {
-        ++replica_count_this_dc;
-        replicas->push_back(host);
+    DCRackMap::const_iterator racks_it = racks.find(dc);
+    const size_t rack_count_this_dc = racks_it != racks.end() ? racks_it->second.size() : 0;
+    std::set<std::string>& racks_observed_this_dc = racks_observed[dc];
+    const std::string& rack = host->rack();
+
+    if (rack.empty() || racks_observed_this_dc.size() == rack_count_this_dc) {
+      ++replica_count_this_dc;
+      replicas->push_back(host->host());
+    } else {
+      if (racks_observed_this_dc.count(rack) > 0) {
+        skipped_endpoints[dc].push_back(host->host());
       } else {
-        if (racks_observed_this_dc.count(rack) > 0) {
-          skipped_endpoints[dc].push_back(host);
-        } else {
-          ++replica_count_this_dc;
-          replicas->push_back(host);
-          racks_observed_this_dc.insert(rack);
-
-          if (racks_observed_this_dc.size() == rack_count_this_dc) {
-            std::list<SharedRefPtr<Host> >& skipped_endpoints_this_dc = skipped_endpoints[dc];
-            while (!skipped_endpoints_this_dc.empty() && replica_count_this_dc < rf) {
-              ++replica_count_this_dc;
-              replicas->push_back(skipped_endpoints_this_dc.front());
-              skipped_endpoints_this_dc.pop_front();
-            }
+        ++replica_count_this_dc;
+        replicas->push_back(host->host());
+        racks_observed_this_dc.insert(rack);
+
+        if (racks_observed_this_dc.size() == rack_count_this_dc) {
+          std::list<SharedRefPtr<Host> >& skipped_endpoints_this_dc = skipped_endpoints[dc];
+          while (!skipped_endpoints_this_dc.empty() && replica_count_this_dc < rf) {
+            ++replica_count_this_dc;
+            replicas->push_back(skipped_endpoints_this_dc.front());
+            skipped_endpoints_this_dc.pop_front();
           }
         }
       }
     }
-
-    output->insert(std::make_pair(i->first, replicas));
   }
+
+  return count;
 }
 
 void NetworkTopologyStrategy::build_dc_replicas(const SchemaMetadataField* strategy_options,
@@ -156,7 +229,7 @@ const std::string SimpleStrategy::STRATEGY_CLASS("SimpleStrategy");
 
 SimpleStrategy::SimpleStrategy(const std::string& strategy_class,
                                const SchemaMetadataField* strategy_options)
-  : ReplicationStrategy(strategy_class)
+  : ReplicationStrategy(SIMPLE, strategy_class)
   , replication_factor_(0) {
   replication_factor_ = get_replication_factor(strategy_options);
   if (replication_factor_ == 0) {
@@ -169,21 +242,25 @@ bool SimpleStrategy::equal(const KeyspaceMetadata& ks_meta) {
   return replication_factor_ == get_replication_factor(ks_meta.strategy_options());
 }
 
-void SimpleStrategy::tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const {
+bool SimpleStrategy::equal(const ReplicationStrategy& other) const {
+  if (type_ != other.type() || strategy_class_ != other.strategy_class()) return false;
+  return replication_factor_ == static_cast<const SimpleStrategy&>(other).replication_factor_;
+}
+
+size_t SimpleStrategy::token_replicas(const TokenHostMap& primary,
+                                      const DCRackMap& racks,
+                                      TokenHostMap::const_iterator token,
+                                      HostVec* replicas) const {
   size_t target_replicas = std::min<size_t>(replication_factor_, primary.size());
-  output->clear();
-  for (TokenHostMap::const_iterator i = primary.begin(); i != primary.end(); ++i) {
-    CopyOnWriteHostVec token_replicas(new HostVec());
-    TokenHostMap::const_iterator j = i;
-    do {
-      token_replicas->push_back(j->second);
-      ++j;
-      if (j == primary.end()) {
-        j = primary.begin();
-      }
-    } while (token_replicas->size() < target_replicas);
-    output->insert(std::make_pair(i->first, token_replicas));
-  }
+  TokenHostMap::const_iterator j = token;
+  do {
+    replicas->push_back(j->second->host());
+    ++j;
+    if (j == primary.end()) {
+      j = primary.begin();
+    }
+  } while (replicas->size() < target_replicas);
+  return replicas->size();
 }
 
 size_t SimpleStrategy::get_replication_factor(const SchemaMetadataField* strategy_options) {
@@ -206,12 +283,16 @@ bool NonReplicatedStrategy::equal(const KeyspaceMetadata& ks_meta) {
   return true;
 }
 
-void NonReplicatedStrategy::tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const {
-  output->clear();
-  for (TokenHostMap::const_iterator i = primary.begin(); i != primary.end(); ++i) {
-    CopyOnWriteHostVec token_replicas(new HostVec(1, i->second));
-    output->insert(std::make_pair(i->first, token_replicas));
-  }
+bool NonReplicatedStrategy::equal(const ReplicationStrategy& other) const {
+  return type_ == other.type() && strategy_class_ == other.strategy_class();
+}
+
+size_t NonReplicatedStrategy::token_replicas(const TokenHostMap& primary,
+                                             const DCRackMap& racks,
+                                             TokenHostMap::const_iterator token,
+                                             HostVec* replicas) const {
+  replicas->push_back(token->second->host());
+  return 1;
 }
 
 }
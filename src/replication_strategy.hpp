@@ -23,25 +23,89 @@
 #include "schema_metadata.hpp"
 
 #include <map>
+#include <set>
+#include <vector>
 
 namespace cass {
 
 typedef std::vector<uint8_t> Token;
-typedef std::map<Token, SharedRefPtr<Host> > TokenHostMap;
+
+// A host with the rack and DC it was in when its tokens were mapped. Token
+// maps are built on a worker thread so they use this copy instead of the
+// host's own rack and DC, which are updated on the control connection's
+// thread. It's shared by all of the host's tokens.
+class TokenHost : public RefCounted<TokenHost> {
+public:
+  TokenHost(const SharedRefPtr<Host>& host,
+            const std::string& rack,
+            const std::string& dc)
+    : host_(host)
+    , rack_(rack)
+    , dc_(dc) {}
+
+  const SharedRefPtr<Host>& host() const { return host_; }
+  const Address& address() const { return host_->address(); }
+  const std::string& rack() const { return rack_; }
+  const std::string& dc() const { return dc_; }
+
+private:
+  SharedRefPtr<Host> host_;
+  std::string rack_;
+  std::string dc_;
+};
+
+typedef std::map<Token, SharedRefPtr<TokenHost> > TokenHostMap;
 typedef std::map<Token, CopyOnWriteHostVec> TokenReplicaMap;
+typedef std::vector<Token> TokenVec;
+typedef std::map<std::string, std::set<std::string> > DCRackMap;
 
 class ReplicationStrategy : public RefCounted<ReplicationStrategy> {
 public:
   static SharedRefPtr<ReplicationStrategy> from_keyspace_meta(const KeyspaceMetadata& ks_meta);
 
-  ReplicationStrategy(const std::string& strategy_class)
-    : strategy_class_(strategy_class) {}
+  enum Type {
+    NETWORK_TOPOLOGY,
+    SIMPLE,
+    NON_REPLICATED
+  };
+
+  ReplicationStrategy(Type type, const std::string& strategy_class)
+    : type_(type)
+    , strategy_class_(strategy_class) {}
 
   virtual ~ReplicationStrategy() {}
   virtual bool equal(const KeyspaceMetadata& ks_meta) = 0;
-  virtual void tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const = 0;
+
+  Type type() const { return type_; }
+  const std::string& strategy_class() const { return strategy_class_; }
+
+  // Strategies that are equal produce the same replicas for a ring
+  virtual bool equal(const ReplicationStrategy& other) const = 0;
+
+  void tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const;
+
+  // Computes the replicas of every token. Returns the length of the longest
+  // walk around the ring, which bounds the work done by update_replicas().
+  size_t tokens_to_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                            TokenReplicaMap* output) const;
+
+  // Recomputes the replicas of only the tokens that can reach one of the
+  // "dirty" tokens (sorted, all present in "primary") within "max_walk" ring
+  // positions. Returns the new longest walk.
+  size_t update_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                         const TokenVec& dirty, size_t max_walk,
+                         TokenReplicaMap* output) const;
+
+  static void racks_in_dcs(const TokenHostMap& primary, DCRackMap* output);
 
 protected:
+  // Walks the ring clockwise starting at "token" and collects its replicas.
+  // Returns the number of ring positions visited.
+  virtual size_t token_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                                TokenHostMap::const_iterator token,
+                                HostVec* replicas) const = 0;
+
+  Type type_;
   std::string strategy_class_;
 };
 
@@ -57,14 +121,20 @@ public:
   virtual ~NetworkTopologyStrategy() {}
 
   virtual bool equal(const KeyspaceMetadata& ks_meta);
-  virtual void tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const;
+  virtual bool equal(const ReplicationStrategy& other) const;
 
-  // Testing only
   NetworkTopologyStrategy(const std::string& strategy_class,
                           const DCReplicaCountMap& replication_factors)
-    : ReplicationStrategy(strategy_class)
+    : ReplicationStrategy(NETWORK_TOPOLOGY, strategy_class)
     , replication_factors_(replication_factors) {}
 
+  const DCReplicaCountMap& replication_factors() const { return replication_factors_; }
+
+protected:
+  virtual size_t token_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                                TokenHostMap::const_iterator token,
+                                HostVec* replicas) const;
+
 private:
   static void build_dc_replicas(const SchemaMetadataField* strategy_options, DCReplicaCountMap* dc_replicas);
   DCReplicaCountMap replication_factors_;
@@ -80,14 +150,20 @@ public:
   virtual ~SimpleStrategy() {}
 
   virtual bool equal(const KeyspaceMetadata& ks_meta);
-  virtual void tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const;
+  virtual bool equal(const ReplicationStrategy& other) const;
 
-  // Testing only
   SimpleStrategy(const std::string& strategy_class,
                  size_t replication_factor)
-    : ReplicationStrategy(strategy_class)
+    : ReplicationStrategy(SIMPLE, strategy_class)
     , replication_factor_(replication_factor) {}
 
+  size_t replication_factor() const { return replication_factor_; }
+
+protected:
+  virtual size_t token_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                                TokenHostMap::const_iterator token,
+                                HostVec* replicas) const;
+
 private:
   static size_t get_replication_factor(const SchemaMetadataField* strategy_options);
   size_t replication_factor_;
@@ -97,11 +173,16 @@ private:
 class NonReplicatedStrategy : public ReplicationStrategy {
 public:
   NonReplicatedStrategy(const std::string& strategy_class)
-    : ReplicationStrategy(strategy_class) {}
+    : ReplicationStrategy(NON_REPLICATED, strategy_class) {}
   virtual ~NonReplicatedStrategy() {}
 
   virtual bool equal(const KeyspaceMetadata& ks_meta);
-  virtual void tokens_to_replicas(const TokenHostMap& primary, TokenReplicaMap* output) const;
+  virtual bool equal(const ReplicationStrategy& other) const;
+
+protected:
+  virtual size_t token_replicas(const TokenHostMap& primary, const DCRackMap& racks,
+                                TokenHostMap::const_iterator token,
+                                HostVec* replicas) const;
 };
 
 } // namespace cass
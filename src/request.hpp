@@ -35,7 +35,8 @@ public:
   Request(uint8_t opcode)
       : opcode_(opcode)
       , consistency_(CASS_CONSISTENCY_ONE)
-      , serial_consistency_(CASS_CONSISTENCY_ANY) {}
+      , serial_consistency_(CASS_CONSISTENCY_ANY)
+      , is_idempotent_(false) {}
 
   virtual ~Request() {}
 
@@ -51,12 +52,18 @@ public:
     serial_consistency_ = serial_consistency;
   }
 
+  // Only idempotent requests are speculatively executed
+  bool is_idempotent() const { return is_idempotent_; }
+
+  void set_is_idempotent(bool is_idempotent) { is_idempotent_ = is_idempotent; }
+
   virtual int encode(int version, BufferVec* bufs) const = 0;
 
 private:
   uint8_t opcode_;
   CassConsistency consistency_;
   CassConsistency serial_consistency_;
+  bool is_idempotent_;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(Request);
@@ -72,6 +79,7 @@ public:
     , keyspace_(keyspace){}
 
   virtual bool get_routing_key(std::string* routing_key) const = 0;
+  virtual bool get_murmur3_token(int64_t* token) const = 0;
 
   const std::string& keyspace() const { return keyspace_; }
   void set_keyspace(const std::string& keyspace) { keyspace_ = keyspace; }
@@ -16,16 +16,19 @@
 
 #include "request_handler.hpp"
 
+#include "config.hpp"
 #include "connection.hpp"
 #include "error_response.hpp"
 #include "execute_request.hpp"
 #include "io_worker.hpp"
+#include "logger.hpp"
 #include "pool.hpp"
 #include "prepare_handler.hpp"
 #include "result_response.hpp"
 #include "row.hpp"
 #include "schema_change_handler.hpp"
 #include "session.hpp"
+#include "speculative_execution.hpp"
 
 #include <uv.h>
 
@@ -33,6 +36,10 @@ namespace cass {
 
 void RequestHandler::on_set(ResponseMessage* response) {
   assert(connection_ != NULL);
+  if (is_done_) { // Completed by a speculative execution
+    return_connection_and_finish();
+    return;
+  }
   assert(!is_query_plan_exhausted_ && "Tried to set on a non-existent host");
   switch (response->opcode()) {
     case CQL_OPCODE_RESULT:
@@ -49,6 +56,10 @@ void RequestHandler::on_set(ResponseMessage* response) {
 }
 
 void RequestHandler::on_error(CassError code, const std::string& message) {
+  if (is_done_) {
+    return_connection_and_finish();
+    return;
+  }
   if (code == CASS_ERROR_LIB_WRITE_ERROR ||
       code == CASS_ERROR_LIB_UNABLE_TO_SET_KEYSPACE) {
     retry(RETRY_WITH_NEXT_HOST);
@@ -60,9 +71,39 @@ void RequestHandler::on_error(CassError code, const std::string& message) {
 
 void RequestHandler::on_timeout() {
   assert(!is_query_plan_exhausted_ && "Tried to timeout on a non-existent host");
+  if (pool_ != NULL) {
+    pool_->on_request_timeout();
+  }
+  if (is_done_) {
+    return_connection_and_finish();
+    return;
+  }
   set_error(CASS_ERROR_LIB_REQUEST_TIMED_OUT, "Request timed out");
 }
 
+void RequestHandler::reset() {
+  Handler::reset();
+  request_.reset();
+  future_.reset();
+  is_query_plan_exhausted_ = true;
+  is_done_ = false;
+  speculative_execution_timer_.stop();
+  speculative_execution_count_ = 0;
+  current_host_ = SharedRefPtr<Host>();
+  query_plan_.reset();
+  query_plan_allocator_.reset();
+  io_worker_ = NULL;
+  pool_ = NULL;
+}
+
+void RequestHandler::dispose() {
+  if (object_pool_ != NULL) {
+    object_pool_->release(this);
+  } else {
+    delete this;
+  }
+}
+
 void RequestHandler::set_io_worker(IOWorker* io_worker) {
   future_->set_loop(io_worker->loop());
   io_worker_ = io_worker;
@@ -73,6 +114,11 @@ void RequestHandler::retry(RetryType type) {
   set_state(REQUEST_STATE_NEW);
   pool_ = NULL;
 
+  if (is_done_) {
+    return_connection_and_finish();
+    return;
+  }
+
   io_worker_->retry(this, type);
 }
 
@@ -95,17 +141,40 @@ bool RequestHandler::is_host_up(const Address& address) const {
 
 void RequestHandler::start_request() {
   start_time_ns_ = uv_hrtime();
+  if (!speculative_execution_timer_.is_running()) {
+    schedule_speculative_execution();
+  }
 }
 
 void RequestHandler::set_response(Response* response) {
   uint64_t elapsed = uv_hrtime() - start_time_ns_;
-  current_host_->update_latency(elapsed);
+  current_host_->update_latency(elapsed, io_worker_->index());
   connection_->metrics()->record_request(elapsed);
+  if (pool_ != NULL) {
+    pool_->on_request_success(elapsed);
+  }
+  is_done_ = true;
+  speculative_execution_timer_.stop();
   future_->set_result(current_host_->address(), response);
   return_connection_and_finish();
 }
 
+void RequestHandler::set_speculative_response(const SharedRefPtr<Host>& host,
+                                              Response* response,
+                                              uint64_t elapsed) {
+  assert(!is_done_ && "Tried to set a response on a completed request");
+  host->update_latency(elapsed, io_worker_->index());
+  io_worker_->metrics()->record_request(elapsed);
+  is_done_ = true;
+  speculative_execution_timer_.stop();
+  // The original request's stream is still in use, it finishes when its own
+  // response, error or timeout arrives
+  future_->set_result(host->address(), response);
+}
+
 void RequestHandler::set_error(CassError code, const std::string& message) {
+  is_done_ = true;
+  speculative_execution_timer_.stop();
   if (is_query_plan_exhausted_) {
     future_->set_error(code, message);
   } else {
@@ -128,6 +197,42 @@ void RequestHandler::return_connection_and_finish() {
   dec_ref();
 }
 
+void RequestHandler::schedule_speculative_execution() {
+  const Config& config = io_worker_->config();
+  if (is_done_ ||
+      !request_->is_idempotent() ||
+      speculative_execution_count_ >= config.max_speculative_executions()) {
+    return;
+  }
+
+  uint64_t delay_ms;
+  if (io_worker_->speculative_execution_delay(&delay_ms)) {
+    speculative_execution_timer_.start(io_worker_->timer_wheel(),
+                                       delay_ms,
+                                       this,
+                                       on_speculative_execution);
+  }
+}
+
+void RequestHandler::on_speculative_execution(RequestTimer* timer) {
+  RequestHandler* request_handler = static_cast<RequestHandler*>(timer->data());
+  if (request_handler->is_done_) return;
+
+  // Speculative executions use the same query plan so that a retry of the
+  // original request doesn't go to a host that's already been tried
+  while (SharedRefPtr<Host> host = request_handler->query_plan_->compute_next()) {
+    SharedRefPtr<SpeculativeExecution> speculative_execution(
+          new SpeculativeExecution(request_handler, host));
+    if (request_handler->io_worker_->execute_speculative(speculative_execution.get())) {
+      LOG_DEBUG("Started speculative execution on host %s",
+                host->address().to_string().c_str());
+      request_handler->speculative_execution_count_++;
+      request_handler->schedule_speculative_execution();
+      return;
+    }
+  }
+}
+
 void RequestHandler::on_result_response(ResponseMessage* response) {
   ResultResponse* result =
       static_cast<ResultResponse*>(response->response_body().get());
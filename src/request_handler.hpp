@@ -22,6 +22,7 @@
 #include "handler.hpp"
 #include "host.hpp"
 #include "load_balancing.hpp"
+#include "object_pool.hpp"
 #include "request.hpp"
 #include "response.hpp"
 #include "schema_metadata.hpp"
@@ -39,22 +40,64 @@ class Timer;
 
 class ResponseFuture : public ResultFuture<Response> {
 public:
-  ResponseFuture(const Schema& schema)
+  ResponseFuture()
       : ResultFuture<Response>(CASS_FUTURE_TYPE_RESPONSE)
-      , schema(schema) {}
+      , object_pool_(NULL) {}
+
+  void set_object_pool(ObjectPool<ResponseFuture>* object_pool) { object_pool_ = object_pool; }
+
+  // Keeps the mutex, condition and the capacity of "statement"
+  void reset() {
+    ResultFuture<Response>::reset();
+    statement.clear();
+    schema_snapshot = SharedRefPtr<const SchemaSnapshot>();
+  }
 
   std::string statement;
-  Schema schema;
+  // Only used by prepared statements to look up the partition key columns
+  SharedRefPtr<const SchemaSnapshot> schema_snapshot;
+
+protected:
+  virtual void dispose() {
+    if (object_pool_ != NULL) {
+      object_pool_->release(this);
+    } else {
+      delete this;
+    }
+  }
+
+private:
+  ObjectPool<ResponseFuture>* object_pool_;
 };
 
 class RequestHandler : public Handler {
 public:
+  RequestHandler()
+      : is_query_plan_exhausted_(true)
+      , is_done_(false)
+      , speculative_execution_count_(0)
+      , io_worker_(NULL)
+      , pool_(NULL)
+      , object_pool_(NULL) {}
+
   RequestHandler(const Request* request, ResponseFuture* future)
       : request_(request)
       , future_(future)
       , is_query_plan_exhausted_(true)
+      , is_done_(false)
+      , speculative_execution_count_(0)
       , io_worker_(NULL)
-      , pool_(NULL) {}
+      , pool_(NULL)
+      , object_pool_(NULL) {}
+
+  void init(const Request* request, ResponseFuture* future) {
+    request_.reset(request);
+    future_.reset(future);
+  }
+
+  void set_object_pool(ObjectPool<RequestHandler>* object_pool) { object_pool_ = object_pool; }
+
+  void reset();
 
   virtual const Request* request() const { return request_.get(); }
 
@@ -64,6 +107,10 @@ public:
   virtual void on_error(CassError code, const std::string& message);
   virtual void on_timeout();
 
+  // The request's query plan is allocated from the handler's own storage,
+  // which is reused when a pooled handler is recycled
+  QueryPlanAllocator* query_plan_allocator() { return &query_plan_allocator_; }
+
   void set_query_plan(QueryPlan* query_plan) {
     query_plan_.reset(query_plan);
   }
@@ -78,12 +125,24 @@ public:
 
   void retry(RetryType type);
   bool get_current_host_address(Address* address);
+  const SharedRefPtr<Host>& current_host() const { return current_host_; }
   void next_host();
 
   bool is_host_up(const Address& address) const;
 
   void set_response(Response* response);
 
+  // The future has been set, either by this request or one of its
+  // speculative executions. The request still finishes normally.
+  bool is_done() const { return is_done_; }
+
+  void set_speculative_response(const SharedRefPtr<Host>& host,
+                                Response* response,
+                                uint64_t elapsed);
+
+protected:
+  virtual void dispose();
+
 private:
   void set_error(CassError code, const std::string& message);
   void return_connection();
@@ -92,13 +151,22 @@ private:
   void on_result_response(ResponseMessage* response);
   void on_error_response(ResponseMessage* response);
 
+  void schedule_speculative_execution();
+  static void on_speculative_execution(RequestTimer* timer);
+
   ScopedRefPtr<const Request> request_;
   ScopedRefPtr<ResponseFuture> future_;
   bool is_query_plan_exhausted_;
+  bool is_done_;
+  RequestTimer speculative_execution_timer_;
+  unsigned speculative_execution_count_;
   SharedRefPtr<Host> current_host_;
+  // Declared before the plan so that it outlives it
+  QueryPlanAllocator query_plan_allocator_;
   ScopedPtr<QueryPlan> query_plan_;
   IOWorker* io_worker_;
   Pool* pool_;
+  ObjectPool<RequestHandler>* object_pool_;
   uint64_t start_time_ns_;
 };
 
@@ -17,6 +17,7 @@
 #include "response.hpp"
 
 #include "auth_responses.hpp"
+#include "compression.hpp"
 #include "error_response.hpp"
 #include "event_response.hpp"
 #include "ready_response.hpp"
@@ -67,31 +68,144 @@ bool ResponseMessage::allocate_body(int8_t opcode) {
   }
 }
 
-int ResponseMessage::decode(int version, char* input, size_t size) {
+size_t ResponseMessage::header_size(char* input) {
+  // The header size depends on the version (the first byte of the frame).
+  // Version 3 uses a 2 byte stream id.
+  return (static_cast<uint8_t>(input[0]) & 0x7F) >= 3
+         ? CASS_HEADER_SIZE_V3
+         : CASS_HEADER_SIZE_V1_AND_V2;
+}
+
+void ResponseMessage::decode_header(char* input) {
+  char* buffer = input;
+  version_ = *(buffer++);
+  flags_ = *(buffer++);
+  if (header_size_ == CASS_HEADER_SIZE_V3) {
+    uint16_t stream;
+    buffer = decode_uint16(buffer, stream);
+    stream_ = static_cast<int16_t>(stream);
+  } else {
+    stream_ = static_cast<int8_t>(*(buffer++));
+  }
+  opcode_ = *(buffer++);
+
+  decode_int32(buffer, length_);
+
+  is_header_received_ = true;
+}
+
+bool ResponseMessage::decode_body(int version) {
+  int32_t body_size = length_;
+  if (flags_ & CASS_FLAG_COMPRESSION) {
+    SharedRefPtr<RefBuffer> decompressed;
+    if (!Lz4Compressor::decompress(response_body_->data(), length_,
+                                   &decompressed, &body_size)) {
+      is_body_error_ = true;
+      return false;
+    }
+    response_body_->set_buffer(decompressed, decompressed->data());
+  }
+
+  if (!response_body_->decode(version, response_body_->data(), body_size)) {
+    is_body_error_ = true;
+    return false;
+  }
+
+  is_body_ready_ = true;
+  return true;
+}
+
+bool ResponseMessage::is_prepared_result(char* input, size_t frame_header_size,
+                                         int32_t length) {
+  // The opcode is the last byte before the length and a RESULT body starts
+  // with its kind. Compressed bodies are decompressed into a new buffer
+  // anyway.
+  char* opcode = input + frame_header_size - sizeof(int32_t) - 1;
+  bool is_compressed = (input[1] & CASS_FLAG_COMPRESSION) != 0;
+  if (static_cast<uint8_t>(*opcode) != CQL_OPCODE_RESULT ||
+      is_compressed || length < static_cast<int32_t>(sizeof(int32_t))) {
+    return false;
+  }
+  int32_t kind = 0;
+  decode_int32(input + frame_header_size, kind);
+  return kind == CASS_RESULT_KIND_PREPARED;
+}
+
+int ResponseMessage::decode_in_place(int version, RefBuffer* buffer,
+                                     size_t buffer_size,
+                                     char* input, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  size_t frame_header_size = header_size(input);
+  if (size < frame_header_size) {
+    return 0;
+  }
+
+  int32_t length = 0;
+  decode_int32(input + frame_header_size - sizeof(int32_t), length);
+  if (length < 0 ||
+      static_cast<size_t>(length) * MIN_DECODE_IN_PLACE_FRACTION < buffer_size ||
+      size - frame_header_size < static_cast<size_t>(length)) {
+    return 0; // Small frames are copied and frames spanning reads are buffered
+  }
+
+  if (is_prepared_result(input, frame_header_size, length)) {
+    return 0;
+  }
+
+  header_size_ = frame_header_size;
+  decode_header(input);
+  received_ = header_size_ + length_;
+
+  if (!allocate_body(opcode_) || !response_body_) {
+    return -1;
+  }
+
+  // The body references the read buffer directly
+  response_body_->set_buffer(SharedRefPtr<RefBuffer>(buffer),
+                             input + header_size_);
+
+  if (!decode_body(version)) {
+    return -1;
+  }
+
+  return received_;
+}
+
+int ResponseMessage::decode(int version, RefBuffer* buffer, size_t buffer_size,
+                            char* input, size_t size) {
+  if (buffer != NULL && received_ == 0) {
+    int consumed = decode_in_place(version, buffer, buffer_size, input, size);
+    if (consumed != 0) {
+      return consumed;
+    }
+  }
+
   char* input_pos = input;
 
   received_ += size;
 
   if (!is_header_received_) {
-    if (received_ >= CASS_HEADER_SIZE_V1_AND_V2) {
+    if (header_size_ == 0) {
+      if (size == 0) {
+        return 0;
+      }
+      header_size_ = header_size(input);
+    }
+
+    if (received_ >= header_size_) {
       // We may have received more data then we need, only copy what we need
-      size_t overage = received_ - CASS_HEADER_SIZE_V1_AND_V2;
+      size_t overage = received_ - header_size_;
       size_t needed = size - overage;
 
       memcpy(header_buffer_pos_, input_pos, needed);
       header_buffer_pos_ += needed;
       input_pos += needed;
-      assert(header_buffer_pos_ == header_buffer_ + CASS_HEADER_SIZE_V1_AND_V2);
-
-      char* buffer = header_buffer_;
-      version_ = *(buffer++);
-      flags_ = *(buffer++);
-      stream_ = *(buffer++);
-      opcode_ = *(buffer++);
-
-      decode_int32(buffer, length_);
+      assert(header_buffer_pos_ == header_buffer_ + header_size_);
 
-      is_header_received_ = true;
+      decode_header(header_buffer_);
 
       if (!allocate_body(opcode_) || !response_body_) {
         return -1;
@@ -109,7 +223,7 @@ int ResponseMessage::decode(int version, char* input, size_t size) {
   }
 
   const size_t remaining = size - (input_pos - input);
-  const size_t frame_size = CASS_HEADER_SIZE_V1_AND_V2 + length_;
+  const size_t frame_size = header_size_ + length_;
 
   if (received_ >= frame_size) {
     // We may have received more data then we need, only copy what we need
@@ -121,12 +235,9 @@ int ResponseMessage::decode(int version, char* input, size_t size) {
     input_pos += needed;
     assert(body_buffer_pos_ == response_body_->data() + length_);
 
-    if (!response_body_->decode(version, response_body_->data(), length_)) {
-      is_body_error_ = true;
+    if (!decode_body(version)) {
       return -1;
     }
-
-    is_body_ready_ = true;
   } else {
     // We haven't received all the data for the frame. We consume the entire
     // buffer.
@@ -30,16 +30,23 @@ namespace cass {
 class Response {
 public:
   Response(uint8_t opcode)
-      : opcode_(opcode) {}
+      : opcode_(opcode)
+      , data_(NULL) {}
 
   virtual ~Response() {}
 
   uint8_t opcode() const { return opcode_; }
 
-  char* data() const { return buffer_->data(); }
+  char* data() const { return data_; }
   const SharedRefPtr<RefBuffer>& buffer() const { return buffer_; }
   void set_buffer(size_t size) {
     buffer_ = SharedRefPtr<RefBuffer>(RefBuffer::create(size));
+    data_ = buffer_->data();
+  }
+  // Use a slice of an existing buffer (e.g. the read buffer) without copying
+  void set_buffer(const SharedRefPtr<RefBuffer>& buffer, char* data) {
+    buffer_ = buffer;
+    data_ = data;
   }
 
   virtual bool decode(int version, char* buffer, size_t size) = 0;
@@ -47,6 +54,7 @@ public:
 private:
   uint8_t opcode_;
   SharedRefPtr<RefBuffer> buffer_;
+  char* data_;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(Response);
@@ -54,6 +62,11 @@ private:
 
 class ResponseMessage {
 public:
+  // Bodies smaller than 1/MIN_DECODE_IN_PLACE_FRACTION of the read buffer
+  // are copied so that a response doesn't keep a whole read buffer alive
+  // (and out of the read buffer pool) for a small part of it
+  static const size_t MIN_DECODE_IN_PLACE_FRACTION = 4;
+
   ResponseMessage()
       : version_(0x02)
       , flags_(0)
@@ -61,6 +74,7 @@ public:
       , opcode_(0)
       , length_(0)
       , received_(0)
+      , header_size_(0)
       , is_header_received_(false)
       , header_buffer_pos_(header_buffer_)
       , is_body_ready_(false)
@@ -69,27 +83,41 @@ public:
 
   uint8_t opcode() const { return opcode_; }
 
-  int8_t stream() const { return stream_; }
+  int16_t stream() const { return stream_; }
 
   ScopedPtr<Response>& response_body() { return response_body_; }
 
   bool is_body_ready() const { return is_body_ready_; }
 
-  int decode(int version, char* input, size_t size);
+  // The buffer is optional. If it's provided then large frames that are
+  // completely contained in the input are decoded in place and the
+  // response references the buffer instead of copying the frame. PREPARED
+  // results are always copied because they're kept for the lifetime of the
+  // prepared statement.
+  int decode(int version, RefBuffer* buffer, size_t buffer_size,
+             char* input, size_t size);
 
 private:
+  static size_t header_size(char* input);
+  static bool is_prepared_result(char* input, size_t frame_header_size,
+                                 int32_t length);
+  void decode_header(char* input);
+  bool decode_body(int version);
+  int decode_in_place(int version, RefBuffer* buffer, size_t buffer_size,
+                      char* input, size_t size);
   bool allocate_body(int8_t opcode);
 
 private:
   uint8_t version_;
   int8_t flags_;
-  int8_t stream_;
+  int16_t stream_;
   uint8_t opcode_;
   int32_t length_;
   size_t received_;
+  size_t header_size_;
 
   bool is_header_received_;
-  char header_buffer_[CASS_HEADER_SIZE_V1_AND_V2];
+  char header_buffer_[CASS_HEADER_SIZE_V3];
   char* header_buffer_pos_;
 
   bool is_body_ready_;
@@ -84,6 +84,8 @@ size_t ResultResponse::find_column_indices(StringRef name,
 }
 
 bool ResultResponse::decode(int version, char* input, size_t size) {
+  protocol_version_ = version;
+
   char* buffer = decode_int32(input, kind_);
 
   switch (kind_) {
@@ -104,7 +106,7 @@ bool ResultResponse::decode(int version, char* input, size_t size) {
       break;
 
     case CASS_RESULT_KIND_SCHEMA_CHANGE:
-      return decode_schema_change(buffer);
+      return decode_schema_change(version, buffer);
       break;
 
     default:
@@ -198,10 +200,20 @@ bool ResultResponse::decode_prepared(int version, char* input) {
   return true;
 }
 
-bool ResultResponse::decode_schema_change(char* input) {
+bool ResultResponse::decode_schema_change(int version, char* input) {
   char* buffer = decode_string(input, &change_, change_size_);
-  buffer = decode_string(buffer, &keyspace_, keyspace_size_);
-  buffer = decode_string(buffer, &table_, table_size_);
+  if (version >= 3) {
+    // <change><target><options>
+    StringRef target;
+    buffer = decode_string_ref(buffer, &target);
+    buffer = decode_string(buffer, &keyspace_, keyspace_size_);
+    if (target == "TABLE") {
+      decode_string(buffer, &table_, table_size_);
+    }
+  } else {
+    buffer = decode_string(buffer, &keyspace_, keyspace_size_);
+    decode_string(buffer, &table_, table_size_);
+  }
   return true;
 }
 
@@ -36,6 +36,7 @@ class ResultResponse : public Response {
 public:
   ResultResponse()
       : Response(CQL_OPCODE_RESULT)
+      , protocol_version_(0)
       , kind_(0)
       , has_more_pages_(false)
       , paging_state_(NULL)
@@ -53,6 +54,8 @@ public:
     first_row_.set_result(this);
   }
 
+  int protocol_version() const { return protocol_version_; }
+
   int32_t kind() const { return kind_; }
 
   bool has_more_pages() const { return has_more_pages_; }
@@ -107,9 +110,10 @@ private:
 
   bool decode_prepared(int version, char* input);
 
-  bool decode_schema_change(char* input);
+  bool decode_schema_change(int version, char* input);
 
 private:
+  int protocol_version_;
   int32_t kind_;
   bool has_more_pages_; // row data
   ScopedRefPtr<ResultMetadata> metadata_;
@@ -17,6 +17,7 @@
 #ifndef __CASS_ROUND_ROBIN_POLICY_HPP_INCLUDED__
 #define __CASS_ROUND_ROBIN_POLICY_HPP_INCLUDED__
 
+#include "atomic.hpp"
 #include "cassandra.h"
 #include "copy_on_write_ptr.hpp"
 #include "load_balancing.hpp"
@@ -42,8 +43,9 @@ public:
 
   virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
                                     const Request* request,
-                                    const TokenMap& token_map) {
-    return new RoundRobinQueryPlan(hosts_, index_++);
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL) {
+    return new (allocator) RoundRobinQueryPlan(hosts_, index_.fetch_add(1, MEMORY_ORDER_RELAXED));
   }
 
   virtual void on_add(const SharedRefPtr<Host>& host) {
@@ -90,7 +92,7 @@ private:
   };
 
   CopyOnWriteHostVec hosts_;
-  size_t index_;
+  Atomic<size_t> index_;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(RoundRobinPolicy);
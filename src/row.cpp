@@ -61,9 +61,16 @@ char* decode_row(char* rows, const ResultResponse* result, ValueVec& output) {
     if (size >= 0) {
       if (type == CASS_VALUE_TYPE_MAP || type == CASS_VALUE_TYPE_LIST ||
           type == CASS_VALUE_TYPE_SET) {
-        uint16_t count = 0;
-        char* data = decode_uint16(buffer, count);
-        output.push_back(Value(&def, count, data, size - sizeof(uint16_t)));
+        int protocol_version = result->protocol_version();
+        if (protocol_version >= 3) {
+          int32_t count = 0;
+          char* data = decode_int32(buffer, count);
+          output.push_back(Value(protocol_version, &def, count, data, size - sizeof(int32_t)));
+        } else {
+          uint16_t count = 0;
+          char* data = decode_uint16(buffer, count);
+          output.push_back(Value(protocol_version, &def, count, data, size - sizeof(uint16_t)));
+        }
       } else {
         output.push_back(Value(type, buffer, size));
       }
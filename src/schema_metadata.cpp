@@ -294,7 +294,8 @@ void SchemaMetadata::add_json_list_field(int version, const Row* row, const std:
 
   collection.encode(version, encoded->data());
 
-  Value map(CASS_VALUE_TYPE_LIST,
+  Value map(version,
+            CASS_VALUE_TYPE_LIST,
             CASS_VALUE_TYPE_TEXT,
             CASS_VALUE_TYPE_UNKNOWN,
             d.Size(),
@@ -341,7 +342,8 @@ void SchemaMetadata::add_json_map_field(int version, const Row* row, const std::
 
   collection.encode(version, encoded->data());
 
-  Value map(CASS_VALUE_TYPE_MAP,
+  Value map(version,
+            CASS_VALUE_TYPE_MAP,
             CASS_VALUE_TYPE_TEXT,
             CASS_VALUE_TYPE_TEXT,
             d.MemberCount(),
@@ -19,6 +19,7 @@
 
 #include "copy_on_write_ptr.hpp"
 #include "iterator.hpp"
+#include "ref_counted.hpp"
 #include "scoped_lock.hpp"
 #include "scoped_ptr.hpp"
 #include "type_parser.hpp"
@@ -253,6 +254,27 @@ private:
   int protocol_version_;
 };
 
+// An immutable copy of the schema that's shared by every thread that needs
+// it. Taking the copy only increments a reference count and the session
+// thread's next update detaches from it (copy-on-write). ClusterMetadata
+// publishes a new snapshot with a higher version after every schema update.
+class SchemaSnapshot : public RefCounted<SchemaSnapshot> {
+public:
+  SchemaSnapshot(uint64_t version, const Schema& schema)
+    : version_(version)
+    , schema_(schema) {}
+
+  uint64_t version() const { return version_; }
+  const Schema& schema() const { return schema_; }
+
+private:
+  const uint64_t version_;
+  const Schema schema_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(SchemaSnapshot);
+};
+
 } // namespace cass
 
 #endif
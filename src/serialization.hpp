@@ -20,6 +20,7 @@
 #include "address.hpp"
 #include "cassandra.h"
 #include "common.hpp"
+#include "constants.hpp"
 #include "string_ref.hpp"
 
 #include <uv.h>
@@ -251,11 +252,55 @@ inline char* decode_string_multimap(char* input, StringMultimap& output) {
   return buffer;
 }
 
+inline char* skip_option(char* input) {
+  uint16_t type;
+  char* buffer = decode_uint16(input, type);
+  char* name;
+  size_t name_size;
+  uint16_t count;
+  switch (type) {
+    case CASS_VALUE_TYPE_CUSTOM:
+      buffer = decode_string(buffer, &name, name_size);
+      break;
+    case CASS_VALUE_TYPE_LIST:
+    case CASS_VALUE_TYPE_SET:
+      buffer = skip_option(buffer);
+      break;
+    case CASS_VALUE_TYPE_MAP:
+      buffer = skip_option(skip_option(buffer));
+      break;
+    case CASS_VALUE_TYPE_UDT_V3:
+      buffer = decode_string(buffer, &name, name_size); // keyspace
+      buffer = decode_string(buffer, &name, name_size); // type name
+      buffer = decode_uint16(buffer, count);
+      for (uint16_t i = 0; i < count; ++i) {
+        buffer = decode_string(buffer, &name, name_size);
+        buffer = skip_option(buffer);
+      }
+      break;
+    case CASS_VALUE_TYPE_TUPLE_V3:
+      buffer = decode_uint16(buffer, count);
+      for (uint16_t i = 0; i < count; ++i) {
+        buffer = skip_option(buffer);
+      }
+      break;
+    default:
+      break;
+  }
+  return buffer;
+}
+
 inline char* decode_option(char* input, uint16_t& type, char** class_name,
                            size_t& class_name_size) {
   char* buffer = decode_uint16(input, type);
   if (type == CASS_VALUE_TYPE_CUSTOM) {
     buffer = decode_string(buffer, class_name, class_name_size);
+  } else if (type == CASS_VALUE_TYPE_UDT_V3 ||
+             type == CASS_VALUE_TYPE_TUPLE_V3) {
+    // User types and tuples (protocol v3) are not supported yet. They are
+    // exposed as custom values so their raw bytes can still be retrieved.
+    buffer = skip_option(input);
+    type = CASS_VALUE_TYPE_CUSTOM;
   }
   return buffer;
 }
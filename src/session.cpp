@@ -23,6 +23,7 @@
 #include "resolver.hpp"
 #include "scoped_lock.hpp"
 #include "timer.hpp"
+#include "topology_snapshot.hpp"
 #include "types.hpp"
 
 extern "C" {
@@ -133,8 +134,12 @@ void  cass_session_get_metrics(CassSession* session,
 
 namespace cass {
 
+static const std::string NO_KEYSPACE;
+
 Session::Session()
     : state_(SESSION_STATE_CLOSED)
+    , response_future_pool_(new ObjectPool<ResponseFuture>(MAX_FREE_REQUESTS))
+    , request_handler_pool_(new ObjectPool<RequestHandler>(MAX_FREE_REQUESTS))
     , current_host_mark_(true)
     , pending_resolve_count_(0)
     , pending_pool_count_(0)
@@ -142,12 +147,14 @@ Session::Session()
     , current_io_worker_(0) {
   uv_mutex_init(&state_mutex_);
   uv_mutex_init(&hosts_mutex_);
+  uv_rwlock_init(&policy_rwlock_);
 }
 
 Session::~Session() {
   join();
   uv_mutex_destroy(&state_mutex_);
   uv_mutex_destroy(&hosts_mutex_);
+  uv_rwlock_destroy(&policy_rwlock_);
 }
 
 void Session::clear(const Config& config) {
@@ -161,26 +168,25 @@ void Session::clear(const Config& config) {
     hosts_.clear();
   }
   io_workers_.clear();
-  request_queue_.reset();
   cluster_meta_.clear();
   control_connection_.clear();
   current_host_mark_ = true;
   pending_resolve_count_ = 0;
   pending_pool_count_ = 0;
   pending_workers_count_ = 0;
-  current_io_worker_ = 0;
+  current_io_worker_.store(0);
 }
 
 int Session::init() {
   int rc = EventThread<SessionEvent>::init(config_.queue_size_event());
   if (rc != 0) return rc;
-  request_queue_.reset(
-      new AsyncQueue<MPMCQueue<RequestHandler*> >(config_.queue_size_io()));
-  rc = request_queue_->init(loop(), this, &Session::on_execute);
+  rc = timer_wheel_.init(loop());
   if (rc != 0) return rc;
 
+  cluster_meta_.init(loop());
+
   for (unsigned int i = 0; i < config_.thread_count_io(); ++i) {
-    SharedRefPtr<IOWorker> io_worker(new IOWorker(this));
+    SharedRefPtr<IOWorker> io_worker(new IOWorker(this, i));
     int rc = io_worker->init();
     if (rc != 0) return rc;
     io_workers_.push_back(io_worker);
@@ -192,7 +198,8 @@ int Session::init() {
 void Session::broadcast_keyspace_change(const std::string& keyspace,
                                         const IOWorker* calling_io_worker) {
   // This can run on an IO worker thread. This is thread-safe because the IO workers
-  // vector never changes after initialization and IOWorker::set_keyspace() uses a mutex.
+  // vector never changes after initialization and IOWorker::set_keyspace() publishes
+  // the keyspace atomically.
   // This also means that calling "USE <keyspace>" frequently is an anti-pattern.
   for (IOWorkerVec::iterator it = io_workers_.begin(),
        end = io_workers_.end(); it != end; ++it) {
@@ -213,7 +220,7 @@ SharedRefPtr<Host> Session::get_host(const Address& address) {
 
 SharedRefPtr<Host> Session::add_host(const Address& address) {
   LOG_DEBUG("Adding new host: %s", address.to_string().c_str());
-  SharedRefPtr<Host> host(new Host(address, !current_host_mark_));
+  SharedRefPtr<Host> host(new Host(address, !current_host_mark_, config_.thread_count_io()));
   { // Lock hosts
     ScopedMutex l(&hosts_mutex_);
     hosts_[address] = host;
@@ -342,7 +349,10 @@ void Session::internal_connect() {
 }
 
 void Session::internal_close() {
-  while (!request_queue_->enqueue(NULL)) {
+  SessionEvent event;
+  event.type = SessionEvent::CLOSE;
+
+  while (!send_event_async(event)) {
     // Keep trying
   }
 
@@ -379,8 +389,14 @@ void Session::notify_closed() {
 
 void Session::close_handles() {
   EventThread<SessionEvent>::close_handles();
-  request_queue_->close_handles();
+  timer_wheel_.close_handles();
   load_balancing_policy_->close_handles();
+  LOG_DEBUG("Request object pool stats: %u future(s) allocated for %u request(s), "
+            "%u request handler(s) allocated for %u request(s)",
+            static_cast<unsigned int>(response_future_pool_->allocation_count()),
+            static_cast<unsigned int>(response_future_pool_->acquire_count()),
+            static_cast<unsigned int>(request_handler_pool_->allocation_count()),
+            static_cast<unsigned int>(request_handler_pool_->acquire_count()));
 }
 
 void Session::on_run() {
@@ -420,6 +436,10 @@ void Session::on_event(const SessionEvent& event) {
         }
       }
 
+      if (!config_.topology_snapshot_file().empty()) {
+        load_topology_snapshot();
+      }
+
       if (pending_resolve_count_ == 0) {
         internal_connect();
       }
@@ -427,6 +447,14 @@ void Session::on_event(const SessionEvent& event) {
       break;
     }
 
+    case SessionEvent::CLOSE:
+      pending_workers_count_ = io_workers_.size();
+      for (IOWorkerVec::iterator it = io_workers_.begin(),
+           end = io_workers_.end(); it != end; ++it) {
+        (*it)->close_async();
+      }
+      break;
+
     case SessionEvent::NOTIFY_READY:
       if (pending_pool_count_ > 0) {
         if (--pending_pool_count_ == 0) {
@@ -472,16 +500,93 @@ void Session::on_resolve(Resolver* resolver) {
   }
 }
 
+// The snapshot's hosts are added as contact points and its tokens are used to
+// build the token map before the control connection is ready. Hosts that are
+// no longer part of the cluster are purged once the system tables are read.
+void Session::load_topology_snapshot() {
+  const std::string& path = config_.topology_snapshot_file();
+
+  TopologySnapshot snapshot;
+  if (!snapshot.load(path)) {
+    LOG_DEBUG("No topology snapshot loaded from '%s'", path.c_str());
+    return;
+  }
+
+  LOG_INFO("Loaded %u host(s) and %u keyspace(s) from topology snapshot '%s'",
+           static_cast<unsigned int>(snapshot.hosts.size()),
+           static_cast<unsigned int>(snapshot.keyspaces.size()),
+           path.c_str());
+
+  bool use_tokens = config_.token_aware_routing() && !snapshot.partitioner.empty();
+  if (use_tokens) {
+    cluster_meta_.set_partitioner(snapshot.partitioner);
+  }
+
+  for (TopologySnapshot::HostEntryVec::const_iterator i = snapshot.hosts.begin();
+       i != snapshot.hosts.end(); ++i) {
+    SharedRefPtr<Host> host = get_host(i->address);
+    if (!host) {
+      host = add_host(i->address);
+    }
+    host->set_rack_and_dc(i->rack, i->dc);
+
+    if (use_tokens && !i->tokens.empty()) {
+      TokenStringList tokens(i->tokens.begin(), i->tokens.end());
+      cluster_meta_.update_host(host, tokens);
+    }
+  }
+
+  if (use_tokens) {
+    for (TopologySnapshot::KeyspaceStrategyMap::const_iterator i = snapshot.keyspaces.begin();
+         i != snapshot.keyspaces.end(); ++i) {
+      cluster_meta_.update_keyspace(i->first, i->second);
+    }
+    cluster_meta_.build();
+  }
+}
+
+// This runs on the application thread. The query plan is created here and
+// the request is handed directly to an IO worker instead of going through
+// the session thread first.
 void Session::execute(RequestHandler* request_handler) {
-  if (!request_queue_->enqueue(request_handler)) {
-    request_handler->on_error(CASS_ERROR_LIB_REQUEST_QUEUE_FULL,
-                              "The request queue has reached capacity");
+  request_handler->set_query_plan(new_query_plan(request_handler->request(),
+                                                 request_handler->query_plan_allocator()));
+
+  bool is_queue_full = false;
+  while (true) {
+    request_handler->next_host();
+
+    const SharedRefPtr<Host>& host = request_handler->current_host();
+    if (!host) {
+      if (is_queue_full) {
+        request_handler->on_error(CASS_ERROR_LIB_REQUEST_QUEUE_FULL,
+                                  "The request queue has reached capacity");
+      } else {
+        request_handler->on_error(CASS_ERROR_LIB_NO_HOSTS_AVAILABLE,
+                                  "All connections on all I/O threads are busy");
+      }
+      return;
+    }
+
+    size_t start = current_io_worker_.fetch_add(1, MEMORY_ORDER_RELAXED);
+    for (size_t i = 0, size = io_workers_.size(); i < size; ++i) {
+      const SharedRefPtr<IOWorker>& io_worker = io_workers_[(start + i) % size];
+      if (io_worker->is_host_available(*host)) {
+        if (io_worker->execute(request_handler)) {
+          return;
+        }
+        is_queue_full = true;
+      }
+    }
   }
 }
 
 void Session::on_control_connection_ready() {
   // No hosts lock necessary (only called on session thread and read-only)
-  load_balancing_policy_->init(control_connection_.connected_host(), hosts_);
+  {
+    ScopedWriteLock l(&policy_rwlock_);
+    load_balancing_policy_->init(control_connection_.connected_host(), hosts_);
+  }
   load_balancing_policy_->register_handles(loop());
   for (IOWorkerVec::iterator it = io_workers_.begin(),
        end = io_workers_.end(); it != end; ++it) {
@@ -505,11 +610,13 @@ Future* Session::prepare(const char* statement, size_t length) {
   PrepareRequest* prepare = new PrepareRequest();
   prepare->set_query(statement, length);
 
-  ResponseFuture* future = new ResponseFuture(cluster_meta_.schema());
+  ResponseFuture* future = response_future_pool_->acquire();
+  future->schema_snapshot = cluster_meta_.schema_snapshot();
   future->inc_ref(); // External reference
   future->statement.assign(statement, length);
 
-  RequestHandler* request_handler = new RequestHandler(prepare, future);
+  RequestHandler* request_handler = request_handler_pool_->acquire();
+  request_handler->init(prepare, future);
   request_handler->inc_ref(); // IOWorker reference
 
   execute(request_handler);
@@ -527,6 +634,7 @@ void Session::on_add(SharedRefPtr<Host> host, bool is_initial_connection) {
   if (is_initial_connection) {
     pending_pool_count_ += io_workers_.size();
   } else {
+    ScopedWriteLock l(&policy_rwlock_);
     load_balancing_policy_->on_add(host);
   }
 
@@ -537,7 +645,10 @@ void Session::on_add(SharedRefPtr<Host> host, bool is_initial_connection) {
 }
 
 void Session::on_remove(SharedRefPtr<Host> host) {
-  load_balancing_policy_->on_remove(host);
+  {
+    ScopedWriteLock l(&policy_rwlock_);
+    load_balancing_policy_->on_remove(host);
+  }
   { // Lock hosts
     ScopedMutex l(&hosts_mutex_);
     hosts_.erase(host->address());
@@ -555,7 +666,10 @@ void Session::on_up(SharedRefPtr<Host> host) {
     return;
   }
 
-  load_balancing_policy_->on_up(host);
+  {
+    ScopedWriteLock l(&policy_rwlock_);
+    load_balancing_policy_->on_up(host);
+  }
 
   for (IOWorkerVec::iterator it = io_workers_.begin(),
        end = io_workers_.end(); it != end; ++it) {
@@ -565,7 +679,10 @@ void Session::on_up(SharedRefPtr<Host> host) {
 
 void Session::on_down(SharedRefPtr<Host> host) {
   host->set_down();
-  load_balancing_policy_->on_down(host);
+  {
+    ScopedWriteLock l(&policy_rwlock_);
+    load_balancing_policy_->on_down(host);
+  }
 
   bool cancel_reconnect = false;
   if (load_balancing_policy_->distance(host) == CASS_HOST_DISTANCE_IGNORE) {
@@ -580,10 +697,11 @@ void Session::on_down(SharedRefPtr<Host> host) {
 }
 
 Future* Session::execute(const RoutableRequest* request) {
-  ResponseFuture* future = new ResponseFuture(cluster_meta_.schema());
+  ResponseFuture* future = response_future_pool_->acquire();
   future->inc_ref(); // External reference
 
-  RequestHandler* request_handler = new RequestHandler(request, future);
+  RequestHandler* request_handler = request_handler_pool_->acquire();
+  request_handler->init(request, future);
   request_handler->inc_ref(); // IOWorker reference
 
   execute(request_handler);
@@ -591,64 +709,19 @@ Future* Session::execute(const RoutableRequest* request) {
   return future;
 }
 
-#if UV_VERSION_MAJOR == 0
-void Session::on_execute(uv_async_t* data, int status) {
-#else
-void Session::on_execute(uv_async_t* data) {
-#endif
-  Session* session = static_cast<Session*>(data->data);
-
-  bool is_closing = false;
-
-  RequestHandler* request_handler = NULL;
-  while (session->request_queue_->dequeue(request_handler)) {
-    if (request_handler != NULL) {
-      request_handler->set_query_plan(session->new_query_plan(request_handler->request()));
-
-      bool is_done = false;
-      while (!is_done) {
-        request_handler->next_host();
-
-        Address address;
-        if (!request_handler->get_current_host_address(&address)) {
-          request_handler->on_error(CASS_ERROR_LIB_NO_HOSTS_AVAILABLE,
-                                    "All connections on all I/O threads are busy");
-          break;
-        }
-
-        size_t start = session->current_io_worker_;
-        for (size_t i = 0, size = session->io_workers_.size(); i < size; ++i) {
-          const SharedRefPtr<IOWorker>& io_worker = session->io_workers_[start % size];
-          if (io_worker->is_host_available(address) &&
-              io_worker->execute(request_handler)) {
-            session->current_io_worker_ = (start + 1) % size;
-            is_done = true;
-            break;
-          }
-          start++;
-        }
-      }
-    } else {
-      is_closing = true;
-    }
-  }
-
-  if (is_closing) {
-    session->pending_workers_count_ = session->io_workers_.size();
-    for (IOWorkerVec::iterator it = session->io_workers_.begin(),
-                               end = session->io_workers_.end();
-         it != end; ++it) {
-      (*it)->close_async();
-    }
-  }
-}
-
-QueryPlan* Session::new_query_plan(const Request* request) {
-  std::string connected_keyspace;
-  if (!io_workers_.empty()) {
-    connected_keyspace = io_workers_[0]->keyspace();
-  }
-  return load_balancing_policy_->new_query_plan(connected_keyspace, request, cluster_meta_.token_map());
+QueryPlan* Session::new_query_plan(const Request* request,
+                                   QueryPlanAllocator* allocator) {
+  // The keyspace is published by the IO workers and isn't copied
+  const std::string& connected_keyspace
+      = io_workers_.empty() ? NO_KEYSPACE : io_workers_[0]->keyspace();
+  // Host availability and the keyspace are read without locks, but the
+  // policies' state is still updated in place under the write lock and the
+  // token map snapshot is copied under its mutex. Both are only held long
+  // enough to build the plan (or copy a pointer) and are uncontended unless
+  // the topology is changing.
+  ScopedReadLock l(&policy_rwlock_);
+  return cluster_meta_.new_query_plan(load_balancing_policy_.get(),
+                                      connected_keyspace, request, allocator);
 }
 
 } // namespace cass
@@ -17,6 +17,7 @@
 #ifndef __CASS_SESSION_HPP_INCLUDED__
 #define __CASS_SESSION_HPP_INCLUDED__
 
+#include "atomic.hpp"
 #include "cluster_metadata.hpp"
 #include "config.hpp"
 #include "control_connection.hpp"
@@ -26,12 +27,13 @@
 #include "io_worker.hpp"
 #include "load_balancing.hpp"
 #include "metrics.hpp"
-#include "mpmc_queue.hpp"
+#include "object_pool.hpp"
 #include "ref_counted.hpp"
 #include "row.hpp"
 #include "schema_metadata.hpp"
 #include "scoped_lock.hpp"
 #include "scoped_ptr.hpp"
+#include "timer_wheel.hpp"
 
 #include <list>
 #include <memory>
@@ -47,11 +49,13 @@ class Future;
 class IOWorker;
 class Resolver;
 class Request;
+class ResponseFuture;
 
 struct SessionEvent {
   enum Type {
     INVALID,
     CONNECT,
+    CLOSE,
     NOTIFY_READY,
     NOTIFY_WORKER_CLOSED,
     NOTIFY_UP,
@@ -67,6 +71,10 @@ struct SessionEvent {
 
 class Session : public EventThread<SessionEvent> {
 public:
+  // The maximum number of idle futures and request handlers that are kept
+  // for reuse
+  static const size_t MAX_FREE_REQUESTS = 1024;
+
   enum State {
     SESSION_STATE_CONNECTING,
     SESSION_STATE_CONNECTED,
@@ -79,6 +87,7 @@ public:
 
   const Config& config() const { return config_; }
   Metrics* metrics() const { return metrics_.get(); }
+  TimerWheel* timer_wheel() { return &timer_wheel_; }
 
   void set_load_balancing_policy(LoadBalancingPolicy* policy) {
     load_balancing_policy_.reset(policy);
@@ -102,6 +111,15 @@ public:
 
   const Schema* copy_schema() const { return cluster_meta_.copy_schema(); }
 
+  // Used to verify that the request path reaches an allocation-free
+  // steady state
+  const ObjectPool<ResponseFuture>* response_future_pool() const {
+    return response_future_pool_.get();
+  }
+  const ObjectPool<RequestHandler>* request_handler_pool() const {
+    return request_handler_pool_.get();
+  }
+
 private:
   void clear(const Config& config);
   int init();
@@ -123,13 +141,10 @@ private:
 
   static void on_resolve(Resolver* resolver);
 
-#if UV_VERSION_MAJOR == 0
-  static void on_execute(uv_async_t* data, int status);
-#else
-  static void on_execute(uv_async_t* data);
-#endif
+  void load_topology_snapshot();
 
-  QueryPlan* new_query_plan(const Request* request = NULL);
+  QueryPlan* new_query_plan(const Request* request = NULL,
+                            QueryPlanAllocator* allocator = NULL);
 
   void on_reconnect(Timer* timer);
 
@@ -160,22 +175,30 @@ private:
 
   Config config_;
   ScopedPtr<Metrics> metrics_;
+  TimerWheel timer_wheel_;
   ScopedRefPtr<LoadBalancingPolicy> load_balancing_policy_;
+  // Query plans are created on application threads so the session thread
+  // holds the write lock while it updates the load balancing policy
+  uv_rwlock_t policy_rwlock_;
   ScopedRefPtr<Future> connect_future_;
   ScopedRefPtr<Future> close_future_;
 
+  // Futures and request handlers are recycled across requests. They can
+  // outlive the session so the pools are reference counted.
+  ScopedRefPtr<ObjectPool<ResponseFuture> > response_future_pool_;
+  ScopedRefPtr<ObjectPool<RequestHandler> > request_handler_pool_;
+
   HostMap hosts_;
   uv_mutex_t hosts_mutex_;
 
   IOWorkerVec io_workers_;
-  ScopedPtr<AsyncQueue<MPMCQueue<RequestHandler*> > > request_queue_;
   ClusterMetadata cluster_meta_;
   ControlConnection control_connection_;
   bool current_host_mark_;
   int pending_resolve_count_;
   int pending_pool_count_;
   int pending_workers_count_;
-  int current_io_worker_;
+  Atomic<size_t> current_io_worker_;
 };
 
 class SessionFuture : public Future {
@@ -0,0 +1,84 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "speculative_execution.hpp"
+
+#include "connection.hpp"
+#include "execute_request.hpp"
+#include "logger.hpp"
+#include "pool.hpp"
+#include "result_response.hpp"
+
+#include <uv.h>
+
+namespace cass {
+
+void SpeculativeExecution::start_request() {
+  start_time_ns_ = uv_hrtime();
+}
+
+void SpeculativeExecution::on_set(ResponseMessage* response) {
+  if (response->opcode() == CQL_OPCODE_RESULT && !request_handler_->is_done()) {
+    ResultResponse* result =
+        static_cast<ResultResponse*>(response->response_body().get());
+    // Keyspace and schema changes require additional handling so they're
+    // left to the original request
+    if (result->kind() == CASS_RESULT_KIND_ROWS ||
+        result->kind() == CASS_RESULT_KIND_VOID) {
+      bool is_valid = true;
+      if (result->kind() == CASS_RESULT_KIND_ROWS &&
+          request()->opcode() == CQL_OPCODE_EXECUTE && result->no_metadata()) {
+        const ExecuteRequest* execute = static_cast<const ExecuteRequest*>(request());
+        if (execute->skip_metadata()) {
+          result->set_metadata(execute->prepared()->result()->result_metadata().get());
+        } else {
+          is_valid = false; // See RequestHandler::on_result_response()
+        }
+      }
+      if (is_valid) {
+        uint64_t elapsed = uv_hrtime() - start_time_ns_;
+        if (pool_ != NULL) {
+          pool_->on_request_success(elapsed);
+        }
+        LOG_DEBUG("Using the result of the speculative execution on host %s",
+                  host_->address().to_string().c_str());
+        request_handler_->set_speculative_response(host_,
+                                                   response->response_body().release(),
+                                                   elapsed);
+      }
+    }
+  }
+  return_connection();
+}
+
+void SpeculativeExecution::on_error(CassError code, const std::string& message) {
+  return_connection();
+}
+
+void SpeculativeExecution::on_timeout() {
+  if (pool_ != NULL) {
+    pool_->on_request_timeout();
+  }
+  return_connection();
+}
+
+void SpeculativeExecution::return_connection() {
+  if (pool_ != NULL && connection_ != NULL) {
+    pool_->return_connection(connection_);
+  }
+}
+
+} // namespace cass
@@ -0,0 +1,67 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_SPECULATIVE_EXECUTION_HPP_INCLUDED__
+#define __CASS_SPECULATIVE_EXECUTION_HPP_INCLUDED__
+
+#include "handler.hpp"
+#include "host.hpp"
+#include "ref_counted.hpp"
+#include "request_handler.hpp"
+
+namespace cass {
+
+class Pool;
+class ResponseMessage;
+
+// An additional attempt of an idempotent request on another host. It's
+// started when the request hasn't received a response after the speculative
+// execution delay. Only a successful result is used, everything else is left
+// to the original request.
+class SpeculativeExecution : public Handler {
+public:
+  SpeculativeExecution(RequestHandler* request_handler,
+                       const SharedRefPtr<Host>& host)
+    : request_handler_(request_handler)
+    , host_(host)
+    , pool_(NULL)
+    , start_time_ns_(0) {}
+
+  virtual const Request* request() const { return request_handler_->request(); }
+
+  virtual void start_request();
+
+  virtual void on_set(ResponseMessage* response);
+  virtual void on_error(CassError code, const std::string& message);
+  virtual void on_timeout();
+
+  const SharedRefPtr<Host>& host() const { return host_; }
+
+  void set_pool(Pool* pool) { pool_ = pool; }
+
+private:
+  void return_connection();
+
+private:
+  ScopedRefPtr<RequestHandler> request_handler_;
+  SharedRefPtr<Host> host_;
+  Pool* pool_;
+  uint64_t start_time_ns_;
+};
+
+} // namespace cass
+
+#endif
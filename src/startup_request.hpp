@@ -28,10 +28,10 @@ namespace cass {
 
 class StartupRequest : public Request {
 public:
-  StartupRequest()
+  StartupRequest(const std::string& compression = "")
       : Request(CQL_OPCODE_STARTUP)
       , version_("3.0.0")
-      , compression_("") {}
+      , compression_(compression) {}
 
   bool encode(size_t reserved, char** output, size_t& size);
 
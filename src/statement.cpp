@@ -22,6 +22,7 @@
 #include "query_request.hpp"
 #include "scoped_ptr.hpp"
 #include "string_ref.hpp"
+#include "token_map.hpp"
 #include "types.hpp"
 
 #include <uv.h>
@@ -198,6 +199,16 @@ CassError cass_statement_set_keyspace_n(CassStatement* statement,
   return CASS_OK;
 }
 
+CassError cass_statement_murmur3_token(const CassStatement* statement,
+                                       cass_int64_t* token) {
+  int64_t value;
+  if (!statement->get_murmur3_token(&value)) {
+    return CASS_ERROR_LIB_NO_ROUTING_KEY;
+  }
+  *token = value;
+  return CASS_OK;
+}
+
 void cass_statement_free(CassStatement* statement) {
   statement->dec_ref();
 }
@@ -214,6 +225,12 @@ CassError cass_statement_set_serial_consistency(CassStatement* statement,
   return CASS_OK;
 }
 
+CassError cass_statement_set_is_idempotent(CassStatement* statement,
+                                           cass_bool_t is_idempotent) {
+  statement->set_is_idempotent(is_idempotent == cass_true);
+  return CASS_OK;
+}
+
 CassError cass_statement_set_paging_size(CassStatement* statement,
                                          int page_size) {
   statement->set_page_size(page_size);
@@ -534,26 +551,61 @@ static int32_t decode_buffer_size(const Buffer& buffer) {
   return size;
 }
 
-int32_t Statement::encode_values(int version, BufferVec* bufs) const {
-  int32_t values_size = 0;
+void Statement::encode_values(int version, BufferBuilder* builder) const {
   for (ValueVec::const_iterator it = values_.begin(), end = values_.end();
        it != end; ++it) {
-    if (it->is_empty()) {
-      Buffer buf(sizeof(int32_t));
-      buf.encode_int32(0, -1); // [bytes] "null"
-      bufs->push_back(buf);
-      values_size += sizeof(int32_t);
-    } else if (it->is_collection()) {
-      values_size += it->collection()->encode(version, bufs);
-    } else {
-      bufs->push_back(*it);
-      values_size += it->size();
-    }
+    builder->append_value(version, *it);
   }
-  return values_size;
 }
 
 bool Statement::get_routing_key(std::string* routing_key)  const {
+  if (load_routing_cache()) {
+    if (!has_cached_routing_key_) return false;
+    *routing_key = cached_routing_key_;
+    return true;
+  }
+  return compute_routing_key(routing_key);
+}
+
+bool Statement::get_murmur3_token(int64_t* token) const {
+  if (load_routing_cache()) {
+    if (!has_cached_routing_key_) return false;
+    *token = cached_token_;
+    return true;
+  }
+
+  std::string routing_key;
+  if (!compute_routing_key(&routing_key)) return false;
+  *token = Murmur3Partitioner::hash_int64(reinterpret_cast<const uint8_t*>(routing_key.data()),
+                                          routing_key.size());
+  return true;
+}
+
+// Returns false if another thread is filling the cache at the same time, in
+// which case the caller computes the values itself. Binding values while the
+// statement is being executed isn't supported so the cache can't be
+// invalidated while it's being read.
+bool Statement::load_routing_cache() const {
+  int state = routing_cache_state_.load(MEMORY_ORDER_ACQUIRE);
+  if (state == ROUTING_CACHE_VALID) return true;
+
+  if (state != ROUTING_CACHE_INVALID ||
+      !routing_cache_state_.compare_exchange_strong(state, ROUTING_CACHE_UPDATING)) {
+    return false;
+  }
+
+  has_cached_routing_key_ = compute_routing_key(&cached_routing_key_);
+  if (has_cached_routing_key_) {
+    cached_token_
+        = Murmur3Partitioner::hash_int64(reinterpret_cast<const uint8_t*>(cached_routing_key_.data()),
+                                         cached_routing_key_.size());
+  }
+
+  routing_cache_state_.store(ROUTING_CACHE_VALID, MEMORY_ORDER_RELEASE);
+  return true;
+}
+
+bool Statement::compute_routing_key(std::string* routing_key)  const {
   if (key_indices_.empty()) return false;
 
   if (key_indices_.size() == 1) {
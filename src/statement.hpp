@@ -17,7 +17,9 @@
 #ifndef __CASS_STATEMENT_HPP_INCLUDED__
 #define __CASS_STATEMENT_HPP_INCLUDED__
 
+#include "atomic.hpp"
 #include "buffer.hpp"
+#include "buffer_builder.hpp"
 #include "buffer_collection.hpp"
 #include "macros.hpp"
 #include "request.hpp"
@@ -62,7 +64,10 @@ public:
       , values_(value_count)
       , skip_metadata_(false)
       , page_size_(-1)
-      , kind_(kind) {}
+      , kind_(kind)
+      , routing_cache_state_(ROUTING_CACHE_INVALID)
+      , has_cached_routing_key_(false)
+      , cached_token_(0) {}
 
   Statement(uint8_t opcode, uint8_t kind, size_t value_count,
             const std::vector<size_t>& key_indices,
@@ -72,7 +77,10 @@ public:
       , skip_metadata_(false)
       , page_size_(-1)
       , kind_(kind)
-      , key_indices_(key_indices) {}
+      , key_indices_(key_indices)
+      , routing_cache_state_(ROUTING_CACHE_INVALID)
+      , has_cached_routing_key_(false)
+      , cached_token_(0) {}
 
   virtual ~Statement() {}
 
@@ -100,9 +108,15 @@ public:
 
   size_t values_count() const { return values_.size(); }
 
-  void add_key_index(size_t index) { key_indices_.push_back(index); }
+  void add_key_index(size_t index) {
+    key_indices_.push_back(index);
+    invalidate_routing_cache();
+  }
 
+  // The routing key and its Murmur3 token are computed on first use and
+  // cached until a key column is rebound.
   virtual bool get_routing_key(std::string* routing_key)  const;
+  virtual bool get_murmur3_token(int64_t* token) const;
 
 #define BIND_FIXED_TYPE(DeclType, EncodeType)						\
   CassError bind(size_t index, const DeclType& value) { \
@@ -110,7 +124,7 @@ public:
     Buffer buf(sizeof(int32_t) + sizeof(DeclType));     \
     size_t pos = buf.encode_int32(0, sizeof(DeclType)); \
     buf.encode_##EncodeType(pos, value);                \
-    values_[index] = buf;                               \
+    set_value(index, buf);                              \
     return CASS_OK;                                     \
   }
 
@@ -125,7 +139,7 @@ public:
     CASS_VALUE_CHECK_INDEX(index);
     Buffer buf(sizeof(int32_t));
     buf.encode_int32(0, -1); // [bytes] "null"
-    values_[index] = buf;
+    set_value(index, buf);
     return CASS_OK;
   }
 
@@ -142,7 +156,7 @@ public:
     Buffer buf(sizeof(int32_t) + sizeof(CassUuid));
     size_t pos = buf.encode_int32(0, sizeof(CassUuid));
     buf.encode_uuid(pos, value);
-    values_[index] = buf;
+    set_value(index, buf);
     return CASS_OK;
   }
 
@@ -160,7 +174,7 @@ public:
     size_t pos = buf.encode_int32(0, sizeof(int32_t) + varint_size);
     pos = buf.encode_int32(pos, scale);
     buf.copy(pos, varint, varint_size);
-    values_[index] = buf;
+    set_value(index, buf);
     return CASS_OK;
   }
 
@@ -169,7 +183,7 @@ public:
     if (collection->is_map() && collection->item_count() % 2 != 0) {
       return CASS_ERROR_LIB_INVALID_ITEM_COUNT;
     }
-    values_[index] = Buffer(collection);
+    set_value(index, Buffer(collection));
     return CASS_OK;
   }
 
@@ -178,7 +192,7 @@ public:
     Buffer buf(4 + custom.output_size);
     size_t pos = buf.encode_int32(0, custom.output_size);
     *(custom.output) = reinterpret_cast<uint8_t*>(buf.data() + pos);
-    values_[index] = buf;
+    set_value(index, buf);
     return CASS_OK;
   }
 
@@ -187,7 +201,7 @@ public:
     Buffer buf(sizeof(int32_t) + value_length);
     size_t pos = buf.encode_int32(0, value_length);
     buf.copy(pos, value, value_length);
-    values_[index] = buf;
+    set_value(index, buf);
     return CASS_OK;
   }
 
@@ -195,9 +209,37 @@ public:
     return bind(index, reinterpret_cast<const char*>(value), value_length);
   }
 
-  int32_t encode_values(int version, BufferVec*  bufs) const;
+  void encode_values(int version, BufferBuilder* builder) const;
 
 private:
+  enum {
+    ROUTING_CACHE_INVALID,
+    ROUTING_CACHE_UPDATING,
+    ROUTING_CACHE_VALID
+  };
+
+  void set_value(size_t index, const Buffer& value) {
+    values_[index] = value;
+    if (is_key_index(index)) {
+      invalidate_routing_cache();
+    }
+  }
+
+  bool is_key_index(size_t index) const {
+    for (std::vector<size_t>::const_iterator i = key_indices_.begin(),
+         end = key_indices_.end(); i != end; ++i) {
+      if (*i == index) return true;
+    }
+    return false;
+  }
+
+  void invalidate_routing_cache() {
+    routing_cache_state_.store(ROUTING_CACHE_INVALID, MEMORY_ORDER_RELAXED);
+  }
+
+  bool load_routing_cache() const;
+  bool compute_routing_key(std::string* routing_key) const;
+
   typedef BufferVec ValueVec;
 
   ValueVec values_;
@@ -207,6 +249,11 @@ private:
   uint8_t kind_;
   std::vector<size_t> key_indices_;
 
+  mutable Atomic<int> routing_cache_state_;
+  mutable bool has_cached_routing_key_;
+  mutable std::string cached_routing_key_;
+  mutable int64_t cached_token_;
+
 private:
   DISALLOW_COPY_AND_ASSIGN(Statement);
 };
@@ -18,42 +18,95 @@
 #define __CASS_STREAM_MANAGER_HPP_INCLUDED__
 
 #include <assert.h>
+#include <vector>
 
 #include <uv.h>
 
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
 namespace cass {
 
+inline int count_trailing_zeros(uint64_t word) {
+  assert(word != 0);
+#if defined(_MSC_VER)
+#  if defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return static_cast<int>(index);
+#  else
+  unsigned long index;
+  if (_BitScanForward(&index, static_cast<unsigned long>(word))) {
+    return static_cast<int>(index);
+  }
+  _BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+  return static_cast<int>(index) + 32;
+#  endif
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+// Stream ids are tracked using a bitmap of 64-bit words where a set bit
+// marks an available stream. A second, smaller bitmap marks the words that
+// still have available streams so that acquiring a stream only needs a
+// couple of find-first-set operations, even with the 32768 streams of
+// protocol v3. The lowest available stream is always acquired first, which
+// lets the item table grow lazily, one word (64 streams) at a time, only as
+// far as the connection's peak number of concurrent requests.
+
 template <class T>
 class StreamManager {
 public:
-  static const int MAX_STREAMS = 128;
-
-  StreamManager()
-      : available_stream_index_(0) {
-    for (int i = 0; i < MAX_STREAMS; ++i) {
-      available_streams_[i] = i;
-      allocated_streams_[i] = false;
+  static const int MAX_STREAMS_V1_AND_V2 = 128;
+  static const int MAX_STREAMS_V3 = 32768;
+
+  explicit StreamManager(int protocol_version = 1)
+      : max_streams_(protocol_version >= 3 ? MAX_STREAMS_V3
+                                           : MAX_STREAMS_V1_AND_V2)
+      , pending_streams_(0)
+      , words_(max_streams_ / NUM_BITS_PER_WORD, ~static_cast<uint64_t>(0))
+      , summary_((words_.size() + NUM_BITS_PER_WORD - 1) / NUM_BITS_PER_WORD, 0) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      summary_[i / NUM_BITS_PER_WORD] |= bit(i);
     }
   }
 
-  int8_t acquire_stream(const T& item) {
-    if (available_stream_index_ >= MAX_STREAMS) {
-      return -1;
+  int max_streams() const { return max_streams_; }
+
+  int16_t acquire_stream(const T& item) {
+    for (size_t i = 0; i < summary_.size(); ++i) {
+      if (summary_[i] != 0) {
+        size_t word_index = i * NUM_BITS_PER_WORD + count_trailing_zeros(summary_[i]);
+        uint64_t& word = words_[word_index];
+        int16_t stream = static_cast<int16_t>(word_index * NUM_BITS_PER_WORD +
+                                              count_trailing_zeros(word));
+        word &= word - 1; // Clear the lowest set bit
+        if (word == 0) {
+          summary_[i] &= ~bit(word_index);
+        }
+        if (word_index >= items_.size() / NUM_BITS_PER_WORD) {
+          items_.resize((word_index + 1) * NUM_BITS_PER_WORD);
+        }
+        items_[stream] = item;
+        ++pending_streams_;
+        return stream;
+      }
     }
-    int8_t stream = available_streams_[available_stream_index_++];
-    items_[stream] = item;
-    allocated_streams_[stream] = true;
-    return stream;
+    return -1;
   }
 
-  void release_stream(int8_t stream) {
-    assert(allocated_streams_[stream]);
-    available_streams_[--available_stream_index_] = stream;
-    allocated_streams_[stream] = false;
+  void release_stream(int16_t stream) {
+    assert(is_allocated(stream));
+    size_t word_index = static_cast<size_t>(stream) / NUM_BITS_PER_WORD;
+    words_[word_index] |= bit(stream);
+    summary_[word_index / NUM_BITS_PER_WORD] |= bit(word_index);
+    --pending_streams_;
   }
 
-  bool get_item(int8_t stream, T& output, bool release = true) {
-    if (allocated_streams_[stream]) {
+  bool get_item(int16_t stream, T& output, bool release = true) {
+    if (is_allocated(stream)) {
       output = items_[stream];
       if (release) {
         release_stream(stream);
@@ -63,14 +116,27 @@ public:
     return false;
   }
 
-  size_t available_streams() const { return MAX_STREAMS - available_stream_index_; }
-  size_t pending_streams() const { return available_stream_index_; }
+  size_t available_streams() const { return max_streams_ - pending_streams_; }
+  size_t pending_streams() const { return pending_streams_; }
+
+private:
+  static const size_t NUM_BITS_PER_WORD = 64;
+
+  static uint64_t bit(size_t index) {
+    return static_cast<uint64_t>(1) << (index % NUM_BITS_PER_WORD);
+  }
+
+  bool is_allocated(int16_t stream) const {
+    return stream >= 0 && stream < max_streams_ &&
+        (words_[static_cast<size_t>(stream) / NUM_BITS_PER_WORD] & bit(stream)) == 0;
+  }
 
 private:
-  int available_stream_index_;
-  int8_t available_streams_[MAX_STREAMS];
-  bool allocated_streams_[MAX_STREAMS];
-  T items_[MAX_STREAMS];
+  const int max_streams_;
+  size_t pending_streams_;
+  std::vector<uint64_t> words_;
+  std::vector<uint64_t> summary_;
+  std::vector<T> items_;
 };
 
 } // namespace cass
@@ -36,4 +36,14 @@ bool SupportedResponse::decode(int version, char* buffer, size_t size) {
   return true;
 }
 
+bool SupportedResponse::supports_compression(const std::string& compression) const {
+  for (std::list<std::string>::const_iterator it = compression_.begin(),
+       end = compression_.end(); it != end; ++it) {
+    if (*it == compression) {
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace cass
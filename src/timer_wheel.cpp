@@ -0,0 +1,135 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "timer_wheel.hpp"
+
+#include "common.hpp"
+
+#include <assert.h>
+
+namespace cass {
+
+TimerWheel::TimerWheel(uint64_t tick_ms, size_t num_slots)
+  : tick_ms_(tick_ms)
+  , num_slots_(num_slots)
+  , slots_(new List<Timer>[num_slots])
+  , loop_(NULL)
+  , is_ticking_(false)
+  , current_tick_(0)
+  , manual_now_ms_(0)
+  , timer_count_(0) {
+  handle_.data = this;
+}
+
+int TimerWheel::init(uv_loop_t* loop) {
+  int rc = uv_timer_init(loop, &handle_);
+  if (rc != 0) return rc;
+  loop_ = loop;
+  current_tick_ = now_ms() / tick_ms_;
+  return 0;
+}
+
+void TimerWheel::close_handles() {
+  if (loop_ != NULL) {
+    uv_close(copy_cast<uv_timer_t*, uv_handle_t*>(&handle_), NULL);
+  }
+}
+
+void TimerWheel::advance(uint64_t now_ms) {
+  assert(loop_ == NULL && "Only valid for a wheel without a loop");
+  manual_now_ms_ = now_ms;
+  expire(now_ms);
+}
+
+void TimerWheel::add(Timer* timer, uint64_t timeout_ms) {
+  uint64_t now = now_ms();
+
+  // Catch up first so that a new timer isn't placed behind the current tick
+  if (timer_count_ == 0) {
+    current_tick_ = now / tick_ms_;
+  }
+
+  uint64_t deadline = (now + timeout_ms + tick_ms_ - 1) / tick_ms_;
+  if (deadline <= current_tick_) {
+    deadline = current_tick_ + 1;
+  }
+
+  List<Timer>* slot = &slots_[deadline % num_slots_];
+  slot->add_to_back(timer);
+  timer->wheel_ = this;
+  timer->slot_ = slot;
+  timer->deadline_ = deadline;
+
+  if (timer_count_++ == 0 && loop_ != NULL && !is_ticking_) {
+    uv_timer_start(&handle_, on_tick, tick_ms_, tick_ms_);
+    is_ticking_ = true;
+  }
+}
+
+void TimerWheel::remove(Timer* timer) {
+  timer->slot_->remove(timer);
+  timer->slot_ = NULL;
+  if (--timer_count_ == 0 && is_ticking_) {
+    uv_timer_stop(&handle_);
+    is_ticking_ = false;
+  }
+}
+
+void TimerWheel::expire(uint64_t now_ms) {
+  uint64_t now_tick = now_ms / tick_ms_;
+
+  while (current_tick_ < now_tick && timer_count_ > 0) {
+    ++current_tick_;
+
+    // Due timers are moved to a separate list so that callbacks are free to
+    // start and stop any timer, including the one currently being run.
+    List<Timer> expired;
+    List<Timer>* slot = &slots_[current_tick_ % num_slots_];
+    List<Timer>::Iterator<Timer> it = slot->iterator();
+    while (it.has_next()) {
+      Timer* timer = it.next();
+      if (timer->deadline_ <= current_tick_) {
+        slot->remove(timer);
+        expired.add_to_back(timer);
+        timer->slot_ = &expired;
+      }
+    }
+
+    while (!expired.is_empty()) {
+      Timer* timer = expired.front();
+      remove(timer);
+      timer->cb_(timer);
+    }
+  }
+
+  current_tick_ = now_tick;
+}
+
+uint64_t TimerWheel::now_ms() const {
+  if (loop_ == NULL) return manual_now_ms_;
+  return uv_now(loop_);
+}
+
+#if UV_VERSION_MAJOR == 0
+void TimerWheel::on_tick(uv_timer_t* handle, int status) {
+#else
+void TimerWheel::on_tick(uv_timer_t* handle) {
+#endif
+  TimerWheel* wheel = static_cast<TimerWheel*>(handle->data);
+  wheel->expire(uv_now(wheel->loop_));
+}
+
+} // namespace cass
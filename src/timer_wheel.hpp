@@ -0,0 +1,121 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __CASS_TIMER_WHEEL_HPP_INCLUDED__
+#define __CASS_TIMER_WHEEL_HPP_INCLUDED__
+
+#include "list.hpp"
+#include "macros.hpp"
+#include "scoped_ptr.hpp"
+
+#include <uv.h>
+
+namespace cass {
+
+// A hashed timing wheel for the many short-lived timers used for request
+// timeouts. Starting and stopping a timer is O(1) and a single uv timer,
+// only running while there are pending timers, drives the wheel.
+//
+// Timers never expire early, but can expire up to a tick late.
+class TimerWheel {
+public:
+  static const uint64_t DEFAULT_TICK_MS = 10;
+  static const size_t DEFAULT_NUM_SLOTS = 512;
+
+  class Timer : public List<Timer>::Node {
+  public:
+    typedef void (*Callback)(Timer*);
+
+    Timer()
+      : wheel_(NULL)
+      , slot_(NULL)
+      , deadline_(0)
+      , data_(NULL)
+      , cb_(NULL) {}
+
+    ~Timer() { stop(); }
+
+    void* data() const { return data_; }
+    bool is_running() const { return slot_ != NULL; }
+
+    void start(TimerWheel* wheel, uint64_t timeout_ms, void* data, Callback cb) {
+      stop();
+      data_ = data;
+      cb_ = cb;
+      wheel->add(this, timeout_ms);
+    }
+
+    void stop() {
+      if (slot_ != NULL) {
+        wheel_->remove(this);
+      }
+    }
+
+  private:
+    friend class TimerWheel;
+
+    TimerWheel* wheel_;
+    List<Timer>* slot_;
+    uint64_t deadline_; // In ticks
+    void* data_;
+    Callback cb_;
+
+  private:
+    DISALLOW_COPY_AND_ASSIGN(Timer);
+  };
+
+  TimerWheel(uint64_t tick_ms = DEFAULT_TICK_MS,
+             size_t num_slots = DEFAULT_NUM_SLOTS);
+
+  int init(uv_loop_t* loop);
+  void close_handles();
+
+  size_t timer_count() const { return timer_count_; }
+
+  // Testing only. Without a loop the time only changes using this method and
+  // it expires the timers that are due.
+  void advance(uint64_t now_ms);
+
+private:
+  void add(Timer* timer, uint64_t timeout_ms);
+  void remove(Timer* timer);
+  void expire(uint64_t now_ms);
+  uint64_t now_ms() const;
+
+#if UV_VERSION_MAJOR == 0
+  static void on_tick(uv_timer_t* handle, int status);
+#else
+  static void on_tick(uv_timer_t* handle);
+#endif
+
+private:
+  const uint64_t tick_ms_;
+  const size_t num_slots_;
+  ScopedPtr<List<Timer>[]> slots_;
+  uv_loop_t* loop_;
+  uv_timer_t handle_;
+  bool is_ticking_;
+  uint64_t current_tick_;
+  uint64_t manual_now_ms_;
+  size_t timer_count_;
+
+private:
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace cass
+
+#endif
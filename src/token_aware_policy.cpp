@@ -16,6 +16,9 @@
 
 #include "token_aware_policy.hpp"
 
+#include <algorithm>
+#include <utility>
+
 namespace cass {
 
 // The number of replicas is bounded by replication factor per DC. In practice, the number
@@ -30,9 +33,56 @@ static inline bool contains(const CopyOnWriteHostVec& replicas, const Address& a
   return false;
 }
 
+void TokenAwarePolicy::init(const SharedRefPtr<Host>& connected_host, const HostMap& hosts) {
+  if (is_latency_ordered_) {
+    copy_hosts(hosts, hosts_);
+    for (HostMap::const_iterator i = hosts.begin(),
+         end = hosts.end(); i != end; ++i) {
+      i->second->enable_latency_tracking(latency_settings_.scale_ns,
+                                         latency_settings_.min_measured);
+    }
+  }
+  ChainedLoadBalancingPolicy::init(connected_host, hosts);
+}
+
+void TokenAwarePolicy::register_handles(uv_loop_t* loop) {
+  if (is_latency_ordered_) {
+    merge_latencies_task_ = PeriodicTask::start(loop,
+                                                latency_settings_.update_rate_ms,
+                                                this,
+                                                TokenAwarePolicy::on_work,
+                                                TokenAwarePolicy::on_after_work);
+  }
+  ChainedLoadBalancingPolicy::register_handles(loop);
+}
+
+void TokenAwarePolicy::close_handles() {
+  if (merge_latencies_task_ != NULL) {
+    PeriodicTask::stop(merge_latencies_task_);
+  }
+  ChainedLoadBalancingPolicy::close_handles();
+}
+
+void TokenAwarePolicy::on_add(const SharedRefPtr<Host>& host) {
+  if (is_latency_ordered_) {
+    host->enable_latency_tracking(latency_settings_.scale_ns,
+                                  latency_settings_.min_measured);
+    add_host(hosts_, host);
+  }
+  ChainedLoadBalancingPolicy::on_add(host);
+}
+
+void TokenAwarePolicy::on_remove(const SharedRefPtr<Host>& host) {
+  if (is_latency_ordered_) {
+    remove_host(hosts_, host);
+  }
+  ChainedLoadBalancingPolicy::on_remove(host);
+}
+
 QueryPlan* TokenAwarePolicy::new_query_plan(const std::string& connected_keyspace,
                                             const Request* request,
-                                            const TokenMap& token_map) {
+                                            const TokenMap& token_map,
+                                            QueryPlanAllocator* allocator) {
   if (request != NULL) {
     switch (request->opcode()) {
       {
@@ -43,14 +93,24 @@ QueryPlan* TokenAwarePolicy::new_query_plan(const std::string& connected_keyspac
         const std::string& statement_keyspace = rr->keyspace();
         const std::string& keyspace = statement_keyspace.empty()
                                       ? connected_keyspace : statement_keyspace;
-        std::string routing_key;
-        if (rr->get_routing_key(&routing_key) && !keyspace.empty()) {
-          CopyOnWriteHostVec replicas = token_map.get_replicas(keyspace, routing_key);
+        if (!keyspace.empty()) {
+          CopyOnWriteHostVec replicas = token_map.get_replicas(keyspace, rr);
           if (!replicas->empty()) {
-            return new TokenAwareQueryPlan(child_policy_.get(),
-                                           child_policy_->new_query_plan(connected_keyspace, request, token_map),
-                                           replicas,
-                                           index_++);
+            QueryPlan* child_plan = child_policy_->new_query_plan(connected_keyspace,
+                                                                  request,
+                                                                  token_map,
+                                                                  allocator);
+            if (is_latency_ordered_) {
+              return new (allocator) LatencyOrderedQueryPlan(child_policy_.get(),
+                                                             child_plan,
+                                                             replicas,
+                                                             index_.fetch_add(1, MEMORY_ORDER_RELAXED),
+                                                             latency_settings_.min_measured);
+            }
+            return new (allocator) TokenAwareQueryPlan(child_policy_.get(),
+                                                       child_plan,
+                                                       replicas,
+                                                       index_.fetch_add(1, MEMORY_ORDER_RELAXED));
           }
         }
         break;
@@ -60,18 +120,31 @@ QueryPlan* TokenAwarePolicy::new_query_plan(const std::string& connected_keyspac
         break;
     }
   }
-  return child_policy_->new_query_plan(connected_keyspace, request, token_map);
+  return child_policy_->new_query_plan(connected_keyspace, request, token_map, allocator);
 }
 
 SharedRefPtr<Host> TokenAwarePolicy::TokenAwareQueryPlan::compute_next()  {
+  while (local_rack_remaining_ > 0) {
+    --local_rack_remaining_;
+    const SharedRefPtr<Host>& host((*replicas_)[local_rack_index_++ % replicas_->size()]);
+    if (is_local_rack_replica(host)) {
+      return host;
+    }
+  }
+
+  // Replicas in the local rack have already been returned (or are down)
   while (remaining_ > 0) {
     --remaining_;
     const SharedRefPtr<Host>& host((*replicas_)[index_++ % replicas_->size()]);
-    if (host->is_up() && child_policy_->distance(host) == CASS_HOST_DISTANCE_LOCAL) {
+    if (!child_policy_->is_local_rack(host) && is_local_replica(host)) {
       return host;
     }
   }
 
+  return compute_next_non_replica();
+}
+
+SharedRefPtr<Host> TokenAwarePolicy::TokenAwareQueryPlan::compute_next_non_replica() {
   SharedRefPtr<Host> host;
   while ((host = child_plan_->compute_next())) {
     if (!contains(replicas_, host->address()) ||
@@ -82,4 +155,79 @@ SharedRefPtr<Host> TokenAwarePolicy::TokenAwareQueryPlan::compute_next()  {
   return SharedRefPtr<Host>();
 }
 
+SharedRefPtr<Host> TokenAwarePolicy::LatencyOrderedQueryPlan::compute_next() {
+  if (!is_ordered_) {
+    order_replicas();
+    is_ordered_ = true;
+  }
+
+  if (ordered_index_ < ordered_.size()) {
+    return ordered_[ordered_index_++];
+  }
+
+  return compute_next_non_replica();
+}
+
+// Replicas outside of the local rack sort after the local rack replicas
+typedef std::pair<std::pair<bool, double>, size_t> ScoreIndex;
+
+void TokenAwarePolicy::LatencyOrderedQueryPlan::order_replicas() {
+  // The rotated order is kept for ties so that load is still spread across
+  // replicas without measurements
+  while (remaining_ > 0) {
+    --remaining_;
+    const SharedRefPtr<Host>& host((*replicas_)[index_++ % replicas_->size()]);
+    if (is_local_replica(host)) {
+      ordered_.push_back(host);
+    }
+  }
+
+  if (ordered_.size() < 2) return;
+
+  FixedVector<int64_t, FIXED_REPLICAS_SIZE> averages;
+  int64_t min_average = -1;
+  for (FixedVector<SharedRefPtr<Host>, FIXED_REPLICAS_SIZE>::const_iterator i = ordered_.begin(),
+       end = ordered_.end(); i != end; ++i) {
+    TimestampedAverage latency = (*i)->get_current_average();
+    int64_t average = latency.num_measured < min_measured_ ? -1 : latency.average;
+    if (average >= 0 && (min_average < 0 || average < min_average)) {
+      min_average = average;
+    }
+    averages.push_back(average);
+  }
+
+  // Replicas without enough measurements are assumed to be as fast as the
+  // fastest replica, so they're ranked by their requests in flight
+  FixedVector<ScoreIndex, FIXED_REPLICAS_SIZE> scores;
+  for (size_t i = 0; i < ordered_.size(); ++i) {
+    int64_t average = averages[i] >= 0 ? averages[i] : std::max(min_average, static_cast<int64_t>(1));
+    int inflight = std::max(ordered_[i]->inflight_request_count(), 0);
+    scores.push_back(ScoreIndex(std::make_pair(!child_policy_->is_local_rack(ordered_[i]),
+                                               static_cast<double>(average) * (inflight + 1)), i));
+  }
+  std::sort(scores.begin(), scores.end());
+
+  // The fixed buffers can't be swapped so the hosts are copied back
+  FixedVector<SharedRefPtr<Host>, FIXED_REPLICAS_SIZE> ordered;
+  for (FixedVector<ScoreIndex, FIXED_REPLICAS_SIZE>::const_iterator i = scores.begin(),
+       end = scores.end(); i != end; ++i) {
+    ordered.push_back(ordered_[i->second]);
+  }
+  ordered_.assign(ordered.begin(), ordered.end());
+}
+
+void TokenAwarePolicy::on_work(PeriodicTask* task) {
+  TokenAwarePolicy* policy = static_cast<TokenAwarePolicy*>(task->data());
+
+  const CopyOnWriteHostVec& hosts = policy->hosts_;
+  for (HostVec::const_iterator i = hosts->begin(),
+       end = hosts->end(); i != end; ++i) {
+    (*i)->merge_latencies();
+  }
+}
+
+void TokenAwarePolicy::on_after_work(PeriodicTask* task) {
+  // no-op
+}
+
 } // namespace cass
@@ -17,9 +17,13 @@
 #ifndef __CASS_TOKEN_AWARE_POLICY_HPP_INCLUDED__
 #define __CASS_TOKEN_AWARE_POLICY_HPP_INCLUDED__
 
+#include "atomic.hpp"
+#include "fixed_vector.hpp"
 #include "token_map.hpp"
+#include "latency_aware_policy.hpp"
 #include "load_balancing.hpp"
 #include "host.hpp"
+#include "periodic_task.hpp"
 #include "scoped_ptr.hpp"
 
 namespace cass {
@@ -28,17 +32,49 @@ class TokenAwarePolicy : public ChainedLoadBalancingPolicy {
 public:
   TokenAwarePolicy(LoadBalancingPolicy* child_policy)
       : ChainedLoadBalancingPolicy(child_policy)
-      , index_(0) {}
+      , index_(0)
+      , is_latency_ordered_(false)
+      , merge_latencies_task_(NULL)
+      , hosts_(new HostVec) {}
+
+  // Orders the local replicas by their average latency, weighted by their
+  // requests in flight, instead of rotating through them. The settings'
+  // scale and minimum measured are used to track the latencies.
+  TokenAwarePolicy(LoadBalancingPolicy* child_policy,
+                   const LatencyAwarePolicy::Settings& latency_settings)
+      : ChainedLoadBalancingPolicy(child_policy)
+      , index_(0)
+      , is_latency_ordered_(true)
+      , latency_settings_(latency_settings)
+      , merge_latencies_task_(NULL)
+      , hosts_(new HostVec) {}
 
   virtual ~TokenAwarePolicy() {}
 
+  virtual void init(const SharedRefPtr<Host>& connected_host, const HostMap& hosts);
+
+  virtual void register_handles(uv_loop_t* loop);
+  virtual void close_handles();
+
   virtual QueryPlan* new_query_plan(const std::string& connected_keyspace,
                                     const Request* request,
-                                    const TokenMap& token_map);
+                                    const TokenMap& token_map,
+                                    QueryPlanAllocator* allocator = NULL);
 
-  LoadBalancingPolicy* new_instance() { return new TokenAwarePolicy(child_policy_->new_instance()); }
+  LoadBalancingPolicy* new_instance() {
+    if (is_latency_ordered_) {
+      return new TokenAwarePolicy(child_policy_->new_instance(), latency_settings_);
+    }
+    return new TokenAwarePolicy(child_policy_->new_instance());
+  }
+
+  virtual void on_add(const SharedRefPtr<Host>& host);
+  virtual void on_remove(const SharedRefPtr<Host>& host);
 
 private:
+  // The number of local replicas that are ordered without using the heap
+  static const size_t FIXED_REPLICAS_SIZE = 8;
+
   class TokenAwareQueryPlan : public QueryPlan {
   public:
     TokenAwareQueryPlan(LoadBalancingPolicy* child_policy, QueryPlan* child_plan, const CopyOnWriteHostVec& replicas, size_t start_index)
@@ -46,19 +82,61 @@ private:
       , child_plan_(child_plan)
       , replicas_(replicas)
       , index_(start_index)
+      , local_rack_index_(start_index)
+      , local_rack_remaining_(replicas->size())
       , remaining_(replicas->size()) {}
 
     SharedRefPtr<Host> compute_next();
 
-  private:
+  protected:
+    bool is_local_replica(const SharedRefPtr<Host>& host) const {
+      return host->is_up() && child_policy_->distance(host) == CASS_HOST_DISTANCE_LOCAL;
+    }
+
+    bool is_local_rack_replica(const SharedRefPtr<Host>& host) const {
+      return child_policy_->is_local_rack(host) && host->is_up();
+    }
+
+    SharedRefPtr<Host> compute_next_non_replica();
+
     LoadBalancingPolicy* child_policy_;
     ScopedPtr<QueryPlan> child_plan_;
     CopyOnWriteHostVec replicas_;
     size_t index_;
+    size_t local_rack_index_;
+    size_t local_rack_remaining_;
     size_t remaining_;
   };
 
-  size_t index_;
+  class LatencyOrderedQueryPlan : public TokenAwareQueryPlan {
+  public:
+    LatencyOrderedQueryPlan(LoadBalancingPolicy* child_policy, QueryPlan* child_plan,
+                            const CopyOnWriteHostVec& replicas, size_t start_index,
+                            uint64_t min_measured)
+      : TokenAwareQueryPlan(child_policy, child_plan, replicas, start_index)
+      , min_measured_(min_measured)
+      , is_ordered_(false)
+      , ordered_index_(0) {}
+
+    SharedRefPtr<Host> compute_next();
+
+  private:
+    void order_replicas();
+
+    uint64_t min_measured_;
+    bool is_ordered_;
+    FixedVector<SharedRefPtr<Host>, FIXED_REPLICAS_SIZE> ordered_;
+    size_t ordered_index_;
+  };
+
+  static void on_work(PeriodicTask* task);
+  static void on_after_work(PeriodicTask* task);
+
+  Atomic<size_t> index_;
+  bool is_latency_ordered_;
+  LatencyAwarePolicy::Settings latency_settings_;
+  PeriodicTask* merge_latencies_task_;
+  CopyOnWriteHostVec hosts_;
 
 private:
   DISALLOW_COPY_AND_ASSIGN(TokenAwarePolicy);
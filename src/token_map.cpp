@@ -19,8 +19,8 @@
 #include "logger.hpp"
 #include "md5.hpp"
 #include "murmur3.hpp"
-#include "scoped_ptr.hpp"
 
+#include <assert.h>
 #include <uv.h>
 
 #include <algorithm>
@@ -93,12 +93,57 @@ static void parse_int128(const char* p, size_t n, uint8_t* output) {
   encode_uint64(output + sizeof(uint64_t), lo);
 }
 
+void Murmur3TokenRing::build(const TokenReplicaMap& replica_map) {
+  tokens_.clear();
+  replicas_.clear();
+  tokens_.reserve(replica_map.size());
+  replicas_.reserve(replica_map.size());
+
+  for (TokenReplicaMap::const_iterator i = replica_map.begin();
+       i != replica_map.end(); ++i) {
+    tokens_.push_back(Murmur3Partitioner::to_int64(i->first));
+    replicas_.push_back(i->second);
+  }
+
+  // The byte encoding orders the minimum token last, the signed values order
+  // it first. Either way it's only reachable by wrapping around the ring so
+  // the replicas returned are the same.
+  if (!tokens_.empty() && tokens_.back() == std::numeric_limits<int64_t>::min()) {
+    std::rotate(tokens_.begin(), tokens_.end() - 1, tokens_.end());
+    std::rotate(replicas_.begin(), replicas_.end() - 1, replicas_.end());
+  }
+}
+
+const CopyOnWriteHostVec& Murmur3TokenRing::find(int64_t token) const {
+  if (tokens_.empty()) return NO_REPLICAS;
+
+  // Upper bound: the first token greater than "token". The conditional
+  // select compiles to a conditional move so there are no mispredicted
+  // branches inside the loop.
+  const int64_t* base = &tokens_[0];
+  size_t n = tokens_.size();
+  while (n > 1) {
+    size_t half = n / 2;
+    base = (base[half - 1] <= token) ? base + half : base;
+    n -= half;
+  }
+  size_t index = static_cast<size_t>(base - &tokens_[0]) + (*base <= token ? 1 : 0);
+
+  // Wrap around to the start of the ring
+  if (index == tokens_.size()) index = 0;
+  return replicas_[index];
+}
+
 void TokenMap::clear() {
-  mapped_addresses_.clear();
+  mapped_hosts_.clear();
+  racks_.clear();
   token_map_.clear();
   keyspace_replica_map_.clear();
+  strategy_replicas_.clear();
   keyspace_strategy_map_.clear();
   partitioner_.reset();
+  is_murmur3_ = false;
+  is_built_ = false;
 }
 
 void TokenMap::build() {
@@ -107,7 +152,39 @@ void TokenMap::build() {
     return;
   }
 
-  map_replicas(true);
+  is_built_ = true;
+  map_replicas();
+}
+
+TokenMap* TokenMap::copy_replicas() const {
+  TokenMap* copy = new TokenMap();
+  copy->partitioner_ = partitioner_;
+  copy->is_murmur3_ = is_murmur3_;
+  copy->is_built_ = is_built_;
+
+  // Keep the replicas shared between keyspaces in the copy
+  typedef std::map<const StrategyReplicas*, SharedRefPtr<StrategyReplicas> > CopyMap;
+  CopyMap copies;
+  for (StrategyReplicasVec::const_iterator i = strategy_replicas_.begin();
+       i != strategy_replicas_.end(); ++i) {
+    SharedRefPtr<StrategyReplicas> strategy_replicas(new StrategyReplicas((*i)->strategy));
+    strategy_replicas->max_walk = (*i)->max_walk;
+    // Only the ring is used for lookups with the Murmur3 partitioner
+    if (is_murmur3_) {
+      strategy_replicas->ring = (*i)->ring;
+    } else {
+      strategy_replicas->replicas = (*i)->replicas;
+    }
+    copies[i->get()] = strategy_replicas;
+    copy->strategy_replicas_.push_back(strategy_replicas);
+  }
+
+  for (KeyspaceReplicaMap::const_iterator i = keyspace_replica_map_.begin();
+       i != keyspace_replica_map_.end(); ++i) {
+    copy->keyspace_replica_map_[i->first] = copies[i->second.get()];
+  }
+
+  return copy;
 }
 
 void TokenMap::set_partitioner(const std::string& partitioner_class) {
@@ -116,6 +193,7 @@ void TokenMap::set_partitioner(const std::string& partitioner_class) {
 
   if (ends_with(partitioner_class, Murmur3Partitioner::PARTITIONER_CLASS)) {
     partitioner_.reset(new Murmur3Partitioner());
+    is_murmur3_ = true;
   } else if (ends_with(partitioner_class, RandomPartitioner::PARTITIONER_CLASS)) {
     partitioner_.reset(new RandomPartitioner());
   } else if (ends_with(partitioner_class, ByteOrderedPartitioner::PARTITIONER_CLASS)) {
@@ -125,7 +203,9 @@ void TokenMap::set_partitioner(const std::string& partitioner_class) {
   }
 }
 
-void TokenMap::update_host(SharedRefPtr<Host>& host, const TokenStringList& token_strings) {
+void TokenMap::update_host(SharedRefPtr<Host>& host,
+                           const std::string& rack, const std::string& dc,
+                           const TokenStringList& token_strings) {
   if (!partitioner_) return;
 
   // There's a chance to avoid purging if tokens are the same as existing; deemed
@@ -133,21 +213,26 @@ void TokenMap::update_host(SharedRefPtr<Host>& host, const TokenStringList& toke
   // 1.) Updates should only happen on "new" host, or "moved"
   // 2.) Moving should only occur on non-vnode clusters, in which case the
   //     token map is relatively small and easy to purge/repopulate
-  purge_address(host->address());
+  TokenVec removed;
+  purge_address(host->address(), &removed);
 
+  MappedHost& mapped_host = mapped_hosts_[host->address()];
+  mapped_host.host = SharedRefPtr<TokenHost>(new TokenHost(host, rack, dc));
   for (TokenStringList::const_iterator i = token_strings.begin();
        i != token_strings.end(); ++i) {
-    token_map_[partitioner_->token_from_string_ref(*i)] = host;
+    Token token(partitioner_->token_from_string_ref(*i));
+    token_map_[token] = mapped_host.host;
+    mapped_host.tokens.push_back(token);
   }
-  mapped_addresses_.insert(host->address());
-  map_replicas();
+  update_replicas(removed, mapped_host.tokens);
 }
 
 void TokenMap::remove_host(SharedRefPtr<Host>& host) {
   if (!partitioner_) return;
 
-  if (purge_address(host->address())) {
-    map_replicas();
+  TokenVec removed;
+  if (purge_address(host->address(), &removed)) {
+    update_replicas(removed, TokenVec());
   }
 }
 
@@ -166,20 +251,38 @@ void TokenMap::update_keyspace(const std::string& ks_name, const KeyspaceMetadat
   }
 }
 
+void TokenMap::update_keyspace(const std::string& ks_name,
+                               const SharedRefPtr<ReplicationStrategy>& strategy) {
+  if (!partitioner_) return;
+
+  KeyspaceStrategyMap::iterator i = keyspace_strategy_map_.find(ks_name);
+  if (i == keyspace_strategy_map_.end() || !i->second->equal(*strategy)) {
+    map_keyspace_replicas(ks_name, strategy);
+    keyspace_strategy_map_[ks_name] = strategy;
+  }
+}
+
 void TokenMap::drop_keyspace(const std::string& ks_name) {
   if (!partitioner_) return;
 
   keyspace_replica_map_.erase(ks_name);
   keyspace_strategy_map_.erase(ks_name);
+  purge_strategy_replicas();
 }
 
 const CopyOnWriteHostVec& TokenMap::get_replicas(const std::string& ks_name,
                                                  const std::string& routing_key) const {
   if (!partitioner_) return NO_REPLICAS;
 
+  if (is_murmur3_) {
+    return get_murmur3_replicas(ks_name,
+                                Murmur3Partitioner::hash_int64(reinterpret_cast<const uint8_t*>(routing_key.data()),
+                                                               routing_key.size()));
+  }
+
   KeyspaceReplicaMap::const_iterator tokens_it = keyspace_replica_map_.find(ks_name);
   if (tokens_it != keyspace_replica_map_.end()) {
-    const TokenReplicaMap& tokens_to_replicas = tokens_it->second;
+    const TokenReplicaMap& tokens_to_replicas = tokens_it->second->replicas;
 
     const Token t = partitioner_->hash(reinterpret_cast<const uint8_t*>(routing_key.data()), routing_key.size());
     TokenReplicaMap::const_iterator replicas_it = tokens_to_replicas.upper_bound(t);
@@ -195,48 +298,168 @@ const CopyOnWriteHostVec& TokenMap::get_replicas(const std::string& ks_name,
   return NO_REPLICAS;
 }
 
+const CopyOnWriteHostVec& TokenMap::get_replicas(const std::string& ks_name,
+                                                 const RoutableRequest* request) const {
+  if (!partitioner_) return NO_REPLICAS;
+
+  // Use the request's cached token instead of hashing the routing key again
+  if (is_murmur3_) {
+    int64_t token;
+    if (!request->get_murmur3_token(&token)) return NO_REPLICAS;
+    return get_murmur3_replicas(ks_name, token);
+  }
+
+  std::string routing_key;
+  if (!request->get_routing_key(&routing_key)) return NO_REPLICAS;
+  return get_replicas(ks_name, routing_key);
+}
+
+const CopyOnWriteHostVec& TokenMap::get_murmur3_replicas(const std::string& ks_name,
+                                                         int64_t token) const {
+  KeyspaceReplicaMap::const_iterator replicas_it = keyspace_replica_map_.find(ks_name);
+  if (replicas_it == keyspace_replica_map_.end()) return NO_REPLICAS;
+  return replicas_it->second->ring.find(token);
+}
+
 void TokenMap::set_replication_strategy(const std::string& ks_name,
                                         const SharedRefPtr<ReplicationStrategy>& strategy) {
   keyspace_strategy_map_[ks_name] = strategy;
   map_keyspace_replicas(ks_name, strategy);
 }
 
-void TokenMap::map_replicas(bool force) {
-  if (keyspace_replica_map_.empty() && !force) {// do nothing ahead of first build
+void TokenMap::map_replicas() {
+  if (!is_built_) {// do nothing ahead of first build
     return;
   }
+  racks_.clear();
+  racks_in_dcs(&racks_);
+  keyspace_replica_map_.clear();
+  strategy_replicas_.clear();
   for (KeyspaceStrategyMap::const_iterator i = keyspace_strategy_map_.begin();
        i != keyspace_strategy_map_.end(); ++i) {
-    map_keyspace_replicas(i->first, i->second, force);
+    map_keyspace_replicas(i->first, i->second);
   }
 }
 
 void TokenMap::map_keyspace_replicas(const std::string& ks_name,
-                                     const SharedRefPtr<ReplicationStrategy>& strategy,
-                                     bool force) {
-  if (keyspace_replica_map_.empty() && !force) {// do nothing ahead of first build
+                                     const SharedRefPtr<ReplicationStrategy>& strategy) {
+  if (!is_built_) {// do nothing ahead of first build
     return;
   }
-  strategy->tokens_to_replicas(token_map_, &keyspace_replica_map_[ks_name]);
+  keyspace_replica_map_[ks_name] = replicas_for_strategy(strategy);
+  purge_strategy_replicas();
 }
 
-bool TokenMap::purge_address(const Address& addr) {
-  AddressSet::iterator addr_itr = mapped_addresses_.find(addr);
-  if (addr_itr == mapped_addresses_.end()) {
-    return false;
+SharedRefPtr<TokenMap::StrategyReplicas> TokenMap::replicas_for_strategy(const SharedRefPtr<ReplicationStrategy>& strategy) {
+  for (StrategyReplicasVec::const_iterator i = strategy_replicas_.begin();
+       i != strategy_replicas_.end(); ++i) {
+    if ((*i)->strategy->equal(*strategy)) {
+      return *i;
+    }
   }
 
-  TokenHostMap::iterator i = token_map_.begin();
-  while (i != token_map_.end()) {
-    if (addr.compare(i->second->address()) == 0) {
-      TokenHostMap::iterator to_erase = i++;
-      token_map_.erase(to_erase);
+  SharedRefPtr<StrategyReplicas> strategy_replicas(new StrategyReplicas(strategy));
+  strategy_replicas->max_walk = strategy->tokens_to_replicas(token_map_, racks_,
+                                                             &strategy_replicas->replicas);
+  if (is_murmur3_) {
+    strategy_replicas->ring.build(strategy_replicas->replicas);
+  }
+  strategy_replicas_.push_back(strategy_replicas);
+  return strategy_replicas;
+}
+
+// Removes the replicas that are no longer used by any keyspace
+void TokenMap::purge_strategy_replicas() {
+  StrategyReplicasVec::iterator i = strategy_replicas_.begin();
+  while (i != strategy_replicas_.end()) {
+    if ((*i)->ref_count() == 1) {
+      i = strategy_replicas_.erase(i);
     } else {
       ++i;
     }
   }
+}
+
+void TokenMap::update_replicas(const TokenVec& removed, const TokenVec& updated) {
+  if (!is_built_) {// do nothing ahead of first build
+    return;
+  }
+
+  // Rack placement can change the replicas of any token in the DC
+  DCRackMap racks;
+  racks_in_dcs(&racks);
+  if (racks != racks_) {
+    map_replicas();
+    return;
+  }
+
+  // A removed token changes the walks that used to pass over it, which are
+  // the same walks that now reach the token following it.
+  TokenVec dirty(updated);
+  for (TokenVec::const_iterator i = removed.begin(); i != removed.end(); ++i) {
+    if (token_map_.count(*i) > 0) continue;
+    TokenHostMap::const_iterator next = token_map_.upper_bound(*i);
+    if (next == token_map_.end()) next = token_map_.begin();
+    if (next != token_map_.end()) dirty.push_back(next->first);
+  }
+  std::sort(dirty.begin(), dirty.end());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+  for (StrategyReplicasVec::const_iterator i = strategy_replicas_.begin();
+       i != strategy_replicas_.end(); ++i) {
+    StrategyReplicas* strategy_replicas = i->get();
+
+    for (TokenVec::const_iterator j = removed.begin(); j != removed.end(); ++j) {
+      strategy_replicas->replicas.erase(*j);
+    }
+
+    // The windows recomputed around the dirty tokens never overlap so this only
+    // falls back to a full rebuild when most of the ring changed.
+    if (strategy_replicas->max_walk == 0 || 2 * dirty.size() >= token_map_.size()) {
+      strategy_replicas->max_walk
+          = strategy_replicas->strategy->tokens_to_replicas(token_map_, racks_,
+                                                            &strategy_replicas->replicas);
+    } else {
+      strategy_replicas->max_walk
+          = strategy_replicas->strategy->update_replicas(token_map_, racks_,
+                                                         dirty, strategy_replicas->max_walk,
+                                                         &strategy_replicas->replicas);
+    }
+
+    if (is_murmur3_) {
+      strategy_replicas->ring.build(strategy_replicas->replicas);
+    }
+  }
+}
+
+void TokenMap::racks_in_dcs(DCRackMap* output) const {
+  for (MappedHostMap::const_iterator i = mapped_hosts_.begin();
+       i != mapped_hosts_.end(); ++i) {
+    const SharedRefPtr<TokenHost>& host = i->second.host;
+    if (!host->dc().empty() && !host->rack().empty() && !i->second.tokens.empty()) {
+      (*output)[host->dc()].insert(host->rack());
+    }
+  }
+}
 
-  mapped_addresses_.erase(addr_itr);
+bool TokenMap::purge_address(const Address& addr, TokenVec* removed) {
+  MappedHostMap::iterator host_itr = mapped_hosts_.find(addr);
+  if (host_itr == mapped_hosts_.end()) {
+    return false;
+  }
+
+  const TokenVec& tokens = host_itr->second.tokens;
+  for (TokenVec::const_iterator i = tokens.begin(); i != tokens.end(); ++i) {
+    TokenHostMap::iterator token_itr = token_map_.find(*i);
+    // The token may have been taken over by another host
+    if (token_itr != token_map_.end() &&
+        addr.compare(token_itr->second->address()) == 0) {
+      token_map_.erase(token_itr);
+      removed->push_back(*i);
+    }
+  }
+
+  mapped_hosts_.erase(host_itr);
   return true;
 }
 
@@ -252,12 +475,26 @@ Token Murmur3Partitioner::token_from_string_ref(const StringRef& token_string_re
 
 Token Murmur3Partitioner::hash(const uint8_t* data, size_t size) const {
   Token token(sizeof(int64_t), 0);
+  int64_t token_value = hash_int64(data, size);
+  encode_uint64(&token[0], static_cast<uint64_t>(token_value) + std::numeric_limits<uint64_t>::max() / 2);
+  return token;
+}
+
+int64_t Murmur3Partitioner::hash_int64(const uint8_t* data, size_t size) {
   int64_t token_value = MurmurHash3_x64_128(data, size, 0);
   if (token_value == std::numeric_limits<int64_t>::min()) {
     token_value = std::numeric_limits<int64_t>::max();
   }
-  encode_uint64(&token[0], static_cast<uint64_t>(token_value) + std::numeric_limits<uint64_t>::max() / 2);
-  return token;
+  return token_value;
+}
+
+int64_t Murmur3Partitioner::to_int64(const Token& token) {
+  assert(token.size() == sizeof(int64_t));
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(int64_t); ++i) {
+    value = (value << 8) | token[i];
+  }
+  return static_cast<int64_t>(value - std::numeric_limits<uint64_t>::max() / 2);
 }
 
 const std::string RandomPartitioner::PARTITIONER_CLASS("RandomPartitioner");
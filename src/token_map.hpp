@@ -20,8 +20,9 @@
 #include "buffer.hpp"
 #include "copy_on_write_ptr.hpp"
 #include "host.hpp"
+#include "ref_counted.hpp"
 #include "replication_strategy.hpp"
-#include "scoped_ptr.hpp"
+#include "request.hpp"
 #include "schema_metadata.hpp"
 #include "string_ref.hpp"
 
@@ -32,52 +33,122 @@ namespace cass {
 
 typedef std::vector<StringRef> TokenStringList;
 
-class Partitioner {
+class Partitioner : public RefCounted<Partitioner> {
 public:
   virtual ~Partitioner() {}
   virtual Token token_from_string_ref(const StringRef& token_string_ref) const = 0;
   virtual Token hash(const uint8_t* data, size_t size) const = 0;
 };
 
-class TokenMap {
+// A keyspace's replica map flattened into a sorted array of Murmur3 tokens and
+// a parallel array of replica sets. Lookups don't allocate and use a
+// branch-free binary search over contiguous memory.
+class Murmur3TokenRing {
 public:
+  void build(const TokenReplicaMap& replica_map);
+  const CopyOnWriteHostVec& find(int64_t token) const;
+
+  bool empty() const { return tokens_.empty(); }
+  size_t size() const { return tokens_.size(); }
+
+private:
+  std::vector<int64_t> tokens_;
+  std::vector<CopyOnWriteHostVec> replicas_;
+};
+
+class TokenMap : public RefCounted<TokenMap> {
+public:
+  TokenMap()
+    : is_murmur3_(false)
+    , is_built_(false) {}
   virtual ~TokenMap() {}
 
   void clear();
   void build();
+  bool is_built() const { return is_built_; }
+
+  // Returns a copy that only supports get_replicas(). It doesn't include the
+  // hosts' tokens or the replication strategies so it can't be updated.
+  TokenMap* copy_replicas() const;
 
   void set_partitioner(const std::string& partitioner_class);
-  void update_host(SharedRefPtr<Host>& host, const TokenStringList& token_strings);
+  void update_host(SharedRefPtr<Host>& host, const TokenStringList& token_strings) {
+    update_host(host, host->rack(), host->dc(), token_strings);
+  }
+  // Maps the host's tokens using the given placement instead of the host's
+  // current rack and DC (used when building on another thread)
+  void update_host(SharedRefPtr<Host>& host,
+                   const std::string& rack, const std::string& dc,
+                   const TokenStringList& token_strings);
   void remove_host(SharedRefPtr<Host>& host);
   void update_keyspace(const std::string& ks_name, const KeyspaceMetadata& ks_meta);
+  void update_keyspace(const std::string& ks_name,
+                       const SharedRefPtr<ReplicationStrategy>& strategy);
   void drop_keyspace(const std::string& ks_name);
   const CopyOnWriteHostVec& get_replicas(const std::string& ks_name,
                                          const std::string& routing_key) const;
+  const CopyOnWriteHostVec& get_replicas(const std::string& ks_name,
+                                         const RoutableRequest* request) const;
 
   // Testing only
   void set_replication_strategy(const std::string& ks_name,
                                 const SharedRefPtr<ReplicationStrategy>& strategy);
 
+protected:
+  class StrategyReplicas;
+
 private:
-  void map_replicas(bool force = false);
+  const CopyOnWriteHostVec& get_murmur3_replicas(const std::string& ks_name,
+                                                 int64_t token) const;
+  void map_replicas();
   void map_keyspace_replicas(const std::string& ks_name,
-                             const SharedRefPtr<ReplicationStrategy>& strategy,
-                             bool force = false);
-  bool purge_address(const Address& addr);
+                             const SharedRefPtr<ReplicationStrategy>& strategy);
+  void update_replicas(const TokenVec& removed, const TokenVec& updated);
+  void racks_in_dcs(DCRackMap* output) const;
+
+  SharedRefPtr<StrategyReplicas> replicas_for_strategy(const SharedRefPtr<ReplicationStrategy>& strategy);
+  void purge_strategy_replicas();
+  bool purge_address(const Address& addr, TokenVec* removed);
 
 protected:
   TokenHostMap token_map_;
 
-  typedef std::map<std::string, TokenReplicaMap> KeyspaceReplicaMap;
+  // The replicas for a replication strategy. Keyspaces with equal strategies
+  // share a single instance.
+  class StrategyReplicas : public RefCounted<StrategyReplicas> {
+  public:
+    StrategyReplicas(const SharedRefPtr<ReplicationStrategy>& strategy)
+      : strategy(strategy)
+      , max_walk(0) {}
+
+    SharedRefPtr<ReplicationStrategy> strategy;
+    TokenReplicaMap replicas;
+    size_t max_walk; // The longest replica walk around the ring
+    Murmur3TokenRing ring; // Only built when using the Murmur3 partitioner
+  };
+
+  typedef std::vector<SharedRefPtr<StrategyReplicas> > StrategyReplicasVec;
+  StrategyReplicasVec strategy_replicas_;
+
+  typedef std::map<std::string, SharedRefPtr<StrategyReplicas> > KeyspaceReplicaMap;
   KeyspaceReplicaMap keyspace_replica_map_;
 
   typedef std::map<std::string, SharedRefPtr<ReplicationStrategy> > KeyspaceStrategyMap;
   KeyspaceStrategyMap keyspace_strategy_map_;
 
-  typedef std::set<Address> AddressSet;
-  AddressSet mapped_addresses_;
+  struct MappedHost {
+    SharedRefPtr<TokenHost> host;
+    TokenVec tokens;
+  };
+
+  typedef std::map<Address, MappedHost> MappedHostMap;
+  MappedHostMap mapped_hosts_;
 
-  ScopedPtr<Partitioner> partitioner_;
+  DCRackMap racks_;
+
+  SharedRefPtr<const Partitioner> partitioner_;
+  bool is_murmur3_;
+  bool is_built_;
 };
 
 
@@ -87,6 +158,9 @@ public:
 
   virtual Token token_from_string_ref(const StringRef& token_string_ref) const;
   virtual Token hash(const uint8_t* data, size_t size) const;
+
+  static int64_t hash_int64(const uint8_t* data, size_t size);
+  static int64_t to_int64(const Token& token);
 };
 
 
@@ -0,0 +1,267 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#include "topology_snapshot.hpp"
+
+#include "logger.hpp"
+#include "serialization.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define TOPOLOGY_SNAPSHOT_MAGIC "CASSTOPO"
+#define TOPOLOGY_SNAPSHOT_MAGIC_SIZE (sizeof(TOPOLOGY_SNAPSHOT_MAGIC) - 1)
+
+namespace {
+
+void encode_int(std::string* output, int32_t value) {
+  char buf[sizeof(int32_t)];
+  cass::encode_int32(buf, value);
+  output->append(buf, sizeof(buf));
+}
+
+void encode_string(std::string* output, const std::string& value) {
+  encode_int(output, static_cast<int32_t>(value.size()));
+  output->append(value);
+}
+
+// The snapshot is read from a file so every read is bounds checked
+class Decoder {
+public:
+  Decoder(const char* data, size_t size)
+    : pos_(data)
+    , end_(data + size) {}
+
+  bool decode_byte(uint8_t* output) {
+    if (end_ - pos_ < 1) return false;
+    *output = static_cast<uint8_t>(*pos_++);
+    return true;
+  }
+
+  bool decode_int(int32_t* output) {
+    if (end_ - pos_ < static_cast<ptrdiff_t>(sizeof(int32_t))) return false;
+    pos_ = cass::decode_int32(const_cast<char*>(pos_), *output);
+    return true;
+  }
+
+  bool decode_size(size_t* output) {
+    int32_t value;
+    if (!decode_int(&value) || value < 0) return false;
+    *output = static_cast<size_t>(value);
+    return true;
+  }
+
+  bool decode_string(std::string* output) {
+    size_t size;
+    if (!decode_size(&size) || static_cast<size_t>(end_ - pos_) < size) return false;
+    output->assign(pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool decode_magic() {
+    if (static_cast<size_t>(end_ - pos_) < TOPOLOGY_SNAPSHOT_MAGIC_SIZE ||
+        memcmp(pos_, TOPOLOGY_SNAPSHOT_MAGIC, TOPOLOGY_SNAPSHOT_MAGIC_SIZE) != 0) {
+      return false;
+    }
+    pos_ += TOPOLOGY_SNAPSHOT_MAGIC_SIZE;
+    return true;
+  }
+
+  bool is_done() const { return pos_ == end_; }
+
+private:
+  const char* pos_;
+  const char* end_;
+};
+
+} // namespace
+
+namespace cass {
+
+void TopologySnapshot::encode(std::string* output) const {
+  output->assign(TOPOLOGY_SNAPSHOT_MAGIC, TOPOLOGY_SNAPSHOT_MAGIC_SIZE);
+  encode_int(output, VERSION);
+  encode_string(output, partitioner);
+
+  encode_int(output, static_cast<int32_t>(hosts.size()));
+  for (HostEntryVec::const_iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    encode_string(output, i->address.to_string());
+    encode_int(output, i->address.port());
+    encode_string(output, i->rack);
+    encode_string(output, i->dc);
+    encode_int(output, static_cast<int32_t>(i->tokens.size()));
+    for (std::vector<std::string>::const_iterator j = i->tokens.begin();
+         j != i->tokens.end(); ++j) {
+      encode_string(output, *j);
+    }
+  }
+
+  encode_int(output, static_cast<int32_t>(keyspaces.size()));
+  for (KeyspaceStrategyMap::const_iterator i = keyspaces.begin(); i != keyspaces.end(); ++i) {
+    const ReplicationStrategy* strategy = i->second.get();
+    encode_string(output, i->first);
+    output->push_back(static_cast<char>(strategy->type()));
+    encode_string(output, strategy->strategy_class());
+    if (strategy->type() == ReplicationStrategy::NETWORK_TOPOLOGY) {
+      const NetworkTopologyStrategy::DCReplicaCountMap& rfs
+          = static_cast<const NetworkTopologyStrategy*>(strategy)->replication_factors();
+      encode_int(output, static_cast<int32_t>(rfs.size()));
+      for (NetworkTopologyStrategy::DCReplicaCountMap::const_iterator j = rfs.begin();
+           j != rfs.end(); ++j) {
+        encode_string(output, j->first);
+        encode_int(output, static_cast<int32_t>(j->second));
+      }
+    } else if (strategy->type() == ReplicationStrategy::SIMPLE) {
+      encode_int(output, 1);
+      encode_string(output, "");
+      encode_int(output,
+                 static_cast<int32_t>(static_cast<const SimpleStrategy*>(strategy)->replication_factor()));
+    } else {
+      encode_int(output, 0);
+    }
+  }
+}
+
+bool TopologySnapshot::decode(const char* data, size_t size) {
+  Decoder decoder(data, size);
+
+  int32_t version;
+  if (!decoder.decode_magic() ||
+      !decoder.decode_int(&version) || version != VERSION ||
+      !decoder.decode_string(&partitioner)) {
+    return false;
+  }
+
+  size_t host_count;
+  if (!decoder.decode_size(&host_count)) return false;
+  hosts.clear();
+  for (size_t i = 0; i < host_count; ++i) {
+    HostEntry host;
+    std::string address;
+    int32_t port;
+    size_t token_count;
+    if (!decoder.decode_string(&address) ||
+        !decoder.decode_int(&port) ||
+        !Address::from_string(address, port, &host.address) ||
+        !decoder.decode_string(&host.rack) ||
+        !decoder.decode_string(&host.dc) ||
+        !decoder.decode_size(&token_count)) {
+      return false;
+    }
+    for (size_t j = 0; j < token_count; ++j) {
+      std::string token;
+      if (!decoder.decode_string(&token)) return false;
+      host.tokens.push_back(token);
+    }
+    hosts.push_back(host);
+  }
+
+  size_t keyspace_count;
+  if (!decoder.decode_size(&keyspace_count)) return false;
+  keyspaces.clear();
+  for (size_t i = 0; i < keyspace_count; ++i) {
+    std::string name;
+    uint8_t type;
+    std::string strategy_class;
+    size_t rf_count;
+    if (!decoder.decode_string(&name) ||
+        !decoder.decode_byte(&type) ||
+        !decoder.decode_string(&strategy_class) ||
+        !decoder.decode_size(&rf_count)) {
+      return false;
+    }
+
+    NetworkTopologyStrategy::DCReplicaCountMap rfs;
+    for (size_t j = 0; j < rf_count; ++j) {
+      std::string dc;
+      size_t rf;
+      if (!decoder.decode_string(&dc) || !decoder.decode_size(&rf)) return false;
+      rfs[dc] = rf;
+    }
+
+    SharedRefPtr<ReplicationStrategy> strategy;
+    if (type == ReplicationStrategy::NETWORK_TOPOLOGY) {
+      strategy.reset(new NetworkTopologyStrategy(strategy_class, rfs));
+    } else if (type == ReplicationStrategy::SIMPLE) {
+      if (rfs.size() != 1) return false;
+      strategy.reset(new SimpleStrategy(strategy_class, rfs.begin()->second));
+    } else if (type == ReplicationStrategy::NON_REPLICATED) {
+      strategy.reset(new NonReplicatedStrategy(strategy_class));
+    } else {
+      return false;
+    }
+    keyspaces[name] = strategy;
+  }
+
+  return decoder.is_done();
+}
+
+bool TopologySnapshot::load(const std::string& path) {
+  // The snapshot is decoded into copies so the file is read with a single
+  // read into a temporary buffer
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == NULL) return false;
+
+  std::vector<char> data;
+  long size = -1;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    size = ftell(file);
+  }
+  if (size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+    data.resize(static_cast<size_t>(size));
+    if (fread(&data[0], 1, data.size(), file) != data.size()) {
+      data.clear();
+    }
+  }
+  fclose(file);
+
+  bool is_valid = !data.empty() && decode(&data[0], data.size());
+  if (!is_valid) {
+    LOG_WARN("Ignoring invalid topology snapshot '%s'", path.c_str());
+  }
+  return is_valid;
+}
+
+bool TopologySnapshot::save(const std::string& path, const std::string& data) {
+  std::string temp_path(path + ".tmp");
+
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (file == NULL) {
+    LOG_ERROR("Unable to open '%s' to write the topology snapshot", temp_path.c_str());
+    return false;
+  }
+
+  bool is_written = fwrite(data.data(), 1, data.size(), file) == data.size();
+  is_written = (fclose(file) == 0) && is_written;
+
+#if defined(_WIN32)
+  // Windows doesn't replace an existing file on rename
+  remove(path.c_str());
+#endif
+
+  if (!is_written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOG_ERROR("Unable to write the topology snapshot to '%s'", path.c_str());
+    remove(temp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace cass
@@ -0,0 +1,77 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifndef __CASS_TOPOLOGY_SNAPSHOT_HPP_INCLUDED__
+#define __CASS_TOPOLOGY_SNAPSHOT_HPP_INCLUDED__
+
+#include "address.hpp"
+#include "ref_counted.hpp"
+#include "replication_strategy.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cass {
+
+// A copy of the cluster's hosts, tokens and keyspace replication that's
+// persisted between sessions. It's loaded at startup so routing can begin
+// before the control connection has queried the system tables.
+//
+// The file is a big-endian binary format that's read into memory and
+// decoded in a single pass:
+//
+//   magic "CASSTOPO", version (int)
+//   partitioner (string)
+//   host count (int), hosts: address (string), port (int), rack (string),
+//                            dc (string), token count (int), tokens (string)
+//   keyspace count (int), keyspaces: name (string), type (byte), class (string),
+//                                    rf count (int), rfs: dc (string), rf (int)
+//
+// Strings are encoded as an int length followed by the bytes.
+class TopologySnapshot {
+public:
+  static const int32_t VERSION = 1;
+
+  struct HostEntry {
+    Address address;
+    std::string rack;
+    std::string dc;
+    std::vector<std::string> tokens;
+  };
+
+  typedef std::vector<HostEntry> HostEntryVec;
+  typedef std::map<std::string, SharedRefPtr<ReplicationStrategy> > KeyspaceStrategyMap;
+
+  void encode(std::string* output) const;
+  bool decode(const char* data, size_t size);
+
+  // Returns false if the file doesn't exist or isn't a valid snapshot
+  bool load(const std::string& path);
+
+  // Writes to a temporary file first so a partial write never replaces a
+  // valid snapshot
+  static bool save(const std::string& path, const std::string& data);
+
+  std::string partitioner;
+  HostEntryVec hosts;
+  KeyspaceStrategyMap keyspaces;
+};
+
+} // namespace cass
+
+#endif
@@ -26,33 +26,41 @@ namespace cass {
 class Value {
 public:
   Value()
-      : type_(CASS_VALUE_TYPE_UNKNOWN)
+      : protocol_version_(0)
+      , type_(CASS_VALUE_TYPE_UNKNOWN)
       , primary_type_(CASS_VALUE_TYPE_UNKNOWN)
       , secondary_type_(CASS_VALUE_TYPE_UNKNOWN)
       , count_(0) {}
 
   Value(CassValueType type, char* data, size_t size)
-      : type_(type)
+      : protocol_version_(0)
+      , type_(type)
       , primary_type_(CASS_VALUE_TYPE_UNKNOWN)
       , secondary_type_(CASS_VALUE_TYPE_UNKNOWN)
       , count_(0)
       , buffer_(data, size) {}
 
-  Value(CassValueType type, CassValueType primary_type, CassValueType secondary_type,
+  Value(int protocol_version,
+        CassValueType type, CassValueType primary_type, CassValueType secondary_type,
         int32_t count, char* data, size_t size)
-      : type_(type)
+      : protocol_version_(protocol_version)
+      , type_(type)
       , primary_type_(primary_type)
       , secondary_type_(secondary_type)
       , count_(count)
       , buffer_(data, size) {}
 
-  Value(const ColumnDefinition* def, int32_t count, char* data, size_t size)
-    : type_(static_cast<CassValueType>(def->type))
+  Value(int protocol_version,
+        const ColumnDefinition* def, int32_t count, char* data, size_t size)
+    : protocol_version_(protocol_version)
+    , type_(static_cast<CassValueType>(def->type))
     , primary_type_(static_cast<CassValueType>(def->collection_primary_type))
     , secondary_type_(static_cast<CassValueType>(def->collection_secondary_type))
     , count_(count)
     , buffer_(data, size) {}
 
+  int protocol_version() const { return protocol_version_; }
+
   CassValueType type() const { return type_; }
 
   CassValueType primary_type() const {
@@ -79,6 +87,7 @@ public:
   }
 
 private:
+  int protocol_version_;
   CassValueType type_;
   CassValueType primary_type_;
   CassValueType secondary_type_;
@@ -0,0 +1,236 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Measures recording host latencies from many IO threads at once. The shared
+// tracker is the previous design: a single average per host protected by a
+// pooled spinlock. The per-IO-worker design records into an average owned by
+// each IO worker and a separate thread merges them periodically.
+//
+// Usage: benchmark_latency_tracking [num_threads] [num_hosts] [num_updates]
+
+#include "host.hpp"
+#include "loop_thread.hpp"
+#include "spin_lock.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uv.h>
+#include <vector>
+
+namespace {
+
+const uint64_t SCALE_NS = 100LL * 1000LL * 1000LL;
+const uint64_t MERGE_INTERVAL_MS = 1;
+
+class SharedLatencyTracker {
+public:
+  SharedLatencyTracker() {}
+
+  void update(uint64_t latency_ns) {
+    uint64_t now = uv_hrtime();
+
+    cass::ScopedSpinlock l(cass::SpinlockPool<SharedLatencyTracker>::get_spinlock(this));
+
+    cass::TimestampedAverage previous = current_;
+
+    if (previous.average < 0) {
+      current_.average = latency_ns;
+    } else {
+      int64_t delay = now - previous.timestamp;
+      if (delay <= 0) {
+        return;
+      }
+
+      double scaled_delay = static_cast<double>(delay) / SCALE_NS;
+      double weight = log(scaled_delay + 1) / scaled_delay;
+      current_.average = static_cast<int64_t>((1.0 - weight) * latency_ns + weight * previous.average);
+    }
+
+    current_.num_measured = previous.num_measured + 1;
+    current_.timestamp = now;
+  }
+
+  cass::TimestampedAverage get() const {
+    cass::ScopedSpinlock l(cass::SpinlockPool<SharedLatencyTracker>::get_spinlock(this));
+    return current_;
+  }
+
+private:
+  cass::TimestampedAverage current_;
+};
+
+struct Benchmark {
+  Benchmark(size_t num_threads, size_t num_hosts, size_t num_updates)
+    : num_threads(num_threads)
+    , num_updates(num_updates)
+    , shared_trackers(num_hosts) {
+    for (size_t i = 0; i < num_hosts; ++i) {
+      cass::SharedRefPtr<cass::Host> host(
+            new cass::Host(cass::Address("127.0.0.1", 9042), false, num_threads));
+      host->enable_latency_tracking(SCALE_NS, 0);
+      hosts.push_back(host);
+    }
+  }
+
+  size_t num_threads;
+  size_t num_updates;
+  std::vector<SharedLatencyTracker> shared_trackers;
+  cass::HostVec hosts;
+};
+
+struct Worker {
+  Benchmark* benchmark;
+  size_t index;
+};
+
+// Every update is followed by a read, like a request completing and the next
+// query plan ranking the host
+void run_shared(void* arg) {
+  Worker* worker = static_cast<Worker*>(arg);
+  Benchmark* benchmark = worker->benchmark;
+  std::vector<SharedLatencyTracker>& trackers = benchmark->shared_trackers;
+  int64_t sum = 0;
+  for (size_t i = 0; i < benchmark->num_updates; ++i) {
+    SharedLatencyTracker& tracker = trackers[(worker->index + i) % trackers.size()];
+    tracker.update(1000 + (i % 100));
+    sum += tracker.get().average;
+  }
+  if (sum == 0) fprintf(stderr, "Unexpected sum\n");
+}
+
+void run_per_io_worker(void* arg) {
+  Worker* worker = static_cast<Worker*>(arg);
+  Benchmark* benchmark = worker->benchmark;
+  cass::HostVec& hosts = benchmark->hosts;
+  int64_t sum = 0;
+  for (size_t i = 0; i < benchmark->num_updates; ++i) {
+    const cass::SharedRefPtr<cass::Host>& host = hosts[(worker->index + i) % hosts.size()];
+    host->update_latency(1000 + (i % 100), worker->index);
+    sum += host->get_current_average().average;
+  }
+  if (sum == 0) fprintf(stderr, "Unexpected sum\n");
+}
+
+// Merges the hosts' latencies periodically, like the load balancing policies
+class MergeThread : public cass::LoopThread {
+public:
+  MergeThread(Benchmark* benchmark)
+    : benchmark_(benchmark) {
+    timer_.data = this;
+    async_.data = this;
+  }
+
+  int init() {
+    int rc = cass::LoopThread::init();
+    if (rc != 0) return rc;
+    rc = uv_timer_init(loop(), &timer_);
+    if (rc != 0) return rc;
+    rc = uv_timer_start(&timer_, on_timeout, MERGE_INTERVAL_MS, MERGE_INTERVAL_MS);
+    if (rc != 0) return rc;
+    return uv_async_init(loop(), &async_, on_async);
+  }
+
+  void done() {
+    uv_async_send(&async_);
+  }
+
+private:
+#if UV_VERSION_MAJOR == 0
+  static void on_timeout(uv_timer_t* handle, int status) {
+#else
+  static void on_timeout(uv_timer_t* handle) {
+#endif
+    MergeThread* thread = static_cast<MergeThread*>(handle->data);
+    cass::HostVec& hosts = thread->benchmark_->hosts;
+    for (cass::HostVec::iterator i = hosts.begin(),
+         end = hosts.end(); i != end; ++i) {
+      (*i)->merge_latencies();
+    }
+  }
+
+#if UV_VERSION_MAJOR == 0
+  static void on_async(uv_async_t* handle, int status) {
+#else
+  static void on_async(uv_async_t* handle) {
+#endif
+    MergeThread* thread = static_cast<MergeThread*>(handle->data);
+    thread->close_handles();
+    uv_timer_stop(&thread->timer_);
+    uv_close(reinterpret_cast<uv_handle_t*>(&thread->timer_), NULL);
+    uv_close(reinterpret_cast<uv_handle_t*>(&thread->async_), NULL);
+  }
+
+  Benchmark* benchmark_;
+  uv_timer_t timer_;
+  uv_async_t async_;
+};
+
+void run(const char* name, Benchmark* benchmark, void (*entry)(void*)) {
+  std::vector<uv_thread_t> threads(benchmark->num_threads);
+  std::vector<Worker> workers(benchmark->num_threads);
+
+  MergeThread merge_thread(benchmark);
+  if (merge_thread.init() != 0 || merge_thread.run() != 0) {
+    fprintf(stderr, "Unable to start the merge thread\n");
+    return;
+  }
+
+  uint64_t start = uv_hrtime();
+  for (size_t i = 0; i < benchmark->num_threads; ++i) {
+    workers[i].benchmark = benchmark;
+    workers[i].index = i;
+    uv_thread_create(&threads[i], entry, &workers[i]);
+  }
+  for (size_t i = 0; i < benchmark->num_threads; ++i) {
+    uv_thread_join(&threads[i]);
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+
+  merge_thread.done();
+  merge_thread.join();
+
+  double total = static_cast<double>(benchmark->num_threads * benchmark->num_updates);
+  printf("%-14s %10.2f ns/update %12.0f updates/s\n",
+         name,
+         static_cast<double>(elapsed) * benchmark->num_threads / total,
+         total / (static_cast<double>(elapsed) / 1e9));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+  size_t num_hosts = argc > 2 ? strtoul(argv[2], NULL, 10) : 3;
+  size_t num_updates = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000000;
+
+  if (num_threads == 0 || num_threads > CASS_MAX_IO_WORKERS ||
+      num_hosts == 0 || num_updates == 0) {
+    fprintf(stderr, "Usage: %s [num_threads] [num_hosts] [num_updates]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%u threads, %u hosts, %u updates per thread\n",
+         static_cast<unsigned>(num_threads),
+         static_cast<unsigned>(num_hosts),
+         static_cast<unsigned>(num_updates));
+
+  Benchmark benchmark(num_threads, num_hosts, num_updates);
+  run("shared", &benchmark, run_shared);
+  run("per_io_worker", &benchmark, run_per_io_worker);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Measures creating a query plan and computing its first hosts for each
+// load balancing policy chain. Plans are either allocated on the heap or
+// from a request's fixed query plan storage.
+//
+// Usage: benchmark_query_plan [num_plans]
+
+#include "dc_aware_policy.hpp"
+#include "latency_aware_policy.hpp"
+#include "power_of_two_choices_policy.hpp"
+#include "query_request.hpp"
+#include "replication_strategy.hpp"
+#include "round_robin_policy.hpp"
+#include "scoped_ptr.hpp"
+#include "token_aware_policy.hpp"
+#include "token_map.hpp"
+
+#include <limits>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+namespace {
+
+const std::string LOCAL_DC = "local";
+const std::string REMOTE_DC = "remote";
+const size_t NUM_HOSTS = 9;
+const size_t NUM_HOSTS_PER_PLAN = 2; // The first host and a retry
+
+cass::Address addr_for_sequence(size_t i) {
+  cass::Address addr("0.0.0.0", 9042);
+  addr.addr_in()->sin_addr.s_addr = i;
+  return addr;
+}
+
+// Every third host is in the remote data center
+void build_cluster(cass::HostMap* hosts, cass::TokenMap* token_map) {
+  token_map->set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors[LOCAL_DC] = 3;
+  replication_factors[REMOTE_DC] = 2;
+  cass::SharedRefPtr<cass::ReplicationStrategy> strategy(
+        new cass::NetworkTopologyStrategy("", replication_factors));
+  token_map->set_replication_strategy("ks", strategy);
+
+  uint64_t partition_size = std::numeric_limits<uint64_t>::max() / NUM_HOSTS;
+  int64_t token = std::numeric_limits<int64_t>::min() + partition_size;
+  for (size_t i = 1; i <= NUM_HOSTS; ++i) {
+    cass::Address address = addr_for_sequence(i);
+    cass::SharedRefPtr<cass::Host> host(new cass::Host(address, false));
+    host->set_up();
+    host->set_rack_and_dc("rack", i % 3 == 0 ? REMOTE_DC : LOCAL_DC);
+    (*hosts)[address] = host;
+
+    std::ostringstream ss;
+    ss << token;
+    std::string token_str(ss.str());
+    cass::TokenStringList tokens;
+    tokens.push_back(cass::StringRef(token_str));
+    token_map->update_host(host, tokens);
+    token += partition_size;
+  }
+
+  token_map->build();
+}
+
+cass::LoadBalancingPolicy* new_policy(const std::string& name) {
+  cass::LatencyAwarePolicy::Settings settings;
+  if (name == "round_robin") {
+    return new cass::RoundRobinPolicy();
+  } else if (name == "dc_aware") {
+    return new cass::DCAwarePolicy(LOCAL_DC, 1, false);
+  } else if (name == "token_aware") {
+    return new cass::TokenAwarePolicy(new cass::DCAwarePolicy(LOCAL_DC, 1, false));
+  } else if (name == "latency_ordered") {
+    return new cass::TokenAwarePolicy(new cass::DCAwarePolicy(LOCAL_DC, 1, false), settings);
+  } else if (name == "power_of_two") {
+    return new cass::PowerOfTwoChoicesPolicy(
+          new cass::TokenAwarePolicy(new cass::DCAwarePolicy(LOCAL_DC, 1, false)));
+  } else if (name == "latency_aware") {
+    return new cass::LatencyAwarePolicy(
+          new cass::TokenAwarePolicy(new cass::DCAwarePolicy(LOCAL_DC, 1, false)),
+          settings);
+  }
+  return NULL;
+}
+
+double run(cass::LoadBalancingPolicy* policy,
+           const cass::Request* request,
+           const cass::TokenMap& token_map,
+           cass::QueryPlanAllocator* allocator,
+           size_t num_plans) {
+  size_t count = 0;
+  uint64_t start = uv_hrtime();
+  for (size_t i = 0; i < num_plans; ++i) {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy->new_query_plan("ks", request, token_map, allocator));
+    for (size_t j = 0; j < NUM_HOSTS_PER_PLAN; ++j) {
+      if (qp->compute_next()) ++count;
+    }
+    qp.reset();
+    if (allocator != NULL) allocator->reset();
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+  if (count != num_plans * NUM_HOSTS_PER_PLAN) {
+    fprintf(stderr, "Unexpected number of hosts\n");
+  }
+  return static_cast<double>(elapsed) / num_plans;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_plans = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  if (num_plans == 0) {
+    fprintf(stderr, "Usage: %s [num_plans]\n", argv[0]);
+    return 1;
+  }
+
+  cass::HostMap hosts;
+  cass::TokenMap token_map;
+  build_cluster(&hosts, &token_map);
+
+  cass::SharedRefPtr<cass::QueryRequest> request(new cass::QueryRequest(1));
+  const char* value = "abc";
+  request->bind(0, value, strlen(value));
+  request->add_key_index(0);
+
+  printf("%u plans, %u hosts per plan\n",
+         static_cast<unsigned>(num_plans),
+         static_cast<unsigned>(NUM_HOSTS_PER_PLAN));
+  printf("%-16s %14s %14s\n", "policy", "heap ns/plan", "fixed ns/plan");
+
+  const char* names[] = { "round_robin", "dc_aware", "token_aware",
+                          "latency_ordered", "power_of_two", "latency_aware" };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    cass::ScopedRefPtr<cass::LoadBalancingPolicy> policy(new_policy(names[i]));
+    policy->init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+    cass::QueryPlanAllocator allocator;
+    double heap = run(policy.get(), request.get(), token_map, NULL, num_plans);
+    double fixed = run(policy.get(), request.get(), token_map, &allocator, num_plans);
+    printf("%-16s %14.2f %14.2f\n", names[i], heap, fixed);
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Measures acquiring and releasing stream ids with the bitmap based stream
+// manager and with the previous stack based implementation.
+//
+// Usage: benchmark_stream_manager [iterations]
+
+#include "stream_manager.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uv.h>
+#include <vector>
+
+namespace {
+
+// The previous stack based implementation, used as the baseline
+template <class T>
+class StackStreamManager {
+public:
+  explicit StackStreamManager(int max_streams)
+      : max_streams_(max_streams)
+      , available_stream_index_(0)
+      , available_streams_(max_streams_)
+      , allocated_streams_(max_streams_, false)
+      , items_(max_streams_) {
+    for (int i = 0; i < max_streams_; ++i) {
+      available_streams_[i] = static_cast<int16_t>(i);
+    }
+  }
+
+  int16_t acquire_stream(const T& item) {
+    if (available_stream_index_ >= max_streams_) {
+      return -1;
+    }
+    int16_t stream = available_streams_[available_stream_index_++];
+    items_[stream] = item;
+    allocated_streams_[stream] = true;
+    return stream;
+  }
+
+  void release_stream(int16_t stream) {
+    assert(stream >= 0 && stream < max_streams_ && allocated_streams_[stream]);
+    available_streams_[--available_stream_index_] = stream;
+    allocated_streams_[stream] = false;
+  }
+
+  bool get_item(int16_t stream, T& output, bool release = true) {
+    if (stream >= 0 && stream < max_streams_ && allocated_streams_[stream]) {
+      output = items_[stream];
+      if (release) {
+        release_stream(stream);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  size_t pending_streams() const { return available_stream_index_; }
+
+private:
+  const int max_streams_;
+  int available_stream_index_;
+  std::vector<int16_t> available_streams_;
+  std::vector<bool> allocated_streams_;
+  std::vector<T> items_;
+};
+
+// Keeps "in_flight" streams acquired and then repeatedly completes the oldest
+// request and starts a new one. Returns the average time per
+// acquire/get_item pair in nanoseconds.
+template <class Streams>
+double benchmark_streams(Streams& streams, int in_flight, size_t iterations) {
+  std::vector<int16_t> ring(in_flight);
+  for (int i = 0; i < in_flight; ++i) {
+    ring[i] = streams.acquire_stream(i);
+  }
+
+  uint64_t start = uv_hrtime();
+  for (size_t i = 0; i < iterations; ++i) {
+    int item;
+    int16_t& stream = ring[i % in_flight];
+    streams.get_item(stream, item);
+    stream = streams.acquire_stream(static_cast<int>(i));
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+
+  for (int i = 0; i < in_flight; ++i) {
+    streams.release_stream(ring[i]);
+  }
+
+  return static_cast<double>(elapsed) / iterations;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  if (iterations == 0) {
+    fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  const int in_flight[] = { 100, 1000, 30000 };
+
+  printf("%u iterations\n", static_cast<unsigned>(iterations));
+  printf("%-10s %12s %12s\n", "in flight", "bitmap ns", "stack ns");
+  for (size_t i = 0; i < sizeof(in_flight) / sizeof(in_flight[0]); ++i) {
+    cass::StreamManager<int> bitmap(3);
+    StackStreamManager<int> stack(cass::StreamManager<int>::MAX_STREAMS_V3);
+
+    double bitmap_ns = benchmark_streams(bitmap, in_flight[i], iterations);
+    double stack_ns = benchmark_streams(stack, in_flight[i], iterations);
+
+    if (bitmap.pending_streams() != 0 || stack.pending_streams() != 0) {
+      fprintf(stderr, "Streams were leaked\n");
+      return 1;
+    }
+
+    printf("%-10d %12.2f %12.2f\n", in_flight[i], bitmap_ns, stack_ns);
+  }
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Measures building the token map from scratch and incrementally updating
+// it when a node is replaced, for a growing number of vnode hosts.
+//
+// Usage: benchmark_token_map_update [max_hosts]
+
+#include "host.hpp"
+#include "replication_strategy.hpp"
+#include "token_map.hpp"
+
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uv.h>
+
+namespace {
+
+const size_t NUM_TOKENS_PER_HOST = 256;
+
+// xorshift64*, good enough to spread tokens around the ring
+uint64_t next_random(uint64_t* state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+
+std::string to_string(int64_t value) {
+  std::ostringstream ss;
+  ss << value;
+  return ss.str();
+}
+
+void generate_tokens(uint64_t* state, std::vector<std::string>* tokens) {
+  tokens->clear();
+  for (size_t i = 0; i < NUM_TOKENS_PER_HOST; ++i) {
+    tokens->push_back(to_string(static_cast<int64_t>(next_random(state))));
+  }
+}
+
+void update_host(cass::TokenMap* token_map,
+                 cass::SharedRefPtr<cass::Host> host,
+                 const std::vector<std::string>& tokens) {
+  cass::TokenStringList token_strings;
+  for (std::vector<std::string>::const_iterator i = tokens.begin();
+       i != tokens.end(); ++i) {
+    token_strings.push_back(*i);
+  }
+  token_map->update_host(host, token_strings);
+}
+
+double elapsed_ms(uint64_t start) {
+  return static_cast<double>(uv_hrtime() - start) / (1000.0 * 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t max_hosts = argc > 1 ? strtoul(argv[1], NULL, 10) : 300;
+  if (max_hosts == 0) {
+    fprintf(stderr, "Usage: %s [max_hosts]\n", argv[0]);
+    return 1;
+  }
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors["dc1"] = 3;
+  cass::SharedRefPtr<cass::ReplicationStrategy> strategy(
+        new cass::NetworkTopologyStrategy("", replication_factors));
+
+  printf("%-10s %16s %16s\n", "tokens", "full build ms", "replaced ms");
+  for (size_t num_hosts = 16; num_hosts <= max_hosts; num_hosts *= 2) {
+    uint64_t state = 88172645463325252ULL;
+
+    cass::HostVec hosts;
+    std::vector<std::vector<std::string> > tokens(num_hosts);
+    for (size_t i = 0; i < num_hosts; ++i) {
+      cass::Address address("0.0.0.0", 9042);
+      address.addr_in()->sin_addr.s_addr = i + 1;
+      cass::SharedRefPtr<cass::Host> host(new cass::Host(address, false));
+      std::ostringstream rack;
+      rack << "rack" << i % 3;
+      host->set_rack_and_dc(rack.str(), "dc1");
+      hosts.push_back(host);
+      generate_tokens(&state, &tokens[i]);
+    }
+
+    cass::TokenMap token_map;
+
+    uint64_t start = uv_hrtime();
+    token_map.set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+    token_map.set_replication_strategy("test", strategy);
+    for (size_t i = 0; i < num_hosts; ++i) {
+      update_host(&token_map, hosts[i], tokens[i]);
+    }
+    token_map.build();
+    double full_ms = elapsed_ms(start);
+
+    // Simulate a node being replaced
+    start = uv_hrtime();
+    token_map.remove_host(hosts.back());
+    generate_tokens(&state, &tokens.back());
+    update_host(&token_map, hosts.back(), tokens.back());
+    double replaced_ms = elapsed_ms(start);
+
+    printf("%-10u %16.2f %16.2f\n",
+           static_cast<unsigned>(num_hosts * NUM_TOKENS_PER_HOST),
+           full_ms, replaced_ms);
+  }
+
+  return 0;
+}
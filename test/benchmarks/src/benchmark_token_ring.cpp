@@ -0,0 +1,118 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Measures finding the replicas of a Murmur3 token using the generic byte
+// encoded token map and using the flat sorted int64 token ring.
+//
+// Usage: benchmark_token_ring [num_lookups]
+
+#include "host.hpp"
+#include "replication_strategy.hpp"
+#include "token_map.hpp"
+
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uv.h>
+
+namespace {
+
+const size_t NUM_HOSTS = 300;
+const size_t NUM_TOKENS_PER_HOST = 256;
+const size_t NUM_KEYS = 1024;
+
+// xorshift64*, good enough to spread tokens and keys around the ring
+uint64_t next_random(uint64_t* state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+
+std::string to_string(int64_t value) {
+  std::ostringstream ss;
+  ss << value;
+  return ss.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_lookups = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  if (num_lookups == 0) {
+    fprintf(stderr, "Usage: %s [num_lookups]\n", argv[0]);
+    return 1;
+  }
+
+  cass::Murmur3Partitioner partitioner;
+  uint64_t state = 88172645463325252ULL;
+
+  cass::TokenReplicaMap replica_map;
+  for (size_t i = 0; i < NUM_HOSTS; ++i) {
+    cass::Address address("0.0.0.0", 9042);
+    address.addr_in()->sin_addr.s_addr = i + 1;
+    cass::CopyOnWriteHostVec replicas(new cass::HostVec());
+    replicas->push_back(cass::SharedRefPtr<cass::Host>(new cass::Host(address, false)));
+    for (size_t j = 0; j < NUM_TOKENS_PER_HOST; ++j) {
+      std::string token(to_string(static_cast<int64_t>(next_random(&state))));
+      replica_map.insert(std::make_pair(partitioner.token_from_string_ref(token),
+                                        replicas));
+    }
+  }
+
+  cass::Murmur3TokenRing ring;
+  ring.build(replica_map);
+
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < NUM_KEYS; ++i) {
+    keys.push_back(to_string(static_cast<int64_t>(next_random(&state))));
+  }
+
+  size_t matches = 0;
+
+  uint64_t start = uv_hrtime();
+  for (size_t i = 0; i < num_lookups; ++i) {
+    const std::string& key = keys[i % keys.size()];
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    cass::TokenReplicaMap::const_iterator it
+        = replica_map.upper_bound(partitioner.hash(data, key.size()));
+    if (it == replica_map.end()) it = replica_map.begin();
+    matches += it->second->size();
+  }
+  double map_ns = static_cast<double>(uv_hrtime() - start) / num_lookups;
+
+  start = uv_hrtime();
+  for (size_t i = 0; i < num_lookups; ++i) {
+    const std::string& key = keys[i % keys.size()];
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    matches -= ring.find(cass::Murmur3Partitioner::hash_int64(data, key.size()))->size();
+  }
+  double ring_ns = static_cast<double>(uv_hrtime() - start) / num_lookups;
+
+  if (matches != 0) {
+    fprintf(stderr, "The token map and the token ring disagree\n");
+    return 1;
+  }
+
+  printf("%u tokens, %u lookups\n",
+         static_cast<unsigned>(ring.size()),
+         static_cast<unsigned>(num_lookups));
+  printf("%-12s %10s\n", "lookup", "ns/op");
+  printf("%-12s %10.2f\n", "map", map_ns);
+  printf("%-12s %10.2f\n", "ring", ring_ns);
+
+  return 0;
+}
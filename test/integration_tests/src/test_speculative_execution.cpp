@@ -0,0 +1,87 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/debug.hpp>
+
+#include "cassandra.h"
+#include "testing.hpp"
+#include "test_utils.hpp"
+
+#define QUERY_COUNT 10
+#define SPECULATIVE_EXECUTION_DELAY_MS 100
+
+struct SpeculativeExecutionTest {
+public:
+  boost::shared_ptr<cql::cql_ccm_bridge_t> ccm_;
+
+  SpeculativeExecutionTest()
+    : configuration_(cql::get_ccm_bridge_configuration())
+    , cluster_(cass_cluster_new()) {
+    boost::debug::detect_memory_leaks(false);
+
+    // Requests to a paused node would otherwise wait for the request timeout
+    cass_cluster_set_request_timeout(cluster_.get(), 60 * test_utils::ONE_SECOND_IN_MICROS);
+    test_utils::initialize_contact_points(cluster_.get(), configuration_.ip_prefix(), 2, 0);
+    BOOST_REQUIRE_EQUAL(cass_cluster_set_constant_speculative_execution_policy(cluster_.get(),
+                                                                              SPECULATIVE_EXECUTION_DELAY_MS,
+                                                                              1),
+                        CASS_OK);
+
+    ccm_ = cql::cql_ccm_bridge_t::create_and_start(configuration_, "test", 2, 0);
+    session_ = test_utils::create_session(cluster_.get());
+  }
+
+  ~SpeculativeExecutionTest() {
+    test_utils::CassFuturePtr close_future(cass_session_close(session_.get()));
+    cass_future_wait(close_future.get());
+  }
+
+  CassError execute_idempotent(cass_duration_t timeout) {
+    test_utils::CassStatementPtr statement(
+          cass_statement_new("SELECT release_version FROM system.local", 0));
+    cass_statement_set_is_idempotent(statement.get(), cass_true);
+    test_utils::CassFuturePtr future(cass_session_execute(session_.get(), statement.get()));
+    return test_utils::wait_and_return_error(future.get(), timeout);
+  }
+
+  const cql::cql_ccm_bridge_configuration_t& configuration_;
+  test_utils::CassClusterPtr cluster_;
+  test_utils::CassSessionPtr session_;
+};
+
+BOOST_FIXTURE_TEST_SUITE(speculative_execution, SpeculativeExecutionTest)
+
+/**
+ * Idempotent statements complete using the other node while a node is
+ * unresponsive
+ */
+BOOST_AUTO_TEST_CASE(paused_node)
+{
+  ccm_->pause(1);
+
+  for (int i = 0; i < QUERY_COUNT; ++i) {
+    BOOST_CHECK_EQUAL(execute_idempotent(5 * test_utils::ONE_SECOND_IN_MICROS), CASS_OK);
+  }
+
+  ccm_->resume(1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "batch_request.hpp"
+#include "buffer_builder.hpp"
+#include "buffer_collection.hpp"
+#include "query_request.hpp"
+#include "ref_counted.hpp"
+#include "serialization.hpp"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+static std::string to_string(const cass::BufferVec& bufs) {
+  std::string result;
+  for (cass::BufferVec::const_iterator it = bufs.begin(),
+       end = bufs.end(); it != end; ++it) {
+    result.append(it->data(), it->size());
+  }
+  return result;
+}
+
+static void append_int32(std::string* output, int32_t value) {
+  char buf[sizeof(int32_t)];
+  cass::encode_int32(buf, value);
+  output->append(buf, sizeof(buf));
+}
+
+static void append_uint16(std::string* output, uint16_t value) {
+  char buf[sizeof(uint16_t)];
+  cass::encode_uint16(buf, value);
+  output->append(buf, sizeof(buf));
+}
+
+// <query> [long string] + <consistency> [short] + <flags> [byte] + <n> [short]
+static std::string encode_query_prefix(const std::string& query, size_t count) {
+  std::string result;
+  append_int32(&result, query.size());
+  result.append(query);
+  append_uint16(&result, CASS_CONSISTENCY_ONE);
+  result.push_back(CASS_QUERY_FLAG_VALUES);
+  append_uint16(&result, count);
+  return result;
+}
+
+BOOST_AUTO_TEST_SUITE(buffer_builder)
+
+BOOST_AUTO_TEST_CASE(small_values_single_buffer)
+{
+  std::string query("INSERT INTO t (a, b, c) VALUES (?, ?, ?)");
+  cass::QueryRequest request(query, 3);
+  request.set_serial_consistency(static_cast<CassConsistency>(0));
+  request.bind(0, static_cast<int32_t>(42));
+  // Value 1 is left unbound and is encoded as a "null"
+  request.bind(2, "abc", 3);
+
+  cass::BufferVec bufs;
+  int length = static_cast<const cass::Request&>(request).encode(2, &bufs);
+
+  std::string expected = encode_query_prefix(query, 3);
+  append_int32(&expected, sizeof(int32_t));
+  append_int32(&expected, 42);
+  append_int32(&expected, -1);
+  append_int32(&expected, 3);
+  expected.append("abc");
+
+  BOOST_REQUIRE(bufs.size() == 1);
+  BOOST_CHECK(length == static_cast<int>(expected.size()));
+  BOOST_CHECK(to_string(bufs) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(collection_encoded_in_place)
+{
+  cass::SharedRefPtr<cass::BufferCollection> collection(new cass::BufferCollection(false, 2));
+  collection->append_int32(1);
+  collection->append_int32(2);
+
+  std::string query("INSERT INTO t (a) VALUES (?)");
+  cass::QueryRequest request(query, 1);
+  request.set_serial_consistency(static_cast<CassConsistency>(0));
+  request.bind(0, collection.get());
+
+  for (int version = 2; version <= 3; ++version) {
+    cass::BufferVec bufs;
+    int length = static_cast<const cass::Request&>(request).encode(version, &bufs);
+
+    cass::BufferVec collection_bufs;
+    collection->encode(version, &collection_bufs);
+    std::string expected = encode_query_prefix(query, 1) + to_string(collection_bufs);
+
+    BOOST_REQUIRE(bufs.size() == 1);
+    BOOST_CHECK(length == static_cast<int>(expected.size()));
+    BOOST_CHECK(to_string(bufs) == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(large_value_by_reference)
+{
+  std::string query("INSERT INTO t (a, b, c) VALUES (?, ?, ?)");
+  std::string blob(2 * cass::BufferBuilder::LARGE_VALUE_SIZE, 'b');
+  cass::QueryRequest request(query, 3);
+  request.set_serial_consistency(static_cast<CassConsistency>(0));
+  request.set_paging_state("state");
+  request.bind(0, static_cast<int32_t>(1));
+  request.bind(1, blob.data(), blob.size());
+  request.bind(2, static_cast<int32_t>(2));
+
+  cass::BufferVec bufs;
+  int length = static_cast<const cass::Request&>(request).encode(3, &bufs);
+
+  std::string prefix = encode_query_prefix(query, 3);
+  prefix[prefix.size() - sizeof(uint16_t) - 1] |= CASS_QUERY_FLAG_PAGING_STATE;
+  append_int32(&prefix, sizeof(int32_t));
+  append_int32(&prefix, 1);
+
+  std::string value;
+  append_int32(&value, blob.size());
+  value.append(blob);
+
+  std::string suffix;
+  append_int32(&suffix, sizeof(int32_t));
+  append_int32(&suffix, 2);
+  append_int32(&suffix, 5);
+  suffix.append("state");
+
+  // The large value is its own buffer between the two contiguous segments
+  BOOST_REQUIRE(bufs.size() == 3);
+  BOOST_CHECK(std::string(bufs[0].data(), bufs[0].size()) == prefix);
+  BOOST_CHECK(std::string(bufs[1].data(), bufs[1].size()) == value);
+  BOOST_CHECK(std::string(bufs[2].data(), bufs[2].size()) == suffix);
+  BOOST_CHECK(length == static_cast<int>(prefix.size() + value.size() + suffix.size()));
+}
+
+BOOST_AUTO_TEST_CASE(batch_single_buffer)
+{
+  cass::SharedRefPtr<cass::BatchRequest> batch(new cass::BatchRequest(CASS_BATCH_TYPE_LOGGED));
+
+  for (int i = 0; i < 3; ++i) {
+    cass::QueryRequest* request = new cass::QueryRequest("INSERT INTO t (a) VALUES (?)", 1);
+    request->bind(0, static_cast<int32_t>(i));
+    batch->add_statement(request);
+  }
+
+  cass::BufferVec bufs;
+  int length = static_cast<const cass::Request*>(batch.get())->encode(3, &bufs);
+
+  BOOST_REQUIRE(bufs.size() == 1);
+  BOOST_CHECK(length == bufs[0].size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
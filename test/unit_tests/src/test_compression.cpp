@@ -0,0 +1,108 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "compression.hpp"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(compression)
+
+BOOST_AUTO_TEST_CASE(lz4_round_trip)
+{
+  if (!cass::Lz4Compressor::is_available()) return;
+
+  std::string expected;
+  cass::BufferVec bufs;
+  for (int i = 0; i < 64; ++i) {
+    std::string piece = "The quick brown fox jumps over the lazy dog";
+    expected.append(piece);
+    bufs.push_back(cass::Buffer(piece.data(), piece.size()));
+  }
+
+  std::vector<char> scratch;
+  cass::Buffer compressed;
+  BOOST_REQUIRE(cass::Lz4Compressor::compress(bufs.begin(), bufs.end(),
+                                              &scratch, &compressed));
+  BOOST_CHECK(static_cast<size_t>(compressed.size()) < expected.size());
+
+  cass::SharedRefPtr<cass::RefBuffer> decompressed;
+  int32_t size = 0;
+  BOOST_REQUIRE(cass::Lz4Compressor::decompress(compressed.data(), compressed.size(),
+                                                &decompressed, &size));
+  BOOST_REQUIRE(static_cast<size_t>(size) == expected.size());
+  BOOST_CHECK(std::string(decompressed->data(), size) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(lz4_round_trip_single_buffer)
+{
+  if (!cass::Lz4Compressor::is_available()) return;
+
+  std::string expected;
+  for (int i = 0; i < 64; ++i) {
+    expected.append("The quick brown fox jumps over the lazy dog");
+  }
+
+  cass::BufferVec bufs;
+  bufs.push_back(cass::Buffer(expected.data(), expected.size()));
+
+  std::vector<char> scratch;
+  cass::Buffer compressed;
+  BOOST_REQUIRE(cass::Lz4Compressor::compress(bufs.begin(), bufs.end(),
+                                              &scratch, &compressed));
+  BOOST_CHECK(scratch.empty());
+
+  cass::SharedRefPtr<cass::RefBuffer> decompressed;
+  int32_t size = 0;
+  BOOST_REQUIRE(cass::Lz4Compressor::decompress(compressed.data(), compressed.size(),
+                                                &decompressed, &size));
+  BOOST_REQUIRE(static_cast<size_t>(size) == expected.size());
+  BOOST_CHECK(std::string(decompressed->data(), size) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(lz4_invalid)
+{
+  cass::SharedRefPtr<cass::RefBuffer> decompressed;
+  int32_t size = 0;
+
+  // Too small for the uncompressed length
+  char truncated[] = { 0x00, 0x00 };
+  BOOST_CHECK(!cass::Lz4Compressor::decompress(truncated, sizeof(truncated),
+                                               &decompressed, &size));
+
+  // Uncompressed length doesn't match the block
+  char invalid[] = { 0x00, 0x00, 0x00, 0x10, 0x00 };
+  BOOST_CHECK(!cass::Lz4Compressor::decompress(invalid, sizeof(invalid),
+                                               &decompressed, &size));
+
+  // Uncompressed length is larger than the block could expand to
+  char too_large[] = { 0x00, 0x00, 0x04, 0x00, 0x00 };
+  BOOST_CHECK(!cass::Lz4Compressor::decompress(too_large, sizeof(too_large),
+                                               &decompressed, &size));
+
+  // Uncompressed length is larger than the maximum frame size
+  char huge[] = { 0x7F, 0x00, 0x00, 0x00, 0x00 };
+  BOOST_CHECK(!cass::Lz4Compressor::decompress(huge, sizeof(huge),
+                                               &decompressed, &size));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "concurrency_limiter.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const uint64_t ONE_MS = 1000LL * 1000LL;
+
+cass::ConcurrencyLimiter::Settings settings() {
+  cass::ConcurrencyLimiter::Settings settings;
+  settings.initial_limit = 10;
+  settings.min_limit = 2;
+  settings.max_limit = 12;
+  settings.backoff_ratio = 0.5;
+  settings.latency_tolerance = 2.0;
+  return settings;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(concurrency_limiter)
+
+BOOST_AUTO_TEST_CASE(limited)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+  BOOST_CHECK_EQUAL(limiter.limit(), 10u);
+  BOOST_CHECK(!limiter.is_limited(9));
+  BOOST_CHECK(limiter.is_limited(10));
+}
+
+BOOST_AUTO_TEST_CASE(increase)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+
+  // The limit only grows while it's being used
+  for (int i = 0; i < 100; ++i) {
+    limiter.on_success(ONE_MS, 1);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 10u);
+
+  for (int i = 0; i < 100; ++i) {
+    limiter.on_success(ONE_MS, limiter.limit());
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 12u); // Max limit
+}
+
+BOOST_AUTO_TEST_CASE(backoff_on_latency)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+
+  limiter.on_success(ONE_MS, 5);
+  limiter.on_success(ONE_MS + ONE_MS / 2, 5); // Within the tolerance
+  BOOST_CHECK_EQUAL(limiter.limit(), 10u);
+
+  // A single slow request doesn't back off, only a window (of the limit's
+  // size) where most of the requests are slow
+  for (int i = 0; i < 7; ++i) {
+    limiter.on_success(3 * ONE_MS, 5);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 10u);
+  limiter.on_success(3 * ONE_MS, 5);
+  BOOST_CHECK_EQUAL(limiter.limit(), 5u);
+
+  // The next window is the size of the new limit
+  for (int i = 0; i < 4; ++i) {
+    limiter.on_success(3 * ONE_MS, 5);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 5u);
+  limiter.on_success(3 * ONE_MS, 5);
+  BOOST_CHECK_EQUAL(limiter.limit(), 2u);
+
+  // Never below the min limit
+  for (int i = 0; i < 10; ++i) {
+    limiter.on_success(3 * ONE_MS, 5);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(no_backoff_on_latency_tail)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+
+  limiter.on_success(ONE_MS, 5);
+
+  // A slow request in every window, but the median is fine
+  for (int i = 0; i < 100; ++i) {
+    limiter.on_success(i % 5 == 0 ? 10 * ONE_MS : ONE_MS, 1);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(increase_with_jitter)
+{
+  // The default settings with a healthy host: latencies are spread between
+  // 1 and 1.8 ms with a tail where 5% of the requests take 3 to 10 ms
+  cass::ConcurrencyLimiter limiter;
+  size_t initial_limit = limiter.limit();
+
+  uint64_t state = 1;
+  for (int i = 0; i < 20000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t r = state >> 33; // 31 random bits
+    uint64_t latency_ns;
+    if (r % 100 < 5) {
+      latency_ns = 3 * ONE_MS + (r / 100) % (7 * ONE_MS);
+    } else {
+      latency_ns = ONE_MS + (r / 100) % (4 * ONE_MS / 5);
+    }
+    limiter.on_success(latency_ns, limiter.limit());
+  }
+
+  // Growing one per limit's worth of requests the limit would be about 210
+  // without any backoffs
+  BOOST_CHECK_GT(limiter.limit(), 2 * initial_limit);
+}
+
+BOOST_AUTO_TEST_CASE(backoff_on_dropped)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+
+  limiter.on_dropped();
+  BOOST_CHECK_EQUAL(limiter.limit(), 5u);
+
+  for (int i = 0; i < 5; ++i) {
+    limiter.on_dropped();
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(min_latency_window)
+{
+  cass::ConcurrencyLimiter limiter(settings());
+
+  limiter.on_success(ONE_MS, 1);
+
+  // A host that's become slower is the new baseline after a window
+  for (uint64_t i = 0; i < 2 * cass::ConcurrencyLimiter::MIN_LATENCY_WINDOW; ++i) {
+    limiter.on_success(ONE_MS + ONE_MS / 2, 1);
+  }
+  size_t limit = limiter.limit();
+  for (size_t i = 0; i < limit; ++i) {
+    limiter.on_success(5 * ONE_MS / 2, 1);
+  }
+  BOOST_CHECK_EQUAL(limiter.limit(), limit);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
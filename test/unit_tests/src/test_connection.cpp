@@ -0,0 +1,220 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "address.hpp"
+#include "config.hpp"
+#include "connection.hpp"
+#include "constants.hpp"
+#include "timer_wheel.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <uv.h>
+
+namespace {
+
+const int PROTOCOL_VERSION = 3;
+const size_t HEADER_SIZE = 9;
+
+// A minimal server that completes the startup of a single connection
+struct TestServer {
+  TestServer(uv_loop_t* loop) {
+    uv_tcp_init(loop, &server);
+    server.data = this;
+    uv_tcp_init(loop, &client);
+    client.data = this;
+  }
+
+  void listen(cass::Address* address) {
+    cass::Address any("127.0.0.1", 0);
+#if UV_VERSION_MAJOR == 0
+    BOOST_REQUIRE(uv_tcp_bind(&server, *any.addr_in()) == 0);
+#else
+    BOOST_REQUIRE(uv_tcp_bind(&server, any.addr(), 0) == 0);
+#endif
+    BOOST_REQUIRE(uv_listen(cass::copy_cast<uv_tcp_t*, uv_stream_t*>(&server), 1, on_connection) == 0);
+
+    struct sockaddr_storage name;
+    int name_length = sizeof(name);
+    BOOST_REQUIRE(uv_tcp_getsockname(&server, cass::copy_cast<sockaddr_storage*, sockaddr*>(&name),
+                                     &name_length) == 0);
+    BOOST_REQUIRE(address->init(cass::copy_cast<sockaddr_storage*, sockaddr*>(&name)));
+  }
+
+  void close() {
+    uv_close(cass::copy_cast<uv_tcp_t*, uv_handle_t*>(&server), NULL);
+    uv_close(cass::copy_cast<uv_tcp_t*, uv_handle_t*>(&client), NULL);
+  }
+
+  void respond(const char* header, int8_t opcode, const std::string& body) {
+    std::string* frame = new std::string(HEADER_SIZE, '\0');
+    (*frame)[0] = static_cast<char>(0x80 | PROTOCOL_VERSION);
+    (*frame)[2] = header[2]; // Stream
+    (*frame)[3] = header[3];
+    (*frame)[4] = static_cast<char>(opcode);
+    (*frame)[8] = static_cast<char>(body.size());
+    frame->append(body);
+
+    uv_write_t* req = new uv_write_t;
+    req->data = frame;
+    uv_buf_t buf = uv_buf_init(&(*frame)[0], frame->size());
+    uv_write(req, cass::copy_cast<uv_tcp_t*, uv_stream_t*>(&client), &buf, 1, on_write);
+  }
+
+  void process() {
+    while (input.size() >= HEADER_SIZE) {
+      const char* header = input.data();
+      size_t length = (static_cast<uint8_t>(header[5]) << 24) |
+                      (static_cast<uint8_t>(header[6]) << 16) |
+                      (static_cast<uint8_t>(header[7]) << 8) |
+                      static_cast<uint8_t>(header[8]);
+      if (input.size() < HEADER_SIZE + length) return;
+
+      switch (header[4]) {
+        case CQL_OPCODE_OPTIONS:
+          respond(header, CQL_OPCODE_SUPPORTED, std::string(2, '\0')); // Empty multimap
+          break;
+        case CQL_OPCODE_STARTUP:
+          respond(header, CQL_OPCODE_READY, std::string());
+          break;
+        default:
+          BOOST_FAIL("Unexpected request opcode");
+      }
+      input.erase(0, HEADER_SIZE + length);
+    }
+  }
+
+  static void on_connection(uv_stream_t* stream, int status) {
+    TestServer* server = static_cast<TestServer*>(stream->data);
+    BOOST_REQUIRE(status == 0);
+    BOOST_REQUIRE(uv_accept(stream, cass::copy_cast<uv_tcp_t*, uv_stream_t*>(&server->client)) == 0);
+    uv_read_start(cass::copy_cast<uv_tcp_t*, uv_stream_t*>(&server->client), alloc_buffer, on_read);
+  }
+
+#if UV_VERSION_MAJOR == 0
+  static uv_buf_t alloc_buffer(uv_handle_t* handle, size_t suggested_size) {
+    return uv_buf_init(new char[suggested_size], suggested_size);
+  }
+
+  static void on_read(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+    TestServer* server = static_cast<TestServer*>(stream->data);
+    if (nread > 0) {
+      server->input.append(buf.base, nread);
+      server->process();
+    }
+    delete[] buf.base;
+  }
+#else
+  static void alloc_buffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
+    *buf = uv_buf_init(new char[suggested_size], suggested_size);
+  }
+
+  static void on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+    TestServer* server = static_cast<TestServer*>(stream->data);
+    if (nread > 0) {
+      server->input.append(buf->base, nread);
+      server->process();
+    }
+    delete[] buf->base;
+  }
+#endif
+
+  static void on_write(uv_write_t* req, int status) {
+    delete static_cast<std::string*>(req->data);
+    delete req;
+  }
+
+  uv_tcp_t server;
+  uv_tcp_t client;
+  std::string input;
+};
+
+struct TestListener : public cass::Connection::Listener {
+  TestListener(TestServer* server, cass::TimerWheel* timer_wheel)
+    : is_ready(false)
+    , is_closed(false)
+    , server(server)
+    , timer_wheel(timer_wheel) {}
+
+  virtual void on_ready(cass::Connection* connection) {
+    is_ready = true;
+    connection->close();
+  }
+
+  virtual void on_close(cass::Connection* connection) {
+    is_closed = true;
+    server->close();
+    timer_wheel->close_handles();
+  }
+
+  virtual void on_availability_change(cass::Connection* connection) {}
+  virtual void on_pending_request_count_change(cass::Connection* connection, int delta) {}
+  virtual void on_event(cass::EventResponse* response) {}
+
+  bool is_ready;
+  bool is_closed;
+  TestServer* server;
+  cass::TimerWheel* timer_wheel;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(connection)
+
+BOOST_AUTO_TEST_CASE(startup_without_read_buffer_pool)
+{
+#if UV_VERSION_MAJOR == 0
+  uv_loop_t* loop = uv_loop_new();
+#else
+  uv_loop_t loop_storage;
+  uv_loop_t* loop = &loop_storage;
+  uv_loop_init(loop);
+#endif
+
+  cass::Config config;
+  cass::TimerWheel timer_wheel;
+  BOOST_REQUIRE(timer_wheel.init(loop) == 0);
+
+  TestServer server(loop);
+  cass::Address address;
+  server.listen(&address);
+
+  // Like the control connection's, the responses are read into buffers
+  // that aren't from a pool
+  TestListener listener(&server, &timer_wheel);
+  cass::Connection* connection = new cass::Connection(loop, &timer_wheel, config, NULL, NULL,
+                                                      address, cass::SharedRefPtr<cass::Host>(),
+                                                      "", PROTOCOL_VERSION, &listener);
+  connection->connect();
+
+  uv_run(loop, UV_RUN_DEFAULT);
+
+  BOOST_CHECK(listener.is_ready);
+  BOOST_CHECK(listener.is_closed);
+
+#if UV_VERSION_MAJOR == 0
+  uv_loop_delete(loop);
+#else
+  uv_loop_close(loop);
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "host.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <uv.h>
+
+namespace {
+
+struct ToggleData {
+  cass::Host* host;
+  size_t io_worker_index;
+};
+
+void toggle_availability(void* arg) {
+  ToggleData* data = static_cast<ToggleData*>(arg);
+  for (int i = 0; i < 100000; ++i) {
+    data->host->set_available(data->io_worker_index, i % 2 == 0);
+  }
+  data->host->set_available(data->io_worker_index, true);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(host_availability)
+
+BOOST_AUTO_TEST_CASE(bitmap)
+{
+  cass::Host host(cass::Address("127.0.0.1", 9042), false);
+
+  // Hosts are unavailable until an IO worker has a pool for them
+  for (size_t i = 0; i < CASS_MAX_IO_WORKERS; ++i) {
+    BOOST_CHECK(!host.is_available(i));
+  }
+
+  const size_t indexes[] = { 0, 31, 32, 63, 64, CASS_MAX_IO_WORKERS - 1 };
+  const size_t count = sizeof(indexes) / sizeof(indexes[0]);
+  for (size_t i = 0; i < count; ++i) {
+    host.set_available(indexes[i], true);
+  }
+
+  for (size_t i = 0; i < CASS_MAX_IO_WORKERS; ++i) {
+    bool expected = false;
+    for (size_t j = 0; j < count; ++j) {
+      if (indexes[j] == i) expected = true;
+    }
+    BOOST_CHECK(host.is_available(i) == expected);
+  }
+
+  host.set_available(31, false);
+  BOOST_CHECK(!host.is_available(31));
+  BOOST_CHECK(host.is_available(0));
+  BOOST_CHECK(host.is_available(32));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_updates)
+{
+  // IO workers sharing a word don't lose each other's updates
+  const size_t num_threads = 8;
+  cass::Host host(cass::Address("127.0.0.1", 9042), false);
+
+  uv_thread_t threads[num_threads];
+  ToggleData data[num_threads];
+  for (size_t i = 0; i < num_threads; ++i) {
+    data[i].host = &host;
+    data[i].io_worker_index = i;
+    uv_thread_create(&threads[i], toggle_availability, &data[i]);
+  }
+
+  for (size_t i = 0; i < num_threads; ++i) {
+    uv_thread_join(&threads[i]);
+  }
+
+  for (size_t i = 0; i < num_threads; ++i) {
+    BOOST_CHECK(host.is_available(i));
+  }
+  BOOST_CHECK(!host.is_available(num_threads));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "indexed_heap.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Item : public cass::IndexedHeap<Item>::Node {
+  Item(int key = 0)
+    : key(key) {}
+  int key;
+};
+
+bool less_key(const Item* a, const Item* b) {
+  return a->key < b->key;
+}
+
+typedef cass::IndexedHeap<Item> Heap;
+
+std::vector<int> drain(Heap* heap) {
+  std::vector<int> keys;
+  while (!heap->is_empty()) {
+    Item* item = heap->top();
+    keys.push_back(item->key);
+    heap->remove(item);
+    BOOST_CHECK(!item->is_in_heap());
+  }
+  return keys;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(indexed_heap)
+
+BOOST_AUTO_TEST_CASE(ordered)
+{
+  const int keys[] = { 5, 3, 8, 1, 9, 2, 7, 4, 6, 0 };
+  const size_t num_keys = sizeof(keys) / sizeof(keys[0]);
+
+  std::vector<Item> items(keys, keys + num_keys);
+  Heap heap(less_key);
+  for (size_t i = 0; i < items.size(); ++i) {
+    heap.push(&items[i]);
+    BOOST_CHECK(items[i].is_in_heap());
+  }
+  BOOST_CHECK_EQUAL(heap.size(), num_keys);
+  BOOST_CHECK_EQUAL(heap.top()->key, 0);
+
+  std::vector<int> expected(keys, keys + num_keys);
+  std::sort(expected.begin(), expected.end());
+  std::vector<int> actual = drain(&heap);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(update)
+{
+  std::vector<Item> items;
+  for (int i = 0; i < 8; ++i) {
+    items.push_back(Item(i * 10));
+  }
+
+  Heap heap(less_key);
+  for (size_t i = 0; i < items.size(); ++i) {
+    heap.push(&items[i]);
+  }
+
+  // Busier
+  items[0].key = 75;
+  heap.update(&items[0]);
+  BOOST_CHECK_EQUAL(heap.top()->key, 10);
+
+  // Less busy
+  items[6].key = 5;
+  heap.update(&items[6]);
+  BOOST_CHECK_EQUAL(heap.top()->key, 5);
+
+  const int expected[] = { 5, 10, 20, 30, 40, 50, 70, 75 };
+  std::vector<int> actual = drain(&heap);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected, expected + sizeof(expected) / sizeof(expected[0]));
+}
+
+BOOST_AUTO_TEST_CASE(remove_from_middle)
+{
+  std::vector<Item> items;
+  for (int i = 0; i < 8; ++i) {
+    items.push_back(Item(i));
+  }
+
+  Heap heap(less_key);
+  for (size_t i = 0; i < items.size(); ++i) {
+    heap.push(&items[i]);
+  }
+
+  heap.remove(&items[3]);
+  heap.remove(&items[0]);
+  heap.remove(&items[7]);
+  BOOST_CHECK(!items[3].is_in_heap());
+  BOOST_CHECK_EQUAL(heap.size(), 5u);
+
+  // Items can be added back
+  heap.push(&items[3]);
+
+  const int expected[] = { 1, 2, 3, 4, 5, 6 };
+  std::vector<int> actual = drain(&heap);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(),
+                                expected, expected + sizeof(expected) / sizeof(expected[0]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,7 @@
 #include "latency_aware_policy.hpp"
 #include "loop_thread.hpp"
 #include "murmur3.hpp"
+#include "power_of_two_choices_policy.hpp"
 #include "query_request.hpp"
 #include "token_aware_policy.hpp"
 #include "token_map.hpp"
@@ -142,6 +143,7 @@ uint64_t calculate_moving_average(uint64_t first_latency_ns,
   while (uv_hrtime() - start < time_between_ns) {}
 
   host.update_latency(second_latency_ns);
+  host.merge_latencies();
   cass::TimestampedAverage current = host.get_current_average();
   return current.average;
 }
@@ -473,6 +475,64 @@ BOOST_AUTO_TEST_CASE(allow_remote_dcs_for_local_cl)
   }
 }
 
+BOOST_AUTO_TEST_CASE(local_rack)
+{
+  cass::HostMap hosts;
+  populate_hosts(2, "rack1", LOCAL_DC, &hosts);
+  populate_hosts(2, "rack2", LOCAL_DC, &hosts);
+  populate_hosts(1, "rack1", REMOTE_DC, &hosts);
+
+  cass::DCAwarePolicy policy(LOCAL_DC, "rack2", 1, false);
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  BOOST_CHECK(policy.is_local_rack(hosts[addr_for_sequence(3)]));
+  BOOST_CHECK(!policy.is_local_rack(hosts[addr_for_sequence(1)]));
+  BOOST_CHECK(!policy.is_local_rack(hosts[addr_for_sequence(5)]));
+
+  cass::TokenMap tokenMap;
+
+  {
+    boost::scoped_ptr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, tokenMap));
+    const size_t seq[] = {3, 4, 1, 2, 5};
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+
+  // A local rack host that's down is skipped for the rest of the local DC
+  hosts[addr_for_sequence(3)]->set_down();
+
+  {
+    boost::scoped_ptr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, tokenMap));
+    const size_t seq[] = {4, 2, 1, 5};
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(local_rack_host_moved)
+{
+  cass::HostMap hosts;
+  populate_hosts(2, "rack1", LOCAL_DC, &hosts);
+  populate_hosts(1, "rack2", LOCAL_DC, &hosts);
+
+  cass::DCAwarePolicy policy(LOCAL_DC, "rack2", 0, false);
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::TokenMap tokenMap;
+  boost::scoped_ptr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, tokenMap));
+
+  // The control connection moves the host while a plan that was already
+  // built is being iterated. The previous placement is still readable.
+  cass::SharedRefPtr<cass::Host> moved(hosts[addr_for_sequence(3)]);
+  const cass::HostPlacement& previous = moved->placement();
+  moved->set_rack_and_dc("rack1", LOCAL_DC);
+
+  BOOST_CHECK(previous.rack == "rack2");
+  BOOST_CHECK(moved->rack() == "rack1");
+  BOOST_CHECK(!policy.is_local_rack(moved));
+
+  const size_t seq[] = {3, 2, 1};
+  verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+}
+
 BOOST_AUTO_TEST_CASE(start_with_empty_local_dc)
 {
   cass::HostMap hosts;
@@ -656,6 +716,141 @@ BOOST_AUTO_TEST_CASE(network_topology)
   }
 }
 
+BOOST_AUTO_TEST_CASE(latency_ordered)
+{
+  const int64_t num_hosts = 4;
+  cass::HostMap hosts;
+  populate_hosts(num_hosts, "rack1", LOCAL_DC, &hosts);
+
+  cass::LatencyAwarePolicy::Settings settings;
+  settings.min_measured = 1;
+  cass::TokenAwarePolicy policy(new cass::RoundRobinPolicy(), settings);
+  cass::TokenMap token_map;
+
+  token_map.set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+  cass::SharedRefPtr<cass::ReplicationStrategy> strategy(new cass::SimpleStrategy("", 3));
+  token_map.set_replication_strategy("test", strategy);
+
+  uint64_t partition_size = std::numeric_limits<uint64_t>::max() / num_hosts;
+  int64_t t = std::numeric_limits<int64_t>::min() + partition_size;
+  for (cass::HostMap::iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    std::string ts = boost::lexical_cast<std::string>(t);
+    cass::TokenStringList tokens;
+    tokens.push_back(cass::StringRef(ts));
+    token_map.update_host(i->second, tokens);
+    t += partition_size;
+  }
+
+  token_map.build();
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::SharedRefPtr<cass::QueryRequest> request(new cass::QueryRequest(1));
+  const char* value = "kjdfjkldsdjkl"; // Replicas: 4.0.0.0, 1.0.0.0, 2.0.0.0
+  request->bind(0, value, strlen(value));
+  request->add_key_index(0);
+
+  // Without measurements the replicas are rotated
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 4, 1, 2, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+
+  const uint64_t one_ms = 1000LL * 1000LL;
+  hosts[addr_for_sequence(4)]->update_latency(10 * one_ms);
+  hosts[addr_for_sequence(1)]->update_latency(1 * one_ms);
+  hosts[addr_for_sequence(2)]->update_latency(5 * one_ms);
+  for (cass::HostMap::iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    i->second->merge_latencies();
+  }
+
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 1, 2, 4, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+
+  // Requests in flight make the fastest replica less attractive
+  for (int i = 0; i < 10; ++i) {
+    hosts[addr_for_sequence(1)]->inc_inflight_request_count();
+  }
+
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 2, 4, 1, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(local_rack)
+{
+  const int64_t num_hosts = 4;
+  cass::HostMap hosts;
+  populate_hosts(num_hosts, "rack1", LOCAL_DC, &hosts);
+  hosts[addr_for_sequence(2)]->set_rack_and_dc("rack2", LOCAL_DC);
+
+  cass::LatencyAwarePolicy::Settings settings;
+  settings.min_measured = 1;
+  cass::TokenAwarePolicy policy(new cass::DCAwarePolicy(LOCAL_DC, "rack2", 0, false));
+  cass::TokenAwarePolicy latency_ordered_policy(new cass::DCAwarePolicy(LOCAL_DC, "rack2", 0, false),
+                                                settings);
+  cass::TokenMap token_map;
+
+  token_map.set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+  cass::SharedRefPtr<cass::ReplicationStrategy> strategy(new cass::SimpleStrategy("", 3));
+  token_map.set_replication_strategy("test", strategy);
+
+  uint64_t partition_size = std::numeric_limits<uint64_t>::max() / num_hosts;
+  int64_t t = std::numeric_limits<int64_t>::min() + partition_size;
+  for (cass::HostMap::iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    std::string ts = boost::lexical_cast<std::string>(t);
+    cass::TokenStringList tokens;
+    tokens.push_back(cass::StringRef(ts));
+    token_map.update_host(i->second, tokens);
+    t += partition_size;
+  }
+
+  token_map.build();
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+  latency_ordered_policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::SharedRefPtr<cass::QueryRequest> request(new cass::QueryRequest(1));
+  const char* value = "kjdfjkldsdjkl"; // Replicas: 4.0.0.0, 1.0.0.0, 2.0.0.0
+  request->bind(0, value, strlen(value));
+  request->add_key_index(0);
+
+  // The local rack replica is tried before the other local replicas
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 2, 4, 1, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+
+  // ...even when it's slower than the other local replicas
+  const uint64_t one_ms = 1000LL * 1000LL;
+  hosts[addr_for_sequence(4)]->update_latency(10 * one_ms);
+  hosts[addr_for_sequence(1)]->update_latency(1 * one_ms);
+  hosts[addr_for_sequence(2)]->update_latency(5 * one_ms);
+  for (cass::HostMap::iterator i = hosts.begin(); i != hosts.end(); ++i) {
+    i->second->merge_latencies();
+  }
+
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(latency_ordered_policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 2, 1, 4, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+
+  // A local rack replica that's down falls back to the other local replicas
+  hosts[addr_for_sequence(2)]->set_down();
+
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("test", request.get(), token_map));
+    const size_t seq[] = { 1, 4, 3 };
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(latency_aware_lb)
@@ -673,12 +868,102 @@ BOOST_AUTO_TEST_CASE(threshold_to_account)
   cass::TimestampedAverage current = host.get_current_average();
   for (uint64_t i = 0; i < threshold_to_account; ++i) {
     host.update_latency(one_ms);
+    host.merge_latencies();
     current = host.get_current_average();
     BOOST_CHECK(current.num_measured == i + 1);
     BOOST_CHECK(current.average == -1);
   }
 
   host.update_latency(one_ms);
+  host.merge_latencies();
+  current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == threshold_to_account + 1);
+  BOOST_CHECK(current.average == static_cast<int64_t>(one_ms));
+}
+
+BOOST_AUTO_TEST_CASE(merge_io_worker_averages)
+{
+  const uint64_t one_ms = 1000000LL; // 1 ms in ns
+  const uint64_t one_s = 1000LL * one_ms; // 1 s in ns
+
+  cass::Host host(cass::Address("0.0.0.0", 9042), false, 3);
+  host.enable_latency_tracking(one_s, 0LL);
+
+  host.update_latency(one_ms, 0);
+  host.update_latency(3LL * one_ms, 2);
+
+  // Not visible until the IO workers' averages are merged
+  cass::TimestampedAverage current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == 0);
+  BOOST_CHECK(current.average == -1);
+
+  host.merge_latencies();
+  current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == 2);
+  BOOST_CHECK_CLOSE(static_cast<double>(current.average),
+                    static_cast<double>(2LL * one_ms),
+                    0.2);
+
+  // Recently updated IO workers have the same weight regardless of their
+  // number of measurements
+  host.update_latency(one_ms, 0);
+  host.update_latency(one_ms, 0);
+  host.merge_latencies();
+  current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == 4);
+  BOOST_CHECK_CLOSE(static_cast<double>(current.average),
+                    static_cast<double>(2LL * one_ms),
+                    0.2);
+}
+
+BOOST_AUTO_TEST_CASE(merge_io_worker_averages_stale)
+{
+  const uint64_t one_ms = 1000000LL; // 1 ms in ns
+
+  cass::Host host(cass::Address("0.0.0.0", 9042), false, 2);
+  host.enable_latency_tracking(one_ms, 0LL);
+
+  // An IO worker with a long history of slow requests...
+  for (int i = 0; i < 100; ++i) {
+    host.update_latency(10LL * one_ms, 0);
+  }
+
+  // Spin wait
+  uint64_t start = uv_hrtime();
+  while (uv_hrtime() - start < 50LL * one_ms) {}
+
+  // ...doesn't hide the recent fast requests of another IO worker
+  for (int i = 0; i < 5; ++i) {
+    host.update_latency(one_ms, 1);
+  }
+
+  host.merge_latencies();
+  cass::TimestampedAverage current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == 105);
+  BOOST_CHECK(current.average < static_cast<int64_t>(2LL * one_ms));
+}
+
+BOOST_AUTO_TEST_CASE(merge_io_worker_averages_threshold)
+{
+  const uint64_t one_ms = 1000000LL; // 1 ms in ns
+  const uint64_t min_measured = 20LL;
+  const uint64_t threshold_to_account = (30LL * min_measured) / 100LL;
+
+  cass::Host host(cass::Address("0.0.0.0", 9042), false, 3);
+  host.enable_latency_tracking(100LL, min_measured);
+
+  // The warm-up measurements are split between the IO workers
+  for (uint64_t i = 0; i < threshold_to_account; ++i) {
+    host.update_latency(0, i % 3);
+  }
+
+  host.merge_latencies();
+  cass::TimestampedAverage current = host.get_current_average();
+  BOOST_CHECK(current.num_measured == threshold_to_account);
+  BOOST_CHECK(current.average == -1);
+
+  host.update_latency(one_ms, 0);
+  host.merge_latencies();
   current = host.get_current_average();
   BOOST_CHECK(current.num_measured == threshold_to_account + 1);
   BOOST_CHECK(current.average == static_cast<int64_t>(one_ms));
@@ -811,4 +1096,98 @@ BOOST_AUTO_TEST_CASE(min_average_under_min_measured)
 }
 
 
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(power_of_two_choices_lb)
+
+BOOST_AUTO_TEST_CASE(simple)
+{
+  cass::HostMap hosts;
+  populate_hosts(3, "rack", "dc", &hosts);
+  hosts[addr_for_sequence(1)]->inc_inflight_request_count();
+
+  cass::PowerOfTwoChoicesPolicy policy(new cass::RoundRobinPolicy());
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::TokenMap tokenMap;
+
+  // Starts with the less busy of the first two hosts
+  boost::scoped_ptr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, tokenMap));
+  const size_t seq1[] = {2, 1, 3};
+  verify_sequence(qp.get(), VECTOR_FROM(size_t, seq1));
+
+  // Ties keep the child policy's order
+  boost::scoped_ptr<cass::QueryPlan> qp2(policy.new_query_plan("ks", NULL, tokenMap));
+  const size_t seq2[] = {2, 3, 1};
+  verify_sequence(qp2.get(), VECTOR_FROM(size_t, seq2));
+
+  hosts[addr_for_sequence(1)]->dec_inflight_request_count();
+  hosts[addr_for_sequence(3)]->inc_inflight_request_count();
+
+  // The child policy's plan is {3, 1, 2}
+  boost::scoped_ptr<cass::QueryPlan> qp3(policy.new_query_plan("ks", NULL, tokenMap));
+  const size_t seq3[] = {1, 3, 2};
+  verify_sequence(qp3.get(), VECTOR_FROM(size_t, seq3));
+}
+
+BOOST_AUTO_TEST_CASE(keeps_locality)
+{
+  cass::HostMap hosts;
+  populate_hosts(1, "rack", LOCAL_DC, &hosts);
+  populate_hosts(1, "rack", REMOTE_DC, &hosts);
+  hosts[addr_for_sequence(1)]->inc_inflight_request_count();
+
+  cass::PowerOfTwoChoicesPolicy policy(new cass::DCAwarePolicy(LOCAL_DC, 1, false));
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::TokenMap tokenMap;
+
+  // A busy local host is still preferred to a remote host
+  boost::scoped_ptr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, tokenMap));
+  const size_t seq[] = {1, 2};
+  verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(query_plan_allocator)
+
+BOOST_AUTO_TEST_CASE(simple)
+{
+  cass::HostMap hosts;
+  populate_hosts(3, "rack", LOCAL_DC, &hosts);
+  populate_hosts(2, "rack", REMOTE_DC, &hosts);
+
+  cass::LatencyAwarePolicy::Settings settings;
+  cass::LatencyAwarePolicy policy(
+        new cass::PowerOfTwoChoicesPolicy(
+          new cass::TokenAwarePolicy(
+            new cass::DCAwarePolicy(LOCAL_DC, 2, false), settings)),
+        settings);
+  policy.init(cass::SharedRefPtr<cass::Host>(), hosts);
+
+  cass::TokenMap token_map;
+  cass::QueryPlanAllocator allocator;
+
+  // The whole chain of plans fits in the fixed storage
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, token_map, &allocator));
+    BOOST_CHECK(allocator.used() > 0);
+    BOOST_CHECK(allocator.used() <= cass::QueryPlanAllocator::FIXED_SIZE);
+    const size_t seq[] = {1, 2, 3, 5, 4};
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+  allocator.reset();
+
+  // Plans that don't fit use the heap
+  while (allocator.allocate(cass::QueryPlanAllocator::ALIGNMENT) != NULL) {}
+  size_t used = allocator.used();
+  {
+    cass::ScopedPtr<cass::QueryPlan> qp(policy.new_query_plan("ks", NULL, token_map, &allocator));
+    BOOST_CHECK_EQUAL(allocator.used(), used);
+    const size_t seq[] = {2, 3, 1, 4, 5};
+    verify_sequence(qp.get(), VECTOR_FROM(size_t, seq));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "object_pool.hpp"
+#include "query_request.hpp"
+#include "ref_counted.hpp"
+#include "request_handler.hpp"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+typedef cass::ObjectPool<cass::ResponseFuture> ResponseFuturePool;
+typedef cass::ObjectPool<cass::RequestHandler> RequestHandlerPool;
+
+BOOST_AUTO_TEST_SUITE(object_pool)
+
+BOOST_AUTO_TEST_CASE(recycle_future)
+{
+  cass::SharedRefPtr<ResponseFuturePool> pool(new ResponseFuturePool(4));
+
+  cass::ResponseFuture* future = pool->acquire();
+  future->inc_ref();
+  future->statement.assign("SELECT * FROM table");
+  future->set_error(CASS_ERROR_LIB_REQUEST_TIMED_OUT, "Request timed out");
+  BOOST_CHECK(future->ready());
+  future->dec_ref();
+
+  // The same future is reused and its state is reset
+  cass::ResponseFuture* recycled = pool->acquire();
+  BOOST_CHECK(recycled == future);
+  BOOST_CHECK(!recycled->ready());
+  BOOST_CHECK(recycled->statement.empty());
+  recycled->inc_ref();
+  recycled->set();
+  BOOST_CHECK(!recycled->is_error());
+  recycled->dec_ref();
+
+  BOOST_CHECK(pool->allocation_count() == 1);
+  BOOST_CHECK(pool->acquire_count() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(steady_state)
+{
+  cass::SharedRefPtr<ResponseFuturePool> future_pool(new ResponseFuturePool(16));
+  cass::SharedRefPtr<RequestHandlerPool> handler_pool(new RequestHandlerPool(16));
+  cass::SharedRefPtr<cass::QueryRequest> request(new cass::QueryRequest("SELECT * FROM table"));
+
+  const size_t in_flight = 8;
+
+  for (int i = 0; i < 1000; ++i) {
+    std::vector<cass::RequestHandler*> handlers;
+    for (size_t j = 0; j < in_flight; ++j) {
+      cass::ResponseFuture* future = future_pool->acquire();
+      cass::RequestHandler* handler = handler_pool->acquire();
+      handler->init(request.get(), future);
+      handler->inc_ref();
+      handlers.push_back(handler);
+    }
+    // The handlers hold the only references to the futures and the request
+    for (size_t j = 0; j < in_flight; ++j) {
+      handlers[j]->dec_ref();
+    }
+    BOOST_REQUIRE(request->ref_count() == 1);
+  }
+
+  // No allocations after the first round of requests
+  BOOST_CHECK(future_pool->allocation_count() == in_flight);
+  BOOST_CHECK(handler_pool->allocation_count() == in_flight);
+  BOOST_CHECK(handler_pool->acquire_count() == 1000 * in_flight);
+}
+
+BOOST_AUTO_TEST_CASE(free_list_full)
+{
+  cass::SharedRefPtr<ResponseFuturePool> pool(new ResponseFuturePool(2));
+
+  std::vector<cass::ResponseFuture*> futures;
+  for (int i = 0; i < 4; ++i) {
+    futures.push_back(pool->acquire());
+    futures.back()->inc_ref();
+  }
+
+  // Only two of the futures are kept, the others are deleted
+  for (int i = 0; i < 4; ++i) {
+    futures[i]->dec_ref();
+  }
+  futures.clear();
+
+  for (int i = 0; i < 4; ++i) {
+    futures.push_back(pool->acquire());
+    futures.back()->inc_ref();
+  }
+  for (int i = 0; i < 4; ++i) {
+    futures[i]->dec_ref();
+  }
+
+  BOOST_CHECK(pool->allocation_count() == 6);
+}
+
+BOOST_AUTO_TEST_CASE(outlives_owner)
+{
+  cass::SharedRefPtr<ResponseFuturePool> pool(new ResponseFuturePool(4));
+  cass::ResponseFuture* future = pool->acquire();
+  future->inc_ref();
+
+  // The future keeps the pool alive after its owner is gone
+  BOOST_CHECK(pool->ref_count() == 2);
+  pool = cass::SharedRefPtr<ResponseFuturePool>();
+
+  future->set();
+  future->dec_ref();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "read_buffer_pool.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(read_buffer_pool)
+
+BOOST_AUTO_TEST_CASE(reuse)
+{
+  cass::ReadBufferPool pool(1024, 2);
+
+  cass::RefBuffer* buf1 = pool.borrow();
+  cass::RefBuffer* buf2 = pool.borrow();
+  BOOST_CHECK(pool.in_use_count() == 2);
+  BOOST_CHECK(pool.hit_count() == 0);
+
+  pool.give_back(buf2);
+  pool.give_back(buf1);
+  BOOST_CHECK(pool.in_use_count() == 0);
+  BOOST_CHECK(pool.free_count() == 2);
+
+  // Buffers are reused most recently returned first
+  BOOST_CHECK(pool.borrow() == buf1);
+  BOOST_CHECK(pool.borrow() == buf2);
+  BOOST_CHECK(pool.hit_count() == 2);
+  BOOST_CHECK(pool.borrow_count() == 4);
+  BOOST_CHECK(pool.hit_rate() == 0.5);
+
+  pool.give_back(buf1);
+  pool.give_back(buf2);
+}
+
+BOOST_AUTO_TEST_CASE(peak_and_max_free)
+{
+  cass::ReadBufferPool pool(1024, 2);
+
+  cass::RefBuffer* bufs[4];
+  for (int i = 0; i < 4; ++i) {
+    bufs[i] = pool.borrow();
+  }
+  BOOST_CHECK(pool.peak_in_use_count() == 4);
+
+  for (int i = 0; i < 4; ++i) {
+    pool.give_back(bufs[i]);
+  }
+
+  // Only "max_free_buffers" are kept around
+  BOOST_CHECK(pool.free_count() == 2);
+  BOOST_CHECK(pool.in_use_count() == 0);
+  BOOST_CHECK(pool.peak_in_use_count() == 4);
+}
+
+BOOST_AUTO_TEST_CASE(retained)
+{
+  cass::ReadBufferPool pool(1024, 2);
+
+  cass::RefBuffer* buf = pool.borrow();
+
+  // Simulate a response decoded in place that references the buffer
+  cass::SharedRefPtr<cass::RefBuffer> response_ref(buf);
+  pool.give_back(buf);
+
+  // The buffer can't be recycled while it's referenced
+  BOOST_CHECK(pool.free_count() == 0);
+  BOOST_CHECK(pool.retained_count() == 1);
+  BOOST_CHECK(response_ref->ref_count() == 1);
+
+  cass::RefBuffer* next = pool.borrow();
+  BOOST_CHECK(next != buf);
+  BOOST_CHECK(pool.hit_count() == 0);
+  pool.give_back(next);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -37,6 +37,13 @@ static cass::SharedRefPtr<cass::Host> create_host(const std::string& ip,
   return host;
 }
 
+static cass::SharedRefPtr<cass::TokenHost> create_token_host(const std::string& ip,
+                                                             const std::string& rack = "",
+                                                             const std::string& dc = "") {
+  return cass::SharedRefPtr<cass::TokenHost>(
+        new cass::TokenHost(create_host(ip, rack, dc), rack, dc));
+}
+
 void check_host(const cass::SharedRefPtr<cass::Host>& host,
                 const std::string& ip,
                 const std::string& rack = "",
@@ -59,10 +66,10 @@ BOOST_AUTO_TEST_CASE(simple)
   cass::Token t3(1, 'r');
   cass::Token t4(1, 'z');
 
-  primary[t1] = create_host("1.0.0.1");
-  primary[t2] = create_host("1.0.0.2");
-  primary[t3] = create_host("1.0.0.3");
-  primary[t4] = create_host("1.0.0.4");
+  primary[t1] = create_token_host("1.0.0.1");
+  primary[t2] = create_token_host("1.0.0.2");
+  primary[t3] = create_token_host("1.0.0.3");
+  primary[t4] = create_token_host("1.0.0.4");
 
   cass::TokenReplicaMap replicas;
   strategy.tokens_to_replicas(primary, &replicas);
@@ -119,20 +126,20 @@ BOOST_AUTO_TEST_CASE(network_topology)
   cass::Token t3(1, 'i');
   cass::Token t4(1, 'l');
 
-  primary[t1] = create_host("1.0.0.1", "rack1", "dc1");
-  primary[t2] = create_host("1.0.0.2", "rack1", "dc1");
-  primary[t3] = create_host("1.0.0.3", "rack2", "dc1");
-  primary[t4] = create_host("1.0.0.4", "rack2", "dc1");
+  primary[t1] = create_token_host("1.0.0.1", "rack1", "dc1");
+  primary[t2] = create_token_host("1.0.0.2", "rack1", "dc1");
+  primary[t3] = create_token_host("1.0.0.3", "rack2", "dc1");
+  primary[t4] = create_token_host("1.0.0.4", "rack2", "dc1");
 
   cass::Token t5(1, 'o');
   cass::Token t6(1, 'r');
   cass::Token t7(1, 'u');
   cass::Token t8(1, 'z');
 
-  primary[t5] = create_host("2.0.0.1", "rack1", "dc2");
-  primary[t6] = create_host("2.0.0.2", "rack1", "dc2");
-  primary[t7] = create_host("2.0.0.3", "rack2", "dc2");
-  primary[t8] = create_host("2.0.0.4", "rack2", "dc2");
+  primary[t5] = create_token_host("2.0.0.1", "rack1", "dc2");
+  primary[t6] = create_token_host("2.0.0.2", "rack1", "dc2");
+  primary[t7] = create_token_host("2.0.0.3", "rack2", "dc2");
+  primary[t8] = create_token_host("2.0.0.4", "rack2", "dc2");
 
   cass::TokenReplicaMap replicas;
   strategy.tokens_to_replicas(primary, &replicas);
@@ -224,17 +231,17 @@ BOOST_AUTO_TEST_CASE(network_topology_same_rack)
   cass::Token t2(1, 'h');
   cass::Token t3(1, 'l');
 
-  primary[t1] = create_host("1.0.0.1", "rack1", "dc1");
-  primary[t2] = create_host("1.0.0.2", "rack1", "dc1");
-  primary[t3] = create_host("1.0.0.3", "rack1", "dc1");
+  primary[t1] = create_token_host("1.0.0.1", "rack1", "dc1");
+  primary[t2] = create_token_host("1.0.0.2", "rack1", "dc1");
+  primary[t3] = create_token_host("1.0.0.3", "rack1", "dc1");
 
   cass::Token t4(1, 'p');
   cass::Token t5(1, 't');
   cass::Token t6(1, 'z');
 
-  primary[t4] = create_host("2.0.0.1", "rack1", "dc2");
-  primary[t5] = create_host("2.0.0.2", "rack1", "dc2");
-  primary[t6] = create_host("2.0.0.3", "rack1", "dc2");
+  primary[t4] = create_token_host("2.0.0.1", "rack1", "dc2");
+  primary[t5] = create_token_host("2.0.0.2", "rack1", "dc2");
+  primary[t6] = create_token_host("2.0.0.3", "rack1", "dc2");
 
   cass::TokenReplicaMap replicas;
   strategy.tokens_to_replicas(primary, &replicas);
@@ -302,10 +309,10 @@ BOOST_AUTO_TEST_CASE(network_topology_not_enough_racks)
   cass::Token t3(1, 'l');
   cass::Token t4(1, 'p');
 
-  primary[t1] = create_host("1.0.0.1", "rack1", "dc1");
-  primary[t2] = create_host("1.0.0.2", "rack1", "dc1");
-  primary[t3] = create_host("1.0.0.3", "rack1", "dc1");
-  primary[t4] = create_host("1.0.0.4", "rack2", "dc1");
+  primary[t1] = create_token_host("1.0.0.1", "rack1", "dc1");
+  primary[t2] = create_token_host("1.0.0.2", "rack1", "dc1");
+  primary[t3] = create_token_host("1.0.0.3", "rack1", "dc1");
+  primary[t4] = create_token_host("1.0.0.4", "rack2", "dc1");
 
   cass::TokenReplicaMap replicas;
   strategy.tokens_to_replicas(primary, &replicas);
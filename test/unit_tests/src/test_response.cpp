@@ -0,0 +1,182 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "error_response.hpp"
+#include "ref_counted.hpp"
+#include "response.hpp"
+#include "serialization.hpp"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+// Writes a v3 ERROR frame to "output" and returns the size of the frame
+static size_t encode_error_frame(char* output, int16_t stream,
+                                 const std::string& message) {
+  int32_t length = sizeof(int32_t) + sizeof(uint16_t) + message.size();
+  char* pos = output;
+  *(pos++) = static_cast<char>(0x83); // Response, version 3
+  *(pos++) = 0; // Flags
+  cass::encode_uint16(pos, stream);
+  pos += sizeof(uint16_t);
+  *(pos++) = CQL_OPCODE_ERROR;
+  cass::encode_int32(pos, length);
+  pos += sizeof(int32_t);
+  cass::encode_int32(pos, CQL_ERROR_SERVER_ERROR);
+  pos += sizeof(int32_t);
+  cass::encode_uint16(pos, message.size());
+  pos += sizeof(uint16_t);
+  memcpy(pos, message.data(), message.size());
+  return CASS_HEADER_SIZE_V3 + length;
+}
+
+BOOST_AUTO_TEST_SUITE(response)
+
+BOOST_AUTO_TEST_CASE(decode_in_place)
+{
+  std::string message(8 * 1024, 'a');
+  size_t buffer_size = 16 * 1024;
+  cass::SharedRefPtr<cass::RefBuffer> buffer(cass::RefBuffer::create(buffer_size));
+  size_t size = encode_error_frame(buffer->data(), 1234, message);
+
+  cass::ResponseMessage response;
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data(), size) ==
+                static_cast<int>(size));
+  BOOST_REQUIRE(response.is_body_ready());
+  BOOST_CHECK(response.stream() == 1234);
+  BOOST_CHECK(response.opcode() == CQL_OPCODE_ERROR);
+
+  // The body references the read buffer instead of a copy
+  BOOST_CHECK(response.response_body()->buffer().get() == buffer.get());
+  BOOST_CHECK(response.response_body()->data() == buffer->data() + CASS_HEADER_SIZE_V3);
+
+  cass::ErrorResponse* error
+      = static_cast<cass::ErrorResponse*>(response.response_body().get());
+  BOOST_CHECK(error->message() == message);
+}
+
+BOOST_AUTO_TEST_CASE(decode_spanning_reads)
+{
+  std::string message(8 * 1024, 'b');
+  size_t buffer_size = 16 * 1024;
+  cass::SharedRefPtr<cass::RefBuffer> buffer(cass::RefBuffer::create(buffer_size));
+  size_t size = encode_error_frame(buffer->data(), 42, message);
+
+  // The frame is split across two reads and must be copied
+  size_t first = 100;
+  cass::ResponseMessage response;
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data(), first) ==
+                static_cast<int>(first));
+  BOOST_CHECK(!response.is_body_ready());
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data() + first, size - first) ==
+                static_cast<int>(size - first));
+  BOOST_REQUIRE(response.is_body_ready());
+  BOOST_CHECK(response.stream() == 42);
+
+  BOOST_CHECK(response.response_body()->buffer().get() != buffer.get());
+
+  cass::ErrorResponse* error
+      = static_cast<cass::ErrorResponse*>(response.response_body().get());
+  BOOST_CHECK(error->message() == message);
+}
+
+BOOST_AUTO_TEST_CASE(decode_small_frame_copied)
+{
+  std::string message("small");
+  size_t buffer_size = 1024;
+  cass::SharedRefPtr<cass::RefBuffer> buffer(cass::RefBuffer::create(buffer_size));
+  size_t size = encode_error_frame(buffer->data(), 1, message);
+
+  cass::ResponseMessage response;
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data(), size) ==
+                static_cast<int>(size));
+  BOOST_REQUIRE(response.is_body_ready());
+
+  // Small frames don't keep the read buffer alive
+  BOOST_CHECK(response.response_body()->buffer().get() != buffer.get());
+
+  cass::ErrorResponse* error
+      = static_cast<cass::ErrorResponse*>(response.response_body().get());
+  BOOST_CHECK(error->message() == message);
+}
+
+BOOST_AUTO_TEST_CASE(decode_small_fraction_copied)
+{
+  // The body is large, but only a small part of the read buffer
+  std::string message(8 * 1024, 'c');
+  size_t buffer_size = 64 * 1024;
+  cass::SharedRefPtr<cass::RefBuffer> buffer(cass::RefBuffer::create(buffer_size));
+  size_t size = encode_error_frame(buffer->data(), 1, message);
+
+  cass::ResponseMessage response;
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data(), size) ==
+                static_cast<int>(size));
+  BOOST_REQUIRE(response.is_body_ready());
+
+  BOOST_CHECK(response.response_body()->buffer().get() != buffer.get());
+
+  cass::ErrorResponse* error
+      = static_cast<cass::ErrorResponse*>(response.response_body().get());
+  BOOST_CHECK(error->message() == message);
+}
+
+BOOST_AUTO_TEST_CASE(decode_prepared_copied)
+{
+  size_t buffer_size = 1024;
+  cass::SharedRefPtr<cass::RefBuffer> buffer(cass::RefBuffer::create(buffer_size));
+
+  // A v3 PREPARED result with a large id and no column metadata
+  std::string id(512, 'i');
+  int32_t length = sizeof(int32_t) + sizeof(uint16_t) + id.size() +
+                   2 * 2 * sizeof(int32_t);
+  char* pos = buffer->data();
+  *(pos++) = static_cast<char>(0x83); // Response, version 3
+  *(pos++) = 0; // Flags
+  cass::encode_uint16(pos, 1);
+  pos += sizeof(uint16_t);
+  *(pos++) = CQL_OPCODE_RESULT;
+  cass::encode_int32(pos, length);
+  pos += sizeof(int32_t);
+  cass::encode_int32(pos, CASS_RESULT_KIND_PREPARED);
+  pos += sizeof(int32_t);
+  cass::encode_uint16(pos, id.size());
+  pos += sizeof(uint16_t);
+  memcpy(pos, id.data(), id.size());
+  pos += id.size();
+  for (int i = 0; i < 2; ++i) { // Prepared and result metadata
+    cass::encode_int32(pos, CASS_RESULT_FLAG_NO_METADATA);
+    pos += sizeof(int32_t);
+    cass::encode_int32(pos, 0); // Column count
+    pos += sizeof(int32_t);
+  }
+  size_t size = CASS_HEADER_SIZE_V3 + length;
+  BOOST_REQUIRE(static_cast<size_t>(pos - buffer->data()) == size);
+
+  cass::ResponseMessage response;
+  BOOST_REQUIRE(response.decode(3, buffer.get(), buffer_size, buffer->data(), size) ==
+                static_cast<int>(size));
+  BOOST_REQUIRE(response.is_body_ready());
+
+  // Prepared results are kept indefinitely and never reference the read buffer
+  BOOST_CHECK(response.response_body()->buffer().get() != buffer.get());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
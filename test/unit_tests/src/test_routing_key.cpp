@@ -20,6 +20,7 @@
 
 #include "query_request.hpp"
 #include "token_map.hpp"
+#include "types.hpp"
 #include "murmur3.hpp"
 #include "logger.hpp"
 
@@ -173,4 +174,37 @@ BOOST_AUTO_TEST_CASE(composite)
   }
 }
 
+BOOST_AUTO_TEST_CASE(cached_token)
+{
+  cass::QueryRequest query(2);
+
+  cass_int64_t token;
+  BOOST_CHECK(cass_statement_murmur3_token(CassStatement::to(&query), &token) == CASS_ERROR_LIB_NO_ROUTING_KEY);
+
+  query.bind(0, static_cast<cass_int64_t>(123456789));
+  query.bind(1, static_cast<cass_int32_t>(1));
+  query.add_key_index(0);
+
+  BOOST_REQUIRE(cass_statement_murmur3_token(CassStatement::to(&query), &token) == CASS_OK);
+  BOOST_CHECK(token == 5616923877423390342);
+
+  // Rebinding a value that isn't part of the key keeps the cached token
+  query.bind(1, static_cast<cass_int32_t>(2));
+  BOOST_REQUIRE(query.get_murmur3_token(&token));
+  BOOST_CHECK(token == 5616923877423390342);
+
+  // Rebinding a key column invalidates it
+  query.bind(0, static_cast<cass_int32_t>(123456789));
+  BOOST_REQUIRE(query.get_murmur3_token(&token));
+  BOOST_CHECK(token == -567416363967733925);
+
+  std::string routing_key;
+  BOOST_REQUIRE(query.get_routing_key(&routing_key));
+  BOOST_CHECK(cass::MurmurHash3_x64_128(routing_key.data(), routing_key.size(), 0) == token);
+
+  query.bind(0, cass::CassNull());
+  BOOST_CHECK(!query.get_murmur3_token(&token));
+  BOOST_CHECK(!query.get_routing_key(&routing_key));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "cluster_metadata.hpp"
+#include "schema_metadata.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(schema_snapshot)
+
+BOOST_AUTO_TEST_CASE(immutable)
+{
+  cass::Schema schema;
+  schema.get_or_create("keyspace1");
+
+  cass::SharedRefPtr<const cass::SchemaSnapshot> snapshot(
+        new cass::SchemaSnapshot(1, schema));
+
+  // Updates to the schema don't change the snapshot
+  schema.drop_keyspace("keyspace1");
+  schema.get_or_create("keyspace2");
+
+  BOOST_CHECK(snapshot->schema().get("keyspace1") != NULL);
+  BOOST_CHECK(snapshot->schema().get("keyspace2") == NULL);
+  BOOST_CHECK(schema.get("keyspace1") == NULL);
+  BOOST_CHECK(schema.get("keyspace2") != NULL);
+}
+
+BOOST_AUTO_TEST_CASE(versioned)
+{
+  cass::ClusterMetadata cluster_meta;
+
+  cass::SharedRefPtr<const cass::SchemaSnapshot> first(cluster_meta.schema_snapshot());
+  BOOST_REQUIRE(first);
+
+  // The same snapshot is shared until the schema is updated
+  BOOST_CHECK(cluster_meta.schema_snapshot().get() == first.get());
+
+  cluster_meta.drop_keyspace("keyspace1");
+
+  cass::SharedRefPtr<const cass::SchemaSnapshot> second(cluster_meta.schema_snapshot());
+  BOOST_CHECK(second.get() != first.get());
+  BOOST_CHECK(second->version() > first->version());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -43,9 +43,9 @@ BOOST_AUTO_TEST_CASE(simple)
     BOOST_CHECK(item == i);
   }
 
-  // 127 was the stream last given back
+  // The lowest available stream is always acquired first
   int stream = streams.acquire_stream(0);
-  BOOST_CHECK(stream == 127);
+  BOOST_CHECK(stream == 0);
 }
 
 BOOST_AUTO_TEST_CASE(alloc)
@@ -70,15 +70,51 @@ BOOST_AUTO_TEST_CASE(alloc)
   streams.release_stream(4);
   streams.release_stream(1);
 
-  // Verify that streams are reused
+  BOOST_CHECK(streams.pending_streams() == 0);
+
+  // Verify that streams are reused (lowest first)
+  BOOST_CHECK(streams.acquire_stream(0) == 0);
   BOOST_CHECK(streams.acquire_stream(0) == 1);
-  BOOST_CHECK(streams.acquire_stream(0) == 4);
   BOOST_CHECK(streams.acquire_stream(0) == 2);
-  BOOST_CHECK(streams.acquire_stream(0) == 0);
   BOOST_CHECK(streams.acquire_stream(0) == 3);
+  BOOST_CHECK(streams.acquire_stream(0) == 4);
 
   // Now we should get the first never alloc'd stream
   BOOST_CHECK(streams.acquire_stream(0) == 5);
+
+  // A released stream is reused before any higher stream
+  streams.release_stream(2);
+  BOOST_CHECK(streams.acquire_stream(0) == 2);
+  BOOST_CHECK(streams.acquire_stream(0) == 6);
+  BOOST_CHECK(streams.pending_streams() == 7);
+}
+
+BOOST_AUTO_TEST_CASE(simple_v3)
+{
+  cass::StreamManager<int> streams(3);
+
+  BOOST_CHECK(streams.max_streams() == 32768);
+
+  for (int i = 0; i < 32768; ++i) {
+    int16_t stream = streams.acquire_stream(i);
+    BOOST_REQUIRE(stream == i);
+  }
+
+  // No more streams left
+  BOOST_CHECK(streams.acquire_stream(32768) < 0);
+  BOOST_CHECK(streams.available_streams() == 0);
+
+  for (int i = 0; i < 32768; ++i) {
+    int item = -1;
+    BOOST_CHECK(streams.get_item(i, item));
+    BOOST_CHECK(item == i);
+  }
+
+  BOOST_CHECK(streams.pending_streams() == 0);
+
+  // Invalid streams are never returned
+  int item = -1;
+  BOOST_CHECK(!streams.get_item(-1, item));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
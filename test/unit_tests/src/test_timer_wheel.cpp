@@ -0,0 +1,140 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "timer_wheel.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+
+typedef cass::TimerWheel::Timer Timer;
+
+struct Expired {
+  std::vector<int> ids;
+  Timer* rearm;
+  cass::TimerWheel* wheel;
+};
+
+struct TimerData {
+  int id;
+  Expired* expired;
+};
+
+void on_expired(Timer* timer) {
+  TimerData* data = static_cast<TimerData*>(timer->data());
+  data->expired->ids.push_back(data->id);
+  if (data->expired->rearm == timer) {
+    data->expired->rearm = NULL;
+    timer->start(data->expired->wheel, 100, data, on_expired);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(timer_wheel)
+
+BOOST_AUTO_TEST_CASE(expire_in_order)
+{
+  cass::TimerWheel wheel(10, 8);
+  Expired expired = { std::vector<int>(), NULL, &wheel };
+
+  Timer timers[3];
+  TimerData data[3] = { { 0, &expired }, { 1, &expired }, { 2, &expired } };
+  timers[0].start(&wheel, 50, &data[0], on_expired);
+  timers[1].start(&wheel, 15, &data[1], on_expired);
+  // Longer than a full rotation of the wheel
+  timers[2].start(&wheel, 200, &data[2], on_expired);
+  BOOST_CHECK_EQUAL(wheel.timer_count(), 3u);
+
+  // Timers never expire early
+  wheel.advance(10);
+  BOOST_CHECK(expired.ids.empty());
+
+  wheel.advance(20);
+  BOOST_REQUIRE_EQUAL(expired.ids.size(), 1u);
+  BOOST_CHECK_EQUAL(expired.ids[0], 1);
+  BOOST_CHECK(!timers[1].is_running());
+
+  // The slot for the longer timer is passed on the way
+  wheel.advance(120);
+  BOOST_REQUIRE_EQUAL(expired.ids.size(), 2u);
+  BOOST_CHECK_EQUAL(expired.ids[1], 0);
+  BOOST_CHECK(timers[2].is_running());
+
+  wheel.advance(200);
+  BOOST_REQUIRE_EQUAL(expired.ids.size(), 3u);
+  BOOST_CHECK_EQUAL(expired.ids[2], 2);
+  BOOST_CHECK_EQUAL(wheel.timer_count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(stop)
+{
+  cass::TimerWheel wheel(10, 8);
+  Expired expired = { std::vector<int>(), NULL, &wheel };
+
+  Timer timers[2];
+  TimerData data[2] = { { 0, &expired }, { 1, &expired } };
+  timers[0].start(&wheel, 30, &data[0], on_expired);
+  timers[1].start(&wheel, 30, &data[1], on_expired);
+
+  timers[0].stop();
+  BOOST_CHECK(!timers[0].is_running());
+  BOOST_CHECK_EQUAL(wheel.timer_count(), 1u);
+
+  // Stopping twice is harmless
+  timers[0].stop();
+
+  // Restarting moves the timer to its new deadline
+  timers[1].start(&wheel, 60, &data[1], on_expired);
+  BOOST_CHECK_EQUAL(wheel.timer_count(), 1u);
+
+  wheel.advance(50);
+  BOOST_CHECK(expired.ids.empty());
+
+  wheel.advance(60);
+  BOOST_REQUIRE_EQUAL(expired.ids.size(), 1u);
+  BOOST_CHECK_EQUAL(expired.ids[0], 1);
+}
+
+BOOST_AUTO_TEST_CASE(restart_from_callback)
+{
+  cass::TimerWheel wheel(10, 8);
+  Expired expired = { std::vector<int>(), NULL, &wheel };
+
+  Timer timer;
+  TimerData data = { 0, &expired };
+  timer.start(&wheel, 10, &data, on_expired);
+  expired.rearm = &timer;
+
+  wheel.advance(10);
+  BOOST_CHECK_EQUAL(expired.ids.size(), 1u);
+  BOOST_CHECK(timer.is_running());
+
+  wheel.advance(100);
+  BOOST_CHECK_EQUAL(expired.ids.size(), 1u);
+
+  wheel.advance(110);
+  BOOST_CHECK_EQUAL(expired.ids.size(), 2u);
+  BOOST_CHECK(!timer.is_running());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
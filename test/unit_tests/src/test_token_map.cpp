@@ -19,6 +19,8 @@
 #endif
 
 #include "address.hpp"
+#include "cluster_metadata.hpp"
+#include "host.hpp"
 #include "md5.hpp"
 #include "murmur3.hpp"
 #include "token_map.hpp"
@@ -30,6 +32,7 @@
 #include <boost/random/mersenne_twister.hpp>
 
 #include <limits>
+#include <uv.h>
 
 cass::SharedRefPtr<cass::Host> create_host(const std::string& ip) {
   return cass::SharedRefPtr<cass::Host>(new cass::Host(cass::Address(ip, 4092), false));
@@ -83,6 +86,66 @@ struct TestTokenMap {
   }
 };
 
+// A set of hosts with their token strings, used to apply the same topology
+// incrementally and from scratch.
+struct TestRing {
+  typedef std::map<cass::Address, std::vector<std::string> > HostTokenMap;
+
+  cass::HostMap hosts;
+  HostTokenMap host_tokens;
+
+  cass::SharedRefPtr<cass::Host> add_host(const std::string& ip,
+                                          const std::string& rack,
+                                          const std::string& dc,
+                                          size_t num_tokens,
+                                          boost::mt19937_64& ng) {
+    cass::SharedRefPtr<cass::Host> host(create_host(ip));
+    host->set_rack_and_dc(rack, dc);
+    hosts[host->address()] = host;
+    move_host(host, num_tokens, ng);
+    return host;
+  }
+
+  void move_host(const cass::SharedRefPtr<cass::Host>& host,
+                 size_t num_tokens,
+                 boost::mt19937_64& ng) {
+    std::vector<std::string>& tokens = host_tokens[host->address()];
+    tokens.clear();
+    for (size_t i = 0; i < num_tokens; ++i) {
+      tokens.push_back(boost::lexical_cast<std::string>(static_cast<int64_t>(ng())));
+    }
+  }
+
+  void remove_host(const cass::SharedRefPtr<cass::Host>& host) {
+    hosts.erase(host->address());
+    host_tokens.erase(host->address());
+  }
+
+  void update_host(cass::TokenMap* token_map, cass::SharedRefPtr<cass::Host> host) {
+    const std::vector<std::string>& tokens = host_tokens[host->address()];
+    cass::TokenStringList token_strings;
+    for (std::vector<std::string>::const_iterator i = tokens.begin();
+         i != tokens.end(); ++i) {
+      token_strings.push_back(*i);
+    }
+    token_map->update_host(host, token_strings);
+  }
+
+  void build(cass::TokenMap* token_map,
+             const std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> >& strategies) {
+    token_map->clear();
+    token_map->set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+    for (std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> >::const_iterator i = strategies.begin();
+         i != strategies.end(); ++i) {
+      token_map->set_replication_strategy(i->first, i->second);
+    }
+    for (cass::HostMap::iterator i = hosts.begin(); i != hosts.end(); ++i) {
+      update_host(token_map, i->second);
+    }
+    token_map->build();
+  }
+};
+
 BOOST_AUTO_TEST_SUITE(token_map)
 
 int64_t murmur3_hash(const std::string& s) {
@@ -263,6 +326,317 @@ BOOST_AUTO_TEST_CASE(drop_keyspace)
   }
 }
 
+BOOST_AUTO_TEST_CASE(murmur3_token_ring)
+{
+  cass::Murmur3Partitioner partitioner;
+  cass::HostVec hosts;
+  hosts.push_back(create_host("1.0.0.1"));
+  hosts.push_back(create_host("1.0.0.2"));
+  hosts.push_back(create_host("1.0.0.3"));
+
+  cass::TokenReplicaMap replica_map;
+  const int64_t tokens[] = { std::numeric_limits<int64_t>::min(), -100, 100 };
+  for (size_t i = 0; i < 3; ++i) {
+    cass::CopyOnWriteHostVec replicas(new cass::HostVec());
+    replicas->push_back(hosts[i]);
+    replica_map.insert(std::make_pair(partitioner.token_from_string_ref(
+                                        boost::lexical_cast<std::string>(tokens[i])),
+                                      replicas));
+  }
+
+  cass::Murmur3TokenRing ring;
+  BOOST_CHECK(ring.find(0)->empty());
+
+  ring.build(replica_map);
+  BOOST_REQUIRE(ring.size() == 3);
+
+  // The minimum token is only reachable by wrapping around
+  BOOST_CHECK(ring.find(std::numeric_limits<int64_t>::min())->front() == hosts[1]);
+  BOOST_CHECK(ring.find(-101)->front() == hosts[1]);
+  BOOST_CHECK(ring.find(-100)->front() == hosts[2]);
+  BOOST_CHECK(ring.find(99)->front() == hosts[2]);
+  BOOST_CHECK(ring.find(100)->front() == hosts[0]);
+  BOOST_CHECK(ring.find(std::numeric_limits<int64_t>::max())->front() == hosts[0]);
+
+  // Compare against the generic byte encoded path
+  for (int i = 0; i < 1000; ++i) {
+    std::string key(boost::lexical_cast<std::string>(i));
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    cass::TokenReplicaMap::const_iterator it
+        = replica_map.upper_bound(partitioner.hash(data, key.size()));
+    if (it == replica_map.end()) it = replica_map.begin();
+    BOOST_CHECK(*ring.find(cass::Murmur3Partitioner::hash_int64(data, key.size())) == *it->second);
+  }
+}
+
+static void check_same_replicas(const cass::TokenMap& actual,
+                                const cass::TokenMap& expected,
+                                const std::string& ks_name) {
+  for (int i = 0; i < 500; ++i) {
+    std::string key(boost::lexical_cast<std::string>(i));
+    const cass::CopyOnWriteHostVec& actual_replicas = actual.get_replicas(ks_name, key);
+    const cass::CopyOnWriteHostVec& expected_replicas = expected.get_replicas(ks_name, key);
+    BOOST_REQUIRE(actual_replicas->size() == expected_replicas->size());
+    for (size_t j = 0; j < actual_replicas->size(); ++j) {
+      BOOST_CHECK((*actual_replicas)[j]->address() == (*expected_replicas)[j]->address());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(incremental_update)
+{
+  boost::mt19937_64 ng;
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors["dc1"] = 3;
+  replication_factors["dc2"] = 2;
+
+  std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> > strategies;
+  strategies["nts"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::NetworkTopologyStrategy("", replication_factors));
+  strategies["simple"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                           new cass::SimpleStrategy("", 3));
+  strategies["none"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                         new cass::NonReplicatedStrategy(""));
+
+  TestRing ring;
+  cass::HostVec hosts;
+  for (int i = 0; i < 120; ++i) {
+    std::string ip("1.0." + boost::lexical_cast<std::string>(i / 256) +
+                   "." + boost::lexical_cast<std::string>(i % 256));
+    std::string rack("rack" + boost::lexical_cast<std::string>(i % 3));
+    std::string dc(i % 2 == 0 ? "dc1" : "dc2");
+    hosts.push_back(ring.add_host(ip, rack, dc, 32, ng));
+  }
+
+  // Start with the first 100 hosts
+  for (size_t i = 100; i < hosts.size(); ++i) {
+    ring.remove_host(hosts[i]);
+  }
+
+  cass::TokenMap token_map;
+  ring.build(&token_map, strategies);
+
+  cass::TokenMap expected;
+
+  for (size_t i = 100; i < hosts.size(); ++i) {
+    ring.hosts[hosts[i]->address()] = hosts[i];
+    ring.move_host(hosts[i], 32, ng);
+    ring.update_host(&token_map, hosts[i]);
+
+    // Remove and move some of the existing hosts
+    ring.remove_host(hosts[i - 100]);
+    token_map.remove_host(hosts[i - 100]);
+
+    ring.move_host(hosts[i - 50], 32, ng);
+    ring.update_host(&token_map, hosts[i - 50]);
+
+    ring.build(&expected, strategies);
+    for (std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> >::const_iterator j = strategies.begin();
+         j != strategies.end(); ++j) {
+      check_same_replicas(token_map, expected, j->first);
+    }
+  }
+
+  // A new rack changes rack placement for the whole DC
+  cass::SharedRefPtr<cass::Host> host(ring.add_host("1.1.0.1", "rack3", "dc1", 32, ng));
+  ring.update_host(&token_map, host);
+  ring.build(&expected, strategies);
+  check_same_replicas(token_map, expected, "nts");
+}
+
+BOOST_AUTO_TEST_CASE(shared_strategy_replicas)
+{
+  boost::mt19937_64 ng;
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors["dc1"] = 2;
+
+  std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> > strategies;
+  strategies["ks1"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::NetworkTopologyStrategy("NetworkTopologyStrategy", replication_factors));
+  strategies["ks2"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::NetworkTopologyStrategy("NetworkTopologyStrategy", replication_factors));
+  strategies["ks3"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::SimpleStrategy("SimpleStrategy", 2));
+
+  TestRing ring;
+  for (int i = 0; i < 8; ++i) {
+    ring.add_host("1.0.0." + boost::lexical_cast<std::string>(i + 1), "rack1", "dc1", 16, ng);
+  }
+
+  cass::TokenMap token_map;
+  ring.build(&token_map, strategies);
+
+  // Equal strategies share the same replicas
+  const cass::CopyOnWriteHostVec& ks1_replicas = token_map.get_replicas("ks1", "abc");
+  BOOST_CHECK(ks1_replicas->size() == 2);
+  BOOST_CHECK(&ks1_replicas == &token_map.get_replicas("ks2", "abc"));
+  BOOST_CHECK(&ks1_replicas != &token_map.get_replicas("ks3", "abc"));
+
+  // Keyspaces keep working after their strategy changes or others are dropped
+  token_map.set_replication_strategy("ks2", cass::SharedRefPtr<cass::ReplicationStrategy>(
+                                       new cass::SimpleStrategy("SimpleStrategy", 2)));
+  BOOST_CHECK(&token_map.get_replicas("ks2", "abc") == &token_map.get_replicas("ks3", "abc"));
+
+  token_map.drop_keyspace("ks3");
+  BOOST_CHECK(token_map.get_replicas("ks2", "abc")->size() == 2);
+  BOOST_CHECK(token_map.get_replicas("ks3", "abc")->empty());
+
+  token_map.drop_keyspace("ks1");
+  BOOST_CHECK(token_map.get_replicas("ks1", "abc")->empty());
+  BOOST_CHECK(token_map.get_replicas("ks2", "abc")->size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(copy_replicas)
+{
+  boost::mt19937_64 ng;
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors["dc1"] = 2;
+
+  std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> > strategies;
+  strategies["ks1"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::NetworkTopologyStrategy("NetworkTopologyStrategy", replication_factors));
+  strategies["ks2"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::NetworkTopologyStrategy("NetworkTopologyStrategy", replication_factors));
+  strategies["ks3"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                        new cass::SimpleStrategy("SimpleStrategy", 3));
+
+  TestRing ring;
+  cass::HostVec hosts;
+  for (int i = 0; i < 8; ++i) {
+    hosts.push_back(ring.add_host("1.0.0." + boost::lexical_cast<std::string>(i + 1),
+                                  "rack1", "dc1", 16, ng));
+  }
+
+  cass::TokenMap token_map;
+  ring.build(&token_map, strategies);
+
+  cass::SharedRefPtr<const cass::TokenMap> copy(token_map.copy_replicas());
+  BOOST_CHECK(copy->is_built());
+  for (std::map<std::string, cass::SharedRefPtr<cass::ReplicationStrategy> >::const_iterator i = strategies.begin();
+       i != strategies.end(); ++i) {
+    check_same_replicas(*copy, token_map, i->first);
+  }
+
+  // Keyspaces with equal strategies still share their replicas
+  BOOST_CHECK(&copy->get_replicas("ks1", "abc") == &copy->get_replicas("ks2", "abc"));
+
+  // Updating the map doesn't change the copy
+  cass::TokenMap expected;
+  ring.build(&expected, strategies);
+  ring.remove_host(hosts[0]);
+  token_map.remove_host(hosts[0]);
+  token_map.drop_keyspace("ks3");
+  check_same_replicas(*copy, expected, "ks1");
+  check_same_replicas(*copy, expected, "ks3");
+}
+
+BOOST_AUTO_TEST_CASE(background_build)
+{
+#if UV_VERSION_MAJOR == 0
+  uv_loop_t* loop = uv_loop_new();
+#else
+  uv_loop_t loop_storage;
+  uv_loop_t* loop = &loop_storage;
+  uv_loop_init(loop);
+#endif
+
+  cass::ClusterMetadata cluster_meta;
+  cluster_meta.init(loop);
+
+  cass::SharedRefPtr<const cass::TokenMap> empty(cluster_meta.token_map());
+  BOOST_CHECK(!empty->is_built());
+
+  cluster_meta.set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+  for (int i = 0; i < 3; ++i) {
+    cass::SharedRefPtr<cass::Host> host(create_host("1.0.0." + boost::lexical_cast<std::string>(i + 1)));
+    std::string token(boost::lexical_cast<std::string>(i * 1000));
+    cass::TokenStringList tokens;
+    tokens.push_back(token);
+    cluster_meta.update_host(host, tokens);
+  }
+  cluster_meta.build();
+
+  // Nothing is published until the worker has built the map
+  BOOST_CHECK(cluster_meta.token_map().get() == empty.get());
+
+  uv_run(loop, UV_RUN_DEFAULT);
+
+  cass::SharedRefPtr<const cass::TokenMap> built(cluster_meta.token_map());
+  BOOST_CHECK(built.get() != empty.get());
+  BOOST_CHECK(built->is_built());
+  BOOST_CHECK(!empty->is_built());
+
+  // Replaced maps are still referenced by the loop thread so the last
+  // reader doesn't free them
+  BOOST_CHECK(empty->ref_count() == 2);
+
+  cluster_meta.clear();
+  BOOST_CHECK(!cluster_meta.token_map()->is_built());
+  BOOST_CHECK(built->is_built());
+  BOOST_CHECK(built->ref_count() == 2);
+
+#if UV_VERSION_MAJOR == 0
+  uv_loop_delete(loop);
+#else
+  uv_loop_close(loop);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(background_build_placement)
+{
+#if UV_VERSION_MAJOR == 0
+  uv_loop_t* loop = uv_loop_new();
+#else
+  uv_loop_t loop_storage;
+  uv_loop_t* loop = &loop_storage;
+  uv_loop_init(loop);
+#endif
+
+  cass::ClusterMetadata cluster_meta;
+  cluster_meta.init(loop);
+
+  cluster_meta.set_partitioner(cass::Murmur3Partitioner::PARTITIONER_CLASS);
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap replication_factors;
+  replication_factors["dc1"] = 1;
+  replication_factors["dc2"] = 1;
+  cluster_meta.update_keyspace("test",
+                               cass::SharedRefPtr<cass::ReplicationStrategy>(
+                                 new cass::NetworkTopologyStrategy("", replication_factors)));
+
+  cass::HostVec hosts;
+  for (int i = 0; i < 2; ++i) {
+    cass::SharedRefPtr<cass::Host> host(create_host("1.0.0." + boost::lexical_cast<std::string>(i + 1)));
+    host->set_rack_and_dc("rack1", "dc" + boost::lexical_cast<std::string>(i + 1));
+    std::string token(boost::lexical_cast<std::string>(i * 1000));
+    cass::TokenStringList tokens;
+    tokens.push_back(token);
+    cluster_meta.update_host(host, tokens);
+    hosts.push_back(host);
+  }
+  cluster_meta.build();
 
+  // The placement is copied when the update is queued. Moving a host while
+  // the worker builds doesn't affect the map being built.
+  hosts[1]->set_rack_and_dc("rack1", "dc1");
+
+  uv_run(loop, UV_RUN_DEFAULT);
+
+  cass::SharedRefPtr<const cass::TokenMap> token_map(cluster_meta.token_map());
+  BOOST_REQUIRE(token_map->is_built());
+  for (int i = 0; i < 10; ++i) {
+    std::string key(boost::lexical_cast<std::string>(i));
+    BOOST_CHECK(token_map->get_replicas("test", key)->size() == 2);
+  }
+
+#if UV_VERSION_MAJOR == 0
+  uv_loop_delete(loop);
+#else
+  uv_loop_close(loop);
+#endif
+}
 
 BOOST_AUTO_TEST_SUITE_END()
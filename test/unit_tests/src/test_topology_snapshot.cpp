@@ -0,0 +1,225 @@
+/*
+  Copyright (c) 2014-2015 DataStax
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE cassandra
+#endif
+
+#include "cluster_metadata.hpp"
+#include "host.hpp"
+#include "replication_strategy.hpp"
+#include "topology_snapshot.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+
+namespace {
+
+cass::TopologySnapshot create_snapshot() {
+  cass::TopologySnapshot snapshot;
+  snapshot.partitioner = "org.apache.cassandra.dht.Murmur3Partitioner";
+
+  for (int i = 0; i < 3; ++i) {
+    cass::TopologySnapshot::HostEntry host;
+    host.address = cass::Address("127.0.0." + std::string(1, '1' + i), 9042);
+    host.rack = "rack1";
+    host.dc = i < 2 ? "dc1" : "dc2";
+    host.tokens.push_back(std::string(1, '1' + i) + "000");
+    host.tokens.push_back("-" + std::string(1, '1' + i) + "000");
+    snapshot.hosts.push_back(host);
+  }
+
+  cass::NetworkTopologyStrategy::DCReplicaCountMap rfs;
+  rfs["dc1"] = 2;
+  rfs["dc2"] = 1;
+  snapshot.keyspaces["nts"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                                new cass::NetworkTopologyStrategy("NetworkTopologyStrategy", rfs));
+  snapshot.keyspaces["simple"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                                   new cass::SimpleStrategy("SimpleStrategy", 3));
+  snapshot.keyspaces["local"] = cass::SharedRefPtr<cass::ReplicationStrategy>(
+                                  new cass::NonReplicatedStrategy("LocalStrategy"));
+  return snapshot;
+}
+
+void check_same_snapshot(const cass::TopologySnapshot& actual,
+                         const cass::TopologySnapshot& expected) {
+  BOOST_CHECK(actual.partitioner == expected.partitioner);
+
+  BOOST_REQUIRE(actual.hosts.size() == expected.hosts.size());
+  for (size_t i = 0; i < actual.hosts.size(); ++i) {
+    BOOST_CHECK(actual.hosts[i].address.compare(expected.hosts[i].address) == 0);
+    BOOST_CHECK(actual.hosts[i].rack == expected.hosts[i].rack);
+    BOOST_CHECK(actual.hosts[i].dc == expected.hosts[i].dc);
+    BOOST_CHECK(actual.hosts[i].tokens == expected.hosts[i].tokens);
+  }
+
+  BOOST_REQUIRE(actual.keyspaces.size() == expected.keyspaces.size());
+  for (cass::TopologySnapshot::KeyspaceStrategyMap::const_iterator i = expected.keyspaces.begin();
+       i != expected.keyspaces.end(); ++i) {
+    cass::TopologySnapshot::KeyspaceStrategyMap::const_iterator j = actual.keyspaces.find(i->first);
+    BOOST_REQUIRE(j != actual.keyspaces.end());
+    BOOST_CHECK(j->second->equal(*i->second));
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(topology_snapshot)
+
+BOOST_AUTO_TEST_CASE(encode_decode)
+{
+  cass::TopologySnapshot expected(create_snapshot());
+
+  std::string data;
+  expected.encode(&data);
+
+  cass::TopologySnapshot actual;
+  BOOST_REQUIRE(actual.decode(data.data(), data.size()));
+  check_same_snapshot(actual, expected);
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+  std::string data;
+  create_snapshot().encode(&data);
+
+  cass::TopologySnapshot snapshot;
+
+  // Every truncation is rejected
+  for (size_t size = 0; size < data.size(); ++size) {
+    BOOST_CHECK(!snapshot.decode(data.data(), size));
+  }
+
+  // Trailing data is rejected
+  std::string extra(data + "x");
+  BOOST_CHECK(!snapshot.decode(extra.data(), extra.size()));
+
+  // A different magic or version is rejected
+  std::string bad_magic(data);
+  bad_magic[0] = 'X';
+  BOOST_CHECK(!snapshot.decode(bad_magic.data(), bad_magic.size()));
+
+  std::string bad_version(data);
+  bad_version[11] = static_cast<char>(cass::TopologySnapshot::VERSION + 1);
+  BOOST_CHECK(!snapshot.decode(bad_version.data(), bad_version.size()));
+}
+
+BOOST_AUTO_TEST_CASE(save_load)
+{
+  const std::string path("test_topology_snapshot.bin");
+  remove(path.c_str());
+
+  cass::TopologySnapshot snapshot;
+  BOOST_CHECK(!snapshot.load(path));
+
+  // The cluster metadata records the token map's inputs for the snapshot
+  cass::ClusterMetadata cluster_meta;
+  cass::TopologySnapshot expected(create_snapshot());
+  cass::HostMap hosts;
+
+  cluster_meta.set_partitioner(expected.partitioner);
+  for (cass::TopologySnapshot::HostEntryVec::const_iterator i = expected.hosts.begin();
+       i != expected.hosts.end(); ++i) {
+    cass::SharedRefPtr<cass::Host> host(new cass::Host(i->address, false));
+    host->set_rack_and_dc(i->rack, i->dc);
+    hosts[i->address] = host;
+    cass::TokenStringList tokens(i->tokens.begin(), i->tokens.end());
+    cluster_meta.update_host(host, tokens);
+  }
+  for (cass::TopologySnapshot::KeyspaceStrategyMap::const_iterator i = expected.keyspaces.begin();
+       i != expected.keyspaces.end(); ++i) {
+    cluster_meta.update_keyspace(i->first, i->second);
+  }
+  cluster_meta.build();
+
+  cluster_meta.save_topology_snapshot(path, hosts);
+  BOOST_REQUIRE(snapshot.load(path));
+  check_same_snapshot(snapshot, expected);
+
+  // Dropped keyspaces and removed hosts aren't saved
+  cluster_meta.drop_keyspace("simple");
+  expected.keyspaces.erase("simple");
+  cluster_meta.remove_host(hosts.begin()->second);
+  hosts.erase(hosts.begin());
+  expected.hosts.erase(expected.hosts.begin());
+
+  cluster_meta.save_topology_snapshot(path, hosts);
+  BOOST_REQUIRE(snapshot.load(path));
+  check_same_snapshot(snapshot, expected);
+
+  remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(save_overlapping)
+{
+  const std::string path("test_topology_snapshot_overlapping.bin");
+  remove(path.c_str());
+
+#if UV_VERSION_MAJOR == 0
+  uv_loop_t* loop = uv_loop_new();
+#else
+  uv_loop_t loop_storage;
+  uv_loop_t* loop = &loop_storage;
+  uv_loop_init(loop);
+#endif
+
+  cass::ClusterMetadata cluster_meta;
+  cluster_meta.init(loop);
+
+  cass::TopologySnapshot expected(create_snapshot());
+  cass::HostMap hosts;
+
+  cluster_meta.set_partitioner(expected.partitioner);
+  for (cass::TopologySnapshot::HostEntryVec::const_iterator i = expected.hosts.begin();
+       i != expected.hosts.end(); ++i) {
+    cass::SharedRefPtr<cass::Host> host(new cass::Host(i->address, false));
+    host->set_rack_and_dc(i->rack, i->dc);
+    hosts[i->address] = host;
+    cass::TokenStringList tokens(i->tokens.begin(), i->tokens.end());
+    cluster_meta.update_host(host, tokens);
+  }
+  for (cass::TopologySnapshot::KeyspaceStrategyMap::const_iterator i = expected.keyspaces.begin();
+       i != expected.keyspaces.end(); ++i) {
+    cluster_meta.update_keyspace(i->first, i->second);
+  }
+
+  // Saves from close refreshes don't write the temporary file at the same
+  // time and the last one is written
+  for (int i = 0; i < 2; ++i) {
+    cluster_meta.save_topology_snapshot(path, hosts);
+    cluster_meta.drop_keyspace(expected.keyspaces.begin()->first);
+    expected.keyspaces.erase(expected.keyspaces.begin());
+  }
+  cluster_meta.save_topology_snapshot(path, hosts);
+
+  uv_run(loop, UV_RUN_DEFAULT);
+
+  cass::TopologySnapshot snapshot;
+  BOOST_REQUIRE(snapshot.load(path));
+  check_same_snapshot(snapshot, expected);
+
+#if UV_VERSION_MAJOR == 0
+  uv_loop_delete(loop);
+#else
+  uv_loop_close(loop);
+#endif
+
+  remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()